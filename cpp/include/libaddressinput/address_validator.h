@@ -24,16 +24,37 @@
 #include <libaddressinput/callback.h>
 #include <libaddressinput/util/basictypes.h>
 
+#include <cstddef>
 #include <map>
+#include <vector>
 
 namespace i18n {
 namespace addressinput {
 
+class PreloadSupplier;
+class ProblemFilter;
 class Supplier;
+class ValidationCache;
+class ValidationResult;
 struct AddressData;
 
 typedef std::multimap<AddressField, AddressProblem> FieldProblemMap;
 
+// The options for AddressValidator::ValidateSync() and Validate(), which have
+// the same meaning as the corresponding parameters of the overload of
+// AddressValidator::Validate() that takes a FieldProblemMap. A NULL |filter|
+// lets all problems through.
+struct ValidationOptions {
+  ValidationOptions()
+      : allow_postal(false),
+        require_name(false),
+        filter(NULL) {}
+
+  bool allow_postal;
+  bool require_name;
+  const ProblemFilter* filter;
+};
+
 // Validates an AddressData struct. Sample usage:
 //    class MyClass {
 //     public:
@@ -74,6 +95,13 @@ class AddressValidator {
   // Does not take ownership of |supplier|.
   AddressValidator(Supplier* supplier);
 
+  // Same as above, but Validate() first looks up each address in |cache|, and
+  // stores the problems found for each address validated into |cache|. On a
+  // cache hit, the |supplier| isn't used at all. ValidateBatch() doesn't use
+  // the cache. Does not take ownership of |cache|, which must outlive this
+  // object.
+  AddressValidator(Supplier* supplier, ValidationCache* cache);
+
   ~AddressValidator();
 
   // Validates the |address| and populates |problems| with the validation
@@ -101,8 +129,55 @@ class AddressValidator {
                 FieldProblemMap* problems,
                 const Callback& validated) const;
 
+  // Same as above, but with the filter already compiled into a ProblemFilter,
+  // which the caller can build once and then use for validating any number of
+  // addresses, instead of it being built from a FieldProblemMap on every call.
+  // The |options| are copied, so they needn't be kept available until the
+  // callback has been called.
+  void Validate(const AddressData& address,
+                const ValidationOptions& options,
+                FieldProblemMap* problems,
+                const Callback& validated) const;
+
+  // Validates all |addresses| and populates |problems| with the validation
+  // problems found for each of them, so that the problems of addresses[i] are
+  // written into (*problems)[i]. The parameters are otherwise used the same way
+  // as for Validate().
+  //
+  // Addresses that need the same metadata for validation are grouped together,
+  // so that the metadata is supplied only once for each group instead of once
+  // for each address. This makes validation of large lists of addresses much
+  // faster than calling Validate() repeatedly.
+  //
+  // Calls the |validated| callback once for each address when validation of
+  // that address is done, with the |problems| element for that address. The
+  // callbacks are not necessarily made in the same order as the |addresses|.
+  // All objects passed as parameters must be kept available until the final
+  // callback has been called.
+  void ValidateBatch(const std::vector<AddressData>& addresses,
+                     bool allow_postal,
+                     bool require_name,
+                     const FieldProblemMap* filter,
+                     std::vector<FieldProblemMap>* problems,
+                     const Callback& validated) const;
+
+  // Validates the |address| using the rules already loaded into |supplier|,
+  // and writes the validation problems into |result|. Returns false, with an
+  // empty |result|, if the rules for the region of |address| hadn't been
+  // loaded.
+  //
+  // Unlike Validate(), this neither allocates a task object nor calls any
+  // callback, but does all the work on the calling thread before returning.
+  // Can be called from any number of threads at the same time, also while
+  // |supplier| is loading rules.
+  static bool ValidateSync(const PreloadSupplier& supplier,
+                           const AddressData& address,
+                           const ValidationOptions& options,
+                           ValidationResult* result);
+
  private:
   Supplier* const supplier_;
+  ValidationCache* const cache_;
 
   DISALLOW_COPY_AND_ASSIGN(AddressValidator);
 };
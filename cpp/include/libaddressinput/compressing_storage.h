@@ -0,0 +1,68 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A wrapper object for Storage that compresses the data stored, which for
+// address metadata makes it several times smaller.
+
+#ifndef I18N_ADDRESSINPUT_COMPRESSING_STORAGE_H_
+#define I18N_ADDRESSINPUT_COMPRESSING_STORAGE_H_
+
+#include <libaddressinput/storage.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <string>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+// Wraps Storage to compress stored data. Sample usage:
+//    PreloadSupplier supplier(
+//        new MySource,
+//        new CompressingStorage(new FileStorage("/var/cache/addressinput")));
+//
+// The compression is fast, and decompression much faster still, so reading
+// compressed data is usually faster than reading uncompressed data, as there
+// is less of it to read. Data stored uncompressed by the wrapped storage, from
+// before it was wrapped, is returned as it is.
+class CompressingStorage : public Storage {
+ public:
+  // Takes ownership of |storage|.
+  explicit CompressingStorage(Storage* storage);
+  virtual ~CompressingStorage();
+
+  // Storage implementation.
+  virtual void Put(const std::string& key, std::string* data);
+
+  // Storage implementation. If the compressed data is corrupted, then
+  // |data_ready| will be called with (false, key, NULL).
+  virtual void Get(const std::string& key, const Callback& data_ready) const;
+
+  // Storage implementation. Same as Get(), for each of the |keys|, which are
+  // retrieved from the wrapped storage all at once.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const;
+
+ private:
+  // The storage being wrapped.
+  scoped_ptr<Storage> wrapped_storage_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompressingStorage);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_COMPRESSING_STORAGE_H_
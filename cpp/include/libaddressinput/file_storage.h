@@ -0,0 +1,73 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// An implementation of the Storage interface that keeps the data in files in a
+// directory, so that it's kept between runs, and can be shared by processes.
+
+#ifndef I18N_ADDRESSINPUT_FILE_STORAGE_H_
+#define I18N_ADDRESSINPUT_FILE_STORAGE_H_
+
+#include <libaddressinput/storage.h>
+#include <libaddressinput/util/basictypes.h>
+
+#include <string>
+
+namespace i18n {
+namespace addressinput {
+
+// Stores the data for each key in a file of its own in |directory|, which is
+// created if it doesn't exist (but its parent directory must exist). Sample
+// usage:
+//    PreloadSupplier supplier(new MySource,
+//                             new FileStorage("/var/cache/addressinput"));
+//
+// Put() writes the data to a temporary file, which is then renamed to replace
+// the file for the key, so a file is never seen partially written. Any number
+// of FileStorage objects, in any number of processes, can therefore share the
+// same directory, so that data stored by any of them is used by all of them.
+// If several of them Put() the same key at the same time, the last one to
+// finish wins. Get() maps the file into memory to read it.
+//
+// The files aren't synced to disk when written, so after a system crash a file
+// can be empty or partially written. That is detected by the checksum that
+// the suppliers add to all data they store, and the data is then retrieved
+// anew. Put() fails silently, which just means that the data isn't cached.
+//
+// Uses POSIX file APIs, so it's not built on Windows.
+class FileStorage : public Storage {
+ public:
+  explicit FileStorage(const std::string& directory);
+  virtual ~FileStorage();
+
+  // Storage implementation.
+  virtual void Put(const std::string& key, std::string* data);
+
+  // Storage implementation. Calls |data_ready| with (false, key, NULL) if there
+  // is no data for |key|.
+  virtual void Get(const std::string& key, const Callback& data_ready) const;
+
+ private:
+  // Returns the name of the file for |key|.
+  std::string GetPath(const std::string& key) const;
+
+  const std::string directory_;
+  int temp_files_;  // The number of temporary files created.
+
+  DISALLOW_COPY_AND_ASSIGN(FileStorage);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_FILE_STORAGE_H_
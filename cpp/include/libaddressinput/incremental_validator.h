@@ -0,0 +1,89 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Validation of an address that is edited one field at a time, as in an
+// interactive address form.
+
+#ifndef I18N_ADDRESSINPUT_INCREMENTAL_VALIDATOR_H_
+#define I18N_ADDRESSINPUT_INCREMENTAL_VALIDATOR_H_
+
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+#include <libaddressinput/validation_result.h>
+
+namespace i18n {
+namespace addressinput {
+
+class PreloadSupplier;
+class ValidationTask;
+struct AddressData;
+
+// Keeps the metadata and the validation problems of the last validated address,
+// so that when a single field of the address is changed only the checks that
+// depend on that field need to be run again. Sample usage:
+//    PreloadSupplier supplier(new MySource, new MyStorage);
+//    ... Call supplier.LoadRules() for the region and wait until loaded ...
+//
+//    IncrementalValidator validator(&supplier, ValidationOptions());
+//    validator.Validate(address);
+//    ... The user types a character into the postal code field ...
+//    address.postal_code += c;
+//    if (validator.Update(address, POSTAL_CODE)) {
+//      Show(validator.result());
+//    }
+class IncrementalValidator {
+ public:
+  // Does not take ownership of |supplier|, which must outlive this object. The
+  // filter of |options|, if any, is copied.
+  IncrementalValidator(const PreloadSupplier* supplier,
+                       const ValidationOptions& options);
+  ~IncrementalValidator();
+
+  // Validates all of |address|, the same way as
+  // AddressValidator::ValidateSync(), and keeps the result. Returns false, with
+  // an empty result(), if the rules for the region of |address| hadn't been
+  // loaded.
+  bool Validate(const AddressData& address);
+
+  // Revalidates |address|, which must be the previously validated address with
+  // only |changed_field| changed. Only the checks which depend on that field
+  // are run again. Changing COUNTRY, or a field of the lookup key that selects
+  // different metadata, reruns more checks. Falls back to Validate() if there
+  // is no previous successful validation, or if the rules have been reloaded
+  // since. The language code isn't a field, so call Validate() after changing
+  // it.
+  bool Update(const AddressData& address, AddressField changed_field);
+
+  // Returns the validation problems found by the last call to Validate() or
+  // Update().
+  const ValidationResult& result() const { return result_; }
+
+ private:
+  const PreloadSupplier* const supplier_;
+  const scoped_ptr<ValidationTask> checker_;
+  Supplier::RuleHierarchy hierarchy_;
+  int generation_;  // The generation of the rules in |hierarchy_|.
+  ValidationResult result_;
+  bool validated_;  // Whether the last Validate() or Update() succeeded.
+
+  DISALLOW_COPY_AND_ASSIGN(IncrementalValidator);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_INCREMENTAL_VALIDATOR_H_
@@ -20,17 +20,24 @@
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
+#include <cstddef>
+#include <ctime>
+#include <list>
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 namespace i18n {
 namespace addressinput {
 
 class LookupKey;
+class OndemandSupplyTask;
 class Retriever;
 class Rule;
 class Source;
 class Storage;
+struct StorageOptions;
 
 // An implementation of the Supplier interface that owns a Retriever object,
 // through which it loads address metadata as needed, creating Rule objects and
@@ -43,20 +50,174 @@ class Storage;
 //
 // The maximum size of this cache is naturally limited to the amount of data
 // available from the data server. (Currently this is less than 12,000 items of
-// in total less than 2 MB of JSON data.)
+// in total less than 2 MB of JSON data.) It can be limited further, by giving
+// the cache a memory budget, which is useful for long-running processes that
+// see many rarely used rules.
+//
+// Keys for which the data server has no data, which is what most lookups of
+// misspelled or made up administrative areas and localities end up with, are
+// also cached for a limited time, so that these aren't looked up again and
+// again.
+//
+// Optionally, the rules of the subregions of the most specific region supplied
+// are then prefetched into the cache, as these are likely to be needed next,
+// so that the next request needn't wait for another retrieval.
 class OndemandSupplier : public Supplier {
  public:
-  // Takes ownership of |source| and |storage|.
+  // Limits on prefetching. All zero by default, which disables prefetching.
+  struct PrefetchOptions {
+    PrefetchOptions() : max_depth(0), max_fan_out(0), max_rules(0) {}
+
+    // How many levels of subregions to prefetch.
+    size_t max_depth;
+
+    // How many subregions of each region to prefetch, at most.
+    size_t max_fan_out;
+
+    // How many rules to prefetch after each Supply() request, at most.
+    size_t max_rules;
+  };
+
+  // Takes ownership of |source| and |storage|. The cache is never pruned, so
+  // the rules passed to a Supply() callback remain valid for the lifetime of
+  // this object.
   OndemandSupplier(const Source* source, Storage* storage);
+
+  // Same as above, but whenever a Supply() request is done, evicts the least
+  // recently used rules from the cache until the estimated memory used by the
+  // cached rules is at most |max_cache_bytes|. Rules used by requests that are
+  // still in progress are never evicted. The rules passed to a Supply()
+  // callback remain valid only until the callback returns.
+  OndemandSupplier(const Source* source,
+                   Storage* storage,
+                   size_t max_cache_bytes);
+
   virtual ~OndemandSupplier();
 
+  // Sets how the data in |storage| is used. Must be called before any data is
+  // retrieved.
+  void set_storage_options(const StorageOptions& options);
+
   // Loads the metadata needed for |lookup_key|, then calls |supplied|.
   virtual void Supply(const LookupKey& lookup_key, const Callback& supplied);
 
+  // Returns the number of rules in the cache.
+  size_t cache_size() const { return rule_cache_.size(); }
+
+  // Returns the estimated memory used by the rules of all completed requests.
+  size_t cache_bytes() const { return cache_bytes_; }
+
+  // Returns the number of rules that have been evicted from the cache.
+  size_t evictions() const { return evictions_; }
+
+  // Sets for how many seconds keys for which the data server has no data are
+  // remembered as missing, and not looked up again. The default is one day.
+  // Set to 0 to always look up such keys again.
+  void set_negative_cache_ttl(time_t seconds);
+
+  // Returns the number of keys remembered as missing.
+  size_t negative_cache_size() const { return negative_cache_.size(); }
+
+  // Returns the number of keys that weren't looked up again, because these
+  // were remembered as missing.
+  size_t negative_cache_hits() const { return negative_cache_hits_; }
+
+  // Sets how the rules that are likely to be needed next are prefetched. The
+  // prefetching is started only once the Supply() callback has returned, and
+  // the rules prefetched are the first to be evicted from the cache, unless
+  // these are used.
+  //
+  // With an asynchronous Source, the prefetching goes on after the Supply()
+  // callback has returned, so this object must not be destroyed until
+  // prefetches_in_flight() returns 0.
+  void set_prefetch_options(const PrefetchOptions& options);
+
+  // Returns the number of keys that have been prefetched.
+  size_t prefetched() const { return prefetched_; }
+
+  // Returns the number of prefetches that haven't finished yet.
+  size_t prefetches_in_flight() const { return prefetches_in_flight_; }
+
  private:
-  const scoped_ptr<const Retriever> retriever_;
+  class Prefetch;
+  class Request;
+
+  struct CacheEntry {
+    size_t bytes;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  // Marks the rules used by |task| as the most recently used, and then evicts
+  // rules from the cache if it's over budget.
+  void OnRequestDone(const OndemandSupplyTask* task);
+
+  // Marks |rule| as the most recently used, adding it to |cache_entries_| if
+  // it's not there yet.
+  void Touch(const Rule* rule);
+
+  // Adds |rule| to |cache_entries_| as the least recently used, if it's not
+  // there yet.
+  void TouchPrefetched(const Rule* rule);
+
+  void AddCacheEntry(const Rule* rule,
+                     std::list<std::string>::iterator lru_position);
+
+  void Evict();
+
+  // Returns true if |key| is remembered as missing, forgetting it if it was
+  // remembered too long ago.
+  bool IsMissing(const std::string& key, time_t now);
+
+  // Forgets the keys that were remembered as missing too long ago, and all of
+  // them if there still are too many.
+  void PruneNegativeCache(time_t now);
+
+  // Appends to |keys| the keys of the subregions of |rule| that are neither
+  // cached nor remembered as missing, within the limits of |prefetch_options_|
+  // and |max_key_depth|. Decrements |*budget| by the number of keys appended,
+  // and appends none once it's zero.
+  void AddPrefetchKeys(const Rule& rule,
+                       size_t max_key_depth,
+                       size_t* budget,
+                       std::vector<std::string>* keys);
+
+  // Prefetches the rules for |keys|, and then the rules of their subregions,
+  // |levels| - 1 levels down.
+  void StartPrefetch(const std::vector<std::string>& keys,
+                     size_t levels,
+                     size_t budget,
+                     size_t max_key_depth);
+
+  void OnPrefetchDone(const Prefetch& prefetch);
+
+  const scoped_ptr<Retriever> retriever_;
   std::map<std::string, const Rule*> rule_cache_;
 
+  // The memory budget of the cache, or 0 if it's unlimited.
+  const size_t max_cache_bytes_;
+
+  // The IDs of the cached rules used by completed requests, the most recently
+  // used first, and their memory usage. Rules that have been added to the
+  // cache by requests still in progress aren't counted until these are done.
+  std::list<std::string> lru_;
+  std::map<std::string, CacheEntry> cache_entries_;
+  size_t cache_bytes_;
+  size_t evictions_;
+
+  // The keys for which the data server had no data, and when this was found
+  // out.
+  std::map<std::string, time_t> negative_cache_;
+  time_t negative_cache_ttl_;
+  size_t negative_cache_hits_;
+
+  // The requests and prefetches in progress, the rules of which must not be
+  // evicted.
+  std::set<const OndemandSupplyTask*> in_flight_;
+
+  PrefetchOptions prefetch_options_;
+  size_t prefetched_;
+  size_t prefetches_in_flight_;
+
   DISALLOW_COPY_AND_ASSIGN(OndemandSupplier);
 };
 
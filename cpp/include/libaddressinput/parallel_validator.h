@@ -0,0 +1,98 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Multi-threaded validation of large numbers of addresses, using the metadata
+// that has already been loaded into a PreloadSupplier.
+
+#ifndef I18N_ADDRESSINPUT_PARALLEL_VALIDATOR_H_
+#define I18N_ADDRESSINPUT_PARALLEL_VALIDATOR_H_
+
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+class Mutex;
+class PreloadSupplier;
+class ProblemFilter;
+class ThreadPool;
+class ValidationResult;
+struct AddressData;
+
+// Validates batches of addresses concurrently on a pool of worker threads.
+// Sample usage:
+//    PreloadSupplier supplier(new MySource, new MyStorage);
+//    ... Call supplier.LoadRules() for all regions and wait until loaded ...
+//
+//    ParallelValidator validator(&supplier, 32);
+//    std::vector<FieldProblemMap> problems;
+//    if (validator.ValidateBatch(addresses, false, false, NULL, &problems)) {
+//      ... problems[i] are the problems found for addresses[i] ...
+//    }
+//
+// The metadata for each distinct lookup key of the batch is looked up once, on
+// the calling thread, after which the validation checks, which make up most of
+// the work, are run on the worker threads. Each worker thread processes its
+// own part of the batch and steals work from the others when it runs out.
+class ParallelValidator {
+ public:
+  // Does not take ownership of |supplier|. Starts |num_threads| worker threads,
+  // which are stopped by the destructor. If |num_threads| is zero, then all
+  // validation is done on the calling thread.
+  ParallelValidator(PreloadSupplier* supplier, size_t num_threads);
+  ~ParallelValidator();
+
+  // Validates all |addresses| and populates |problems| with the validation
+  // problems found for each of them, so that the problems of addresses[i] are
+  // written into (*problems)[i]. The other parameters are used the same way as
+  // for AddressValidator::Validate(). Blocks until all addresses have been
+  // validated.
+  //
+  // Returns false if the metadata needed to validate some address wasn't
+  // available, ie. if the rules for its region hadn't been loaded. The problems
+  // for such an address will be empty.
+  //
+  // Calls from different threads are serialized. The |supplier| may load more
+  // rules while this method is running.
+  bool ValidateBatch(const std::vector<AddressData>& addresses,
+                     bool allow_postal,
+                     bool require_name,
+                     const FieldProblemMap* filter,
+                     std::vector<FieldProblemMap>* problems) const;
+
+  // Same as above, but uses a precompiled |filter| and writes the problems into
+  // |results|, so that validating an address doesn't allocate any memory.
+  bool ValidateBatch(const std::vector<AddressData>& addresses,
+                     bool allow_postal,
+                     bool require_name,
+                     const ProblemFilter& filter,
+                     std::vector<ValidationResult>* results) const;
+
+ private:
+  PreloadSupplier* const supplier_;
+  const scoped_ptr<Mutex> mutex_;  // Serializes calls to ValidateBatch().
+  const scoped_ptr<ThreadPool> pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelValidator);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_PARALLEL_VALIDATOR_H_
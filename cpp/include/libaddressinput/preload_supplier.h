@@ -20,6 +20,7 @@
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
+#include <cstddef>
 #include <map>
 #include <set>
 #include <string>
@@ -28,12 +29,15 @@
 namespace i18n {
 namespace addressinput {
 
-class IndexMap;
 class LookupKey;
+class Mutex;
+class ReadCopyUpdate;
+class RegionRules;
 class Retriever;
 class Rule;
 class Source;
 class Storage;
+struct StorageOptions;
 
 // An implementation of the Supplier interface that owns a Retriever object,
 // through which it can load aggregated address metadata for a region when
@@ -48,17 +52,72 @@ class Storage;
 // The maximum size of this cache is naturally limited to the amount of data
 // available from the data server. (Currently this is less than 12,000 items of
 // in total less than 2 MB of JSON data.)
+//
+// The rules of each region are indexed off to the side when loaded, and only
+// then published, atomically. So GetRule(), GetRuleHierarchy(), Supply() and
+// IsLoaded() can be called from any number of threads without taking any lock,
+// also while other regions are being loaded, and see each region either as not
+// yet loaded or as completely loaded.
+//
+// ReloadRules() replaces the rules of a region the same way, and deletes the
+// old Rule objects once no ReadSection that could have seen them remains. Any
+// Rule object (or pointer to one) obtained from this supplier must therefore
+// be used only while the ReadSection object that was created before obtaining
+// it still exists, if rules can be reloaded:
+//    PreloadSupplier::ReadSection section(supplier);
+//    const Rule* rule = supplier.GetRule(lookup_key);
+//    ... Use rule ...
 class PreloadSupplier : public Supplier {
  public:
   typedef i18n::addressinput::Callback<const std::string&, int> Callback;
 
+  // How loading the rules for one region went, as reported by LoadAllRules().
+  struct RegionLoadStats {
+    RegionLoadStats() : region_code(), success(false), num_rules(0),
+                        build_seconds(0.0) {}
+
+    std::string region_code;
+    bool success;
+    int num_rules;
+
+    // The time spent parsing the rules and building the index for them, on
+    // the worker thread that did it.
+    double build_seconds;
+  };
+
+  // Called with the stats of each region loaded, in the order of
+  // RegionDataConstants::GetRegionCodes(), and the total wall-clock time that
+  // loading took, in seconds.
+  typedef i18n::addressinput::Callback<const std::vector<RegionLoadStats>&,
+                                       double> LoadAllCallback;
+
+  // Keeps all Rule objects that the supplier holds while this object is being
+  // constructed from being deleted, until this object is destroyed. Never
+  // blocks. Can be nested.
+  class ReadSection {
+   public:
+    explicit ReadSection(const PreloadSupplier& supplier);
+    ~ReadSection();
+
+   private:
+    const ReadCopyUpdate& rcu_;
+    const int token_;
+
+    DISALLOW_COPY_AND_ASSIGN(ReadSection);
+  };
+
   // Takes ownership of |source| and |storage|.
   PreloadSupplier(const Source* source, Storage* storage);
   virtual ~PreloadSupplier();
 
+  // Sets how the data in |storage| is used. Must be called before any data is
+  // retrieved.
+  void set_storage_options(const StorageOptions& options);
+
   // Collects the metadata needed for |lookup_key| from the cache, then calls
   // |supplied|. If the metadata needed isn't found in the cache, it will call
-  // the callback with status false.
+  // the callback with status false. The rules passed to |supplied| remain valid
+  // until it returns.
   virtual void Supply(const LookupKey& lookup_key,
                       const Supplier::Callback& supplied);
 
@@ -71,28 +130,96 @@ class PreloadSupplier : public Supplier {
   // size is 10 kB. The largest is 250 kB.)
   //
   // If the rules are already in progress of being loaded, it does nothing.
-  // Calls |loaded| when the loading has finished.
+  // Calls |loaded| when the loading has finished. A region that isn't in
+  // RegionDataConstants::GetRegionCodes() has no rules to load, so it's always
+  // loaded, and |loaded| is called right away.
   void LoadRules(const std::string& region_code, const Callback& loaded);
 
+  // Loads the rules for all regions that are neither loaded nor in progress of
+  // being loaded, and calls |loaded| when done, with |success| set to false if
+  // loading failed for any of them.
+  //
+  // The data for all regions is retrieved from the calling thread, as Source
+  // and Storage implementations needn't be thread-safe, with a single call to
+  // Storage::GetMulti() and Source::GetMulti() each. Once all of it has
+  // been retrieved, it's parsed and indexed by |num_threads| worker threads,
+  // which is most of the work, and all regions are then published at once.
+  // If |num_threads| is zero, then that is done by the thread that retrieved
+  // the data last.
+  void LoadAllRules(size_t num_threads, const LoadAllCallback& loaded);
+
+  // Loads the address metadata for |region_code| again, even if it's already
+  // loaded, and replaces the old rules with it when done. Readers keep seeing
+  // the old rules until then. The data is got from the source even if storage
+  // has fresh data for it. If that fails, the data in storage is used, and if
+  // there is none, the old rules are kept.
+  //
+  // If the rules are already in progress of being loaded, it does nothing.
+  // Calls |loaded| when the loading has finished. The old rules are deleted
+  // once no ReadSection that could have seen them remains, which can be after
+  // that, by the thread that leaves the last such ReadSection.
+  void ReloadRules(const std::string& region_code, const Callback& loaded);
+
+  // Writes the rules of all loaded regions, together with the indexes built
+  // for looking them up by name, to |snapshot| in a versioned binary format.
+  void SaveSnapshot(std::string* snapshot) const;
+
+  // Loads the rules of all regions in the |size| bytes at |data|, which must
+  // have been written by SaveSnapshot() of the same version of this library,
+  // and replaces the rules already loaded for these regions, like
+  // ReloadRules() does. Returns false, without loading anything, if the data
+  // isn't a valid snapshot.
+  //
+  // This is much faster than LoadRules(), as no JSON is parsed and no index is
+  // rebuilt, and RE2 objects are compiled only when first needed. The |data|
+  // can be a memory mapped snapshot file, and isn't used after this returns.
+  bool LoadSnapshot(const char* data, size_t size);
+
+  // Returns a number that is incremented every time the rules for
+  // |region_code| are replaced, or 0 if they haven't been loaded.
+  virtual int GetRulesGeneration(const std::string& region_code) const;
+
   // Returns a mapping of lookup keys to rules. Should be called only when
-  // IsLoaded() returns true for the |region_code|.
+  // IsLoaded() returns true for the |region_code|. If rules can be reloaded,
+  // the result must only be used inside a ReadSection.
   const std::map<std::string, const Rule*>& GetRulesForRegion(
       const std::string& region_code) const;
 
   bool IsLoaded(const std::string& region_code) const;
   bool IsPending(const std::string& region_code) const;
 
- private:
+  // Collects the metadata needed for |lookup_key| from the cache into
+  // |hierarchy|, the same way as Supply() but without calling any callback.
+  // Returns false if the metadata needed isn't found in the cache.
   bool GetRuleHierarchy(const LookupKey& lookup_key,
                         RuleHierarchy* hierarchy) const;
-  bool IsLoadedKey(const std::string& key) const;
+
+ private:
+  // Returns the published rules of |region_code|, or NULL if not loaded. Must
+  // be called from inside a ReadSection.
+  const RegionRules* GetRegionRules(const std::string& region_code) const;
+
+  // Starts loading the rules for |region_code|. The |key| must already have
+  // been added to |pending_|. If |reload| is true, then the data is got from
+  // the source even if it's fresh in storage.
+  void StartLoading(const std::string& region_code,
+                    const std::string& key,
+                    bool reload,
+                    const Callback& loaded);
+
   bool IsPendingKey(const std::string& key) const;
 
-  const scoped_ptr<const Retriever> retriever_;
+  const scoped_ptr<Retriever> retriever_;
+  const scoped_ptr<ReadCopyUpdate> rcu_;
+  const scoped_ptr<Mutex> mutex_;  // Guards |pending_|.
   std::set<std::string> pending_;
-  const scoped_ptr<IndexMap> rule_index_;
-  std::vector<const Rule*> rule_storage_;
-  std::map<std::string, std::map<std::string, const Rule*> > region_rules_;
+
+  // The rules of each region of RegionDataConstants::GetRegionCodes(), at the
+  // same index, or NULL if not loaded. The vector itself is never resized, but
+  // its elements are set by the thread that loads the rules and read by any
+  // thread, so they must only be accessed through ReleaseStore() and
+  // AcquireLoad().
+  std::vector<const RegionRules*> region_rules_;
 
   DISALLOW_COPY_AND_ASSIGN(PreloadSupplier);
 };
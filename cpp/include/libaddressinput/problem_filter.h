@@ -0,0 +1,69 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A compiled form of the FieldProblemMap filter that is used to select which
+// validation problems to report.
+
+#ifndef I18N_ADDRESSINPUT_PROBLEM_FILTER_H_
+#define I18N_ADDRESSINPUT_PROBLEM_FILTER_H_
+
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/validation_result.h>
+
+namespace i18n {
+namespace addressinput {
+
+// Answers whether a (field, problem) pair should be reported, using bit masks
+// that are computed once when the ProblemFilter object is constructed, instead
+// of searching the FieldProblemMap every time. Sample usage:
+//    FieldProblemMap filter;
+//    filter.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+//    ProblemFilter problem_filter(&filter);
+//    ... Use problem_filter for validating any number of addresses ...
+class ProblemFilter {
+ public:
+  // Creates a filter that lets all problems through.
+  ProblemFilter();
+
+  // Creates a filter that lets through only the pairs in |filter|. A NULL or
+  // empty |filter| lets all problems through, the same way as for
+  // AddressValidator::Validate(). Doesn't keep a reference to |filter|.
+  explicit ProblemFilter(const FieldProblemMap* filter);
+
+  // Returns whether (|field|,|problem|) should be reported.
+  bool ShouldReport(AddressField field, AddressProblem problem) const {
+    return all_ || pairs_.Contains(field, problem);
+  }
+
+  // Returns whether |problem| should be reported for any field. A check for a
+  // problem can be skipped entirely if this returns false.
+  bool ShouldReportAny(AddressProblem problem) const {
+    return all_ || (problems_ & (1 << problem)) != 0;
+  }
+
+  // Returns the pairs to report, or no pairs if all problems are reported.
+  const ValidationResult& pairs() const { return pairs_; }
+
+ private:
+  bool all_;
+  ValidationResult pairs_;
+  int problems_;  // Bit mask of the problems of all pairs in |pairs_|.
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_PROBLEM_FILTER_H_
@@ -22,6 +22,7 @@
 #include <libaddressinput/callback.h>
 
 #include <string>
+#include <vector>
 
 namespace i18n {
 namespace addressinput {
@@ -48,6 +49,18 @@ class Source {
   // Gets metadata for |key| and invokes the |data_ready| callback.
   virtual void Get(const std::string& key,
                    const Callback& data_ready) const = 0;
+
+  // Gets metadata for each of the |keys| and invokes the |data_ready| callback
+  // once for each of them, in any order. The default implementation calls
+  // Get() for each key. Override it to get the metadata for several keys at
+  // once, for example in a single request to a server.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const {
+    for (std::vector<std::string>::const_iterator it = keys.begin();
+         it != keys.end(); ++it) {
+      Get(*it, data_ready);
+    }
+  }
 };
 
 }  // namespace addressinput
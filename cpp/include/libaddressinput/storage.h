@@ -20,11 +20,30 @@
 
 #include <libaddressinput/callback.h>
 
+#include <ctime>
 #include <string>
+#include <vector>
 
 namespace i18n {
 namespace addressinput {
 
+// How the suppliers use the address metadata in Storage. Data that is older
+// than |max_age| seconds is stale, and is retrieved anew from the Source. If
+// that fails, the stale data is used this one time.
+//
+// With |stale_while_revalidate| set, stale data is instead used right away,
+// while it's retrieved anew from the Source in the background, to replace the
+// stale data in Storage for later use. This keeps the latency from increasing
+// when data becomes stale, at the cost of using stale data one more time.
+struct StorageOptions {
+  StorageOptions()
+      : max_age(30 * 24 * 60 * 60),  // One month.
+        stale_while_revalidate(false) {}
+
+  time_t max_age;
+  bool stale_while_revalidate;
+};
+
 // Stores address metadata. The data must be allocated on the heap, passing
 // ownership to the called function. Sample usage:
 //
@@ -56,6 +75,18 @@ class Storage {
   // Retrieves the data for |key| and invokes the |data_ready| callback.
   virtual void Get(const std::string& key,
                    const Callback& data_ready) const = 0;
+
+  // Retrieves the data for each of the |keys| and invokes the |data_ready|
+  // callback once for each of them, in any order. The default implementation
+  // calls Get() for each key. Override it to retrieve the data for several
+  // keys at once, for example in a single request to a cache server.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const {
+    for (std::vector<std::string>::const_iterator it = keys.begin();
+         it != keys.end(); ++it) {
+      Get(*it, data_ready);
+    }
+  }
 };
 
 }  // namespace addressinput
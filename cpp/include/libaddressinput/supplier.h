@@ -17,6 +17,8 @@
 
 #include <libaddressinput/callback.h>
 
+#include <string>
+
 namespace i18n {
 namespace addressinput {
 
@@ -40,6 +42,14 @@ class Supplier {
   virtual void Supply(const LookupKey& lookup_key,
                       const Callback& supplied) = 0;
 
+  // Returns a number that changes whenever the rules for |region_code| are
+  // replaced, so that results computed with the old rules can be told apart
+  // from results computed with the new ones. Implementations that never
+  // replace rules once supplied can keep this default, which returns 0.
+  virtual int GetRulesGeneration(const std::string& region_code) const {
+    return 0;
+  }
+
   // A RuleHierarchy object encapsulates the hierarchical list of Rule objects
   // that corresponds to a particular LookupKey.
   struct RuleHierarchy {
@@ -0,0 +1,134 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A wrapper object for Storage that keeps the most recently used data in
+// memory, in front of slower storage.
+
+#ifndef I18N_ADDRESSINPUT_TIERED_STORAGE_H_
+#define I18N_ADDRESSINPUT_TIERED_STORAGE_H_
+
+#include <libaddressinput/storage.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+class Mutex;
+
+// Wraps Storage with a bounded in-memory tier. Sample usage:
+//    OndemandSupplier supplier(
+//        new MySource,
+//        new TieredStorage(new FileStorage("/var/cache/addressinput"),
+//                          4 * 1024 * 1024));
+//
+// Data that is put is written through to the wrapped storage, and kept in
+// memory. Data that is got from the wrapped storage is promoted to memory, so
+// that getting it again doesn't touch the wrapped storage. When the data in
+// memory takes more than the memory budget, the least recently used data is
+// dropped from memory, but stays in the wrapped storage.
+//
+// The wrapped storage can call back on any thread.
+class TieredStorage : public Storage {
+ public:
+  // Takes ownership of |storage|. Keeps at most |max_memory_bytes| of data in
+  // memory.
+  TieredStorage(Storage* storage, size_t max_memory_bytes);
+  virtual ~TieredStorage();
+
+  // Storage implementation.
+  virtual void Put(const std::string& key, std::string* data);
+
+  // Storage implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const;
+
+  // Storage implementation. Same as Get(), for each of the |keys|. The keys
+  // not found in memory are got from the wrapped storage all at once.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const;
+
+  // Returns the number of keys for which data is kept in memory.
+  size_t memory_size() const;
+
+  // Returns the estimated memory used by the data kept in memory.
+  size_t memory_bytes() const;
+
+  // Returns the number of keys found in memory.
+  size_t memory_hits() const;
+
+  // Returns the number of keys not found in memory, but in the wrapped
+  // storage.
+  size_t storage_hits() const;
+
+  // Returns the number of keys found in neither.
+  size_t misses() const;
+
+ private:
+  class Helper;
+
+  struct Entry {
+    std::string data;
+    size_t bytes;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  // Returns a copy of the data for |key| kept in memory, and marks it as the
+  // most recently used, or returns NULL if it's not in memory. The caller owns
+  // the result.
+  std::string* GetFromMemory(const std::string& key) const;
+
+  // Keeps a copy of |data| for |key| in memory, as the most recently used
+  // data, and drops the least recently used data if over budget. Replaces
+  // data already kept for |key| only if |replace| is true.
+  void PutInMemory(const std::string& key,
+                   const std::string& data,
+                   bool replace) const;
+
+  // Counts the result of getting |key| from the wrapped storage, and promotes
+  // |data| to memory if it was found.
+  void OnStorageResult(bool success,
+                       const std::string& key,
+                       const std::string* data) const;
+
+  // The storage being wrapped.
+  scoped_ptr<Storage> wrapped_storage_;
+
+  const size_t max_memory_bytes_;
+
+  // Guards everything below.
+  const scoped_ptr<Mutex> mutex_;
+
+  // The keys of the data in memory, the most recently used first, and the
+  // data itself.
+  mutable std::list<std::string> lru_;
+  mutable std::map<std::string, Entry> memory_;
+  mutable size_t memory_bytes_;
+
+  mutable size_t memory_hits_;
+  mutable size_t storage_hits_;
+  mutable size_t misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(TieredStorage);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_TIERED_STORAGE_H_
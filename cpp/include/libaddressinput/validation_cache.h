@@ -0,0 +1,149 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A cache of validation results, for validating the same addresses over and
+// over again.
+
+#ifndef I18N_ADDRESSINPUT_VALIDATION_CACHE_H_
+#define I18N_ADDRESSINPUT_VALIDATION_CACHE_H_
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/validation_result.h>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+
+namespace i18n {
+namespace addressinput {
+
+// Keeps the validation problems of up to a fixed number of addresses, evicting
+// the least recently used entries when full. An entry is looked up by a 64-bit
+// hash of all fields of the address together with the validation options, and
+// the address is then compared in full, so a hash collision can't return the
+// problems of another address. Sample usage:
+//    ValidationCache cache(10000);
+//    AddressValidator validator(&supplier, &cache);
+//    ... Validate addresses; repeated addresses are answered from the cache ...
+//
+// Each entry also keeps the Supplier::GetRulesGeneration() of the rules that
+// the address was validated with. When the supplier replaces the rules for a
+// region, as PreloadSupplier::ReloadRules() does, the entries validated with
+// the old rules are then misses, and are removed when looked up. Entries can
+// also be removed right away with InvalidateRegion(). Not thread-safe.
+class ValidationCache {
+ public:
+  // Keeps at most |max_entries| entries, which must be greater than zero.
+  explicit ValidationCache(size_t max_entries);
+  ~ValidationCache();
+
+  // Looks up the problems found when validating |address| with the same
+  // options, as used for AddressValidator::Validate(), and with rules of the
+  // same |rules_generation|. On a hit, writes them into |result| and returns
+  // true. Returns false on a miss.
+  bool Lookup(const AddressData& address,
+              bool allow_postal,
+              bool require_name,
+              const FieldProblemMap* filter,
+              int rules_generation,
+              ValidationResult* result);
+
+  // Stores the |result| of validating |address| with these options and with
+  // rules of |rules_generation|, replacing any previous entry for the same
+  // address and options.
+  void Insert(const AddressData& address,
+              bool allow_postal,
+              bool require_name,
+              const FieldProblemMap* filter,
+              int rules_generation,
+              const ValidationResult& result);
+
+  // Same as above, but with the options as used for the overload of
+  // AddressValidator::Validate() that takes ValidationOptions. An address has
+  // the same entry with a ProblemFilter as with the FieldProblemMap that the
+  // ProblemFilter was built from.
+  bool Lookup(const AddressData& address,
+              const ValidationOptions& options,
+              int rules_generation,
+              ValidationResult* result);
+  void Insert(const AddressData& address,
+              const ValidationOptions& options,
+              int rules_generation,
+              const ValidationResult& result);
+
+  // Removes all entries of addresses in |region_code|.
+  void InvalidateRegion(const std::string& region_code);
+
+  // Removes all entries.
+  void Clear();
+
+  size_t size() const { return index_.size(); }
+
+  // The number of calls to Lookup() that returned true and false.
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    uint64 hash;
+    AddressData address;
+    int options;
+    ValidationResult filter;
+    int rules_generation;
+    ValidationResult result;
+  };
+
+  // Least recently used entry first.
+  typedef std::list<Entry> EntryList;
+
+  // Entries with colliding hashes are all kept in the index.
+  typedef std::multimap<uint64, EntryList::iterator> Index;
+
+  // Implement Lookup() and Insert(), with the options as a bit mask and a
+  // |filter| that is empty if all problems are reported.
+  bool LookupEntry(const AddressData& address,
+                   int options,
+                   const ValidationResult& filter,
+                   int rules_generation,
+                   ValidationResult* result);
+  void InsertEntry(const AddressData& address,
+                   int options,
+                   const ValidationResult& filter,
+                   int rules_generation,
+                   const ValidationResult& result);
+
+  // Returns the entry for the key, or entries_.end() if there is none.
+  EntryList::iterator Find(uint64 hash,
+                           const AddressData& address,
+                           int options,
+                           const ValidationResult& filter);
+
+  void Erase(EntryList::iterator entry);
+
+  const size_t max_entries_;
+  EntryList entries_;
+  Index index_;
+  size_t hits_;
+  size_t misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(ValidationCache);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_VALIDATION_CACHE_H_
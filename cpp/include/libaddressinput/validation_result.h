@@ -0,0 +1,126 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A compact set of validation problems, which can be used instead of a
+// FieldProblemMap where allocating memory for every problem found would be too
+// expensive.
+
+#ifndef I18N_ADDRESSINPUT_VALIDATION_RESULT_H_
+#define I18N_ADDRESSINPUT_VALIDATION_RESULT_H_
+
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/util/basictypes.h>
+
+#include <cstddef>
+#include <utility>
+
+namespace i18n {
+namespace addressinput {
+
+// Stores a set of (AddressField, AddressProblem) pairs as a bit mask. Copying
+// a ValidationResult object is as cheap as copying an integer. Sample usage:
+//    ValidationResult result;
+//    result.Add(POSTAL_CODE, INVALID_FORMAT);
+//    for (ValidationResult::const_iterator it = result.begin();
+//         it != result.end(); ++it) {
+//      Process(it->first, it->second);
+//    }
+//
+// Iterating over the pairs visits them ordered by field and then by problem,
+// which is the same order as they get in a FieldProblemMap when inserted by
+// AddressValidator.
+class ValidationResult {
+ public:
+  typedef std::pair<AddressField, AddressProblem> value_type;
+
+  class const_iterator {
+   public:
+    const_iterator(uint64 bits, size_t bit);
+
+    const value_type& operator*() const { return value_; }
+    const value_type* operator->() const { return &value_; }
+    const_iterator& operator++();
+    bool operator==(const const_iterator& other) const {
+      return bit_ == other.bit_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return bit_ != other.bit_;
+    }
+
+   private:
+    // Moves |bit_| forward to the next set bit, or to the end.
+    void SkipUnset();
+
+    uint64 bits_;
+    size_t bit_;
+    value_type value_;
+  };
+
+  ValidationResult() : bits_(0) {}
+
+  // Creates a ValidationResult object with all pairs in |problems|.
+  explicit ValidationResult(const FieldProblemMap& problems);
+
+  bool empty() const { return bits_ == 0; }
+  size_t size() const;
+  void clear() { bits_ = 0; }
+
+  void Add(AddressField field, AddressProblem problem) {
+    bits_ |= Bit(field, problem);
+  }
+
+  bool Contains(AddressField field, AddressProblem problem) const {
+    return (bits_ & Bit(field, problem)) != 0;
+  }
+
+  // Removes all pairs for |field|.
+  void ClearField(AddressField field) {
+    bits_ &= ~(FieldBits() << (field * kBitsPerField));
+  }
+
+  const_iterator begin() const { return const_iterator(bits_, 0); }
+  const_iterator end() const { return const_iterator(bits_, kNumBits); }
+
+  // Clears |problems| and then inserts all pairs of this object into it.
+  void ToFieldProblemMap(FieldProblemMap* problems) const;
+
+  bool operator==(const ValidationResult& other) const {
+    return bits_ == other.bits_;
+  }
+  bool operator!=(const ValidationResult& other) const {
+    return bits_ != other.bits_;
+  }
+
+ private:
+  // Each field has a group of kBitsPerField bits, one for each problem.
+  static const size_t kBitsPerField = 8;
+  static const size_t kNumBits = 64;
+
+  static uint64 Bit(AddressField field, AddressProblem problem) {
+    return static_cast<uint64>(1) << (field * kBitsPerField + problem);
+  }
+
+  static uint64 FieldBits() {
+    return (static_cast<uint64>(1) << kBitsPerField) - 1;
+  }
+
+  uint64 bits_;
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_VALIDATION_RESULT_H_
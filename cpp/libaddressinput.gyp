@@ -38,6 +38,18 @@
           # https://code.google.com/p/gyp/issues/detail?id=374
           'cflags': ['-fPIC'],
         }],
+        ['OS == "linux"', {
+          # Used by util/mutex.h and util/thread_pool.cc.
+          'link_settings': {
+            'libraries': ['-lpthread'],
+          },
+        }],
+        ['OS == "win"', {
+          # FileStorage uses POSIX file APIs and mmap().
+          'sources!': [
+            'src/file_storage.cc',
+          ],
+        }],
       ],
     },
     {
@@ -57,6 +69,11 @@
         'gtest.gyp:main',
       ],
       'conditions': [
+        ['OS == "win"', {
+          'sources!': [
+            'test/file_storage_test.cc',
+          ],
+        }],
         [ 'OS == "mac"', {
           'postbuilds': [
             {
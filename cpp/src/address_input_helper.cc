@@ -24,13 +24,11 @@
 #include <string>
 #include <vector>
 
-#include <re2/re2.h>
-
 #include "language.h"
 #include "lookup_key.h"
+#include "postal_code_matcher.h"
 #include "region_data_constants.h"
 #include "rule.h"
-#include "util/re2ptr.h"
 
 namespace i18n {
 namespace addressinput {
@@ -114,6 +112,7 @@ void AddressInputHelper::FillAddress(AddressData* address) const {
     return;
   }
 
+  PreloadSupplier::ReadSection section(*supplier_);
   AddressData lookup_key_address;
   lookup_key_address.region_code = region_code;
   // First try and fill in the postal code if it is missing.
@@ -124,7 +123,8 @@ void AddressInputHelper::FillAddress(AddressData* address) const {
   // method must have called LoadRules() first, so we check this here.
   assert(region_rule != NULL);
 
-  const RE2ptr* postal_code_reg_exp = region_rule->GetPostalCodeMatcher();
+  const PostalCodeMatcher* postal_code_reg_exp =
+      region_rule->GetPostalCodeMatcher();
   if (postal_code_reg_exp != NULL) {
     if (address->postal_code.empty()) {
       address->postal_code = region_rule->GetSolePostalCode();
@@ -134,7 +134,7 @@ void AddressInputHelper::FillAddress(AddressData* address) const {
     // hierarchy that matches the postal code. Note that the postal code might
     // have been added in the previous check.
     if (!address->postal_code.empty() &&
-        RE2::FullMatch(address->postal_code, *postal_code_reg_exp->ptr)) {
+        postal_code_reg_exp->FullMatch(address->postal_code)) {
 
       // This hierarchy is used to store rules that represent possible matches
       // at each level of the hierarchy.
@@ -158,9 +158,9 @@ void AddressInputHelper::CheckChildrenForPostCodeMatches(
   const Rule* rule = supplier_->GetRule(lookup_key);
   assert(rule != NULL);
 
-  const RE2ptr* postal_code_prefix = rule->GetPostalCodeMatcher();
+  const PostalCodeMatcher* postal_code_prefix = rule->GetPostalCodeMatcher();
   if (postal_code_prefix == NULL ||
-      RE2::PartialMatch(address.postal_code, *postal_code_prefix->ptr)) {
+      postal_code_prefix->PrefixMatch(address.postal_code)) {
     // This was a match, so store it and its parent in the hierarchy.
     hierarchy[lookup_key.GetDepth()].push_back(Node());
     Node* node = &hierarchy[lookup_key.GetDepth()].back();
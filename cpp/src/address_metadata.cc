@@ -16,12 +16,9 @@
 
 #include <libaddressinput/address_field.h>
 
-#include <algorithm>
 #include <string>
 
-#include "format_element.h"
 #include "region_data_constants.h"
-#include "rule.h"
 
 namespace i18n {
 namespace addressinput {
@@ -30,34 +27,15 @@ bool IsFieldRequired(AddressField field, const std::string& region_code) {
   if (field == COUNTRY) {
     return true;
   }
-
-  Rule rule;
-  rule.CopyFrom(Rule::GetDefault());
-  if (!rule.ParseSerializedRule(
-          RegionDataConstants::GetRegionData(region_code))) {
-    return false;
-  }
-
-  return std::find(rule.GetRequired().begin(),
-                   rule.GetRequired().end(),
-                   field) != rule.GetRequired().end();
+  return
+      (RegionDataConstants::GetRequiredFields(region_code) & (1 << field)) != 0;
 }
 
 bool IsFieldUsed(AddressField field, const std::string& region_code) {
   if (field == COUNTRY) {
     return true;
   }
-
-  Rule rule;
-  rule.CopyFrom(Rule::GetDefault());
-  if (!rule.ParseSerializedRule(
-          RegionDataConstants::GetRegionData(region_code))) {
-    return false;
-  }
-
-  return std::find(rule.GetFormat().begin(),
-                   rule.GetFormat().end(),
-                   FormatElement(field)) != rule.GetFormat().end();
+  return (RegionDataConstants::GetUsedFields(region_code) & (1 << field)) != 0;
 }
 
 }  // namespace addressinput
@@ -41,6 +41,7 @@ AddressNormalizer::~AddressNormalizer() {}
 void AddressNormalizer::Normalize(AddressData* address) const {
   assert(address != NULL);
   assert(supplier_->IsLoaded(address->region_code));
+  PreloadSupplier::ReadSection section(*supplier_);
 
   AddressData region_address;
   region_address.region_code = address->region_code;
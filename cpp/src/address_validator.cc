@@ -14,16 +14,34 @@
 
 #include <libaddressinput/address_validator.h>
 
+#include <libaddressinput/preload_supplier.h>
+#include <libaddressinput/problem_filter.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/validation_cache.h>
+#include <libaddressinput/validation_result.h>
+
 #include <cassert>
 #include <cstddef>
+#include <vector>
 
+#include "batch_validation_task.h"
+#include "lookup_key.h"
 #include "validation_task.h"
 
 namespace i18n {
 namespace addressinput {
 
-AddressValidator::AddressValidator(Supplier* supplier) : supplier_(supplier) {
+AddressValidator::AddressValidator(Supplier* supplier)
+    : supplier_(supplier),
+      cache_(NULL) {
+  assert(supplier_ != NULL);
+}
+
+AddressValidator::AddressValidator(Supplier* supplier, ValidationCache* cache)
+    : supplier_(supplier),
+      cache_(cache) {
   assert(supplier_ != NULL);
+  assert(cache_ != NULL);
 }
 
 AddressValidator::~AddressValidator() {
@@ -35,9 +53,51 @@ void AddressValidator::Validate(const AddressData& address,
                                 const FieldProblemMap* filter,
                                 FieldProblemMap* problems,
                                 const Callback& validated) const {
+  const ProblemFilter problem_filter(filter);
+  ValidationOptions options;
+  options.allow_postal = allow_postal;
+  options.require_name = require_name;
+  options.filter = &problem_filter;
+  Validate(address, options, problems, validated);
+}
+
+void AddressValidator::Validate(const AddressData& address,
+                                const ValidationOptions& options,
+                                FieldProblemMap* problems,
+                                const Callback& validated) const {
+  assert(problems != NULL);
+  ValidationResult result;
+  // Read before the rules are supplied, so that results are never cached as
+  // computed with rules newer than those actually used.
+  int rules_generation = cache_ != NULL
+      ? supplier_->GetRulesGeneration(address.region_code)
+      : 0;
+  if (cache_ != NULL &&
+      cache_->Lookup(address, options, rules_generation, &result)) {
+    result.ToFieldProblemMap(problems);
+    validated(true, address, *problems);
+    return;
+  }
+
   // The ValidationTask object will delete itself after Run() has finished.
   (new ValidationTask(
        address,
+       options,
+       cache_,
+       rules_generation,
+       problems,
+       validated))->Run(supplier_);
+}
+
+void AddressValidator::ValidateBatch(const std::vector<AddressData>& addresses,
+                                     bool allow_postal,
+                                     bool require_name,
+                                     const FieldProblemMap* filter,
+                                     std::vector<FieldProblemMap>* problems,
+                                     const Callback& validated) const {
+  // The BatchValidationTask object will delete itself after Run() has finished.
+  (new BatchValidationTask(
+       addresses,
        allow_postal,
        require_name,
        filter,
@@ -45,5 +105,27 @@ void AddressValidator::Validate(const AddressData& address,
        validated))->Run(supplier_);
 }
 
+// static
+bool AddressValidator::ValidateSync(const PreloadSupplier& supplier,
+                                    const AddressData& address,
+                                    const ValidationOptions& options,
+                                    ValidationResult* result) {
+  assert(result != NULL);
+  PreloadSupplier::ReadSection section(supplier);
+  LookupKey lookup_key;
+  lookup_key.FromAddress(address);
+  Supplier::RuleHierarchy hierarchy;
+  if (!supplier.GetRuleHierarchy(lookup_key, &hierarchy)) {
+    result->clear();
+    return false;
+  }
+  ValidationTask checker(
+      options.allow_postal,
+      options.require_name,
+      options.filter != NULL ? *options.filter : ProblemFilter());
+  checker.Check(address, hierarchy, result);
+  return true;
+}
+
 }  // namespace addressinput
 }  // namespace i18n
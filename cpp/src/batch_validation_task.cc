@@ -0,0 +1,131 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "batch_validation_task.h"
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/callback.h>
+#include <libaddressinput/problem_filter.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/util/basictypes.h>
+
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lookup_key.h"
+#include "region_data_constants.h"
+#include "validation_task.h"
+
+namespace i18n {
+namespace addressinput {
+
+BatchValidationTask::BatchValidationTask(
+    const std::vector<AddressData>& addresses,
+    bool allow_postal,
+    bool require_name,
+    const FieldProblemMap* filter,
+    std::vector<FieldProblemMap>* problems,
+    const AddressValidator::Callback& validated)
+    : addresses_(addresses),
+      problems_(problems),
+      validated_(validated),
+      supplied_(BuildCallback(this, &BatchValidationTask::Validate)),
+      checker_(allow_postal, require_name, ProblemFilter(filter)),
+      groups_(),
+      pending_(0) {
+  assert(problems_ != NULL);
+  assert(supplied_ != NULL);
+}
+
+BatchValidationTask::~BatchValidationTask() {
+  for (GroupMap::const_iterator it = groups_.begin();
+       it != groups_.end(); ++it) {
+    delete it->first;
+  }
+}
+
+void BatchValidationTask::Run(Supplier* supplier) {
+  assert(supplier != NULL);
+  problems_->resize(addresses_.size());
+
+  // Addresses that have the same lookup key string, up to the maximum depth for
+  // which there is any metadata for the region, will be validated using exactly
+  // the same RuleHierarchy, so only one LookupKey is created for each such
+  // group of addresses.
+  std::map<std::string, const LookupKey*> keys;
+  LookupKey lookup_key;
+  for (size_t i = 0; i < addresses_.size(); ++i) {
+    const AddressData& address = addresses_[i];
+    lookup_key.FromAddress(address);
+    const std::string& key = lookup_key.ToKeyString(
+        RegionDataConstants::GetMaxLookupKeyDepth(lookup_key.GetRegionCode()));
+
+    std::map<std::string, const LookupKey*>::iterator it = keys.find(key);
+    if (it == keys.end()) {
+      LookupKey* group_key = new LookupKey;
+      group_key->FromAddress(address);
+      it = keys.insert(std::make_pair(key, group_key)).first;
+    }
+    groups_[it->second].push_back(i);
+  }
+
+  pending_ = groups_.size();
+  if (pending_ == 0) {
+    delete this;
+    return;
+  }
+
+  // When the final group has been supplied, the supplied_ callback, implemented
+  // by Validate(), will finish by delete'ing this BatchValidationTask object,
+  // so the loop condition must not access any attributes of this object (cf.
+  // OndemandSupplyTask::Retrieve()).
+  bool done = false;
+  for (GroupMap::const_iterator it = groups_.begin(); !done; ) {
+    const LookupKey& group_key = *(it++)->first;
+    done = it == groups_.end();
+    supplier->Supply(group_key, *supplied_);
+  }
+}
+
+void BatchValidationTask::Validate(bool success,
+                                   const LookupKey& lookup_key,
+                                   const Supplier::RuleHierarchy& hierarchy) {
+  GroupMap::const_iterator group = groups_.find(&lookup_key);
+  assert(group != groups_.end());  // Sanity check.
+
+  for (std::vector<size_t>::const_iterator it = group->second.begin();
+       it != group->second.end(); ++it) {
+    const AddressData& address = addresses_[*it];
+    FieldProblemMap* problems = &(*problems_)[*it];
+    if (success) {
+      checker_.Check(address, hierarchy, problems);
+    } else {
+      problems->clear();
+    }
+    validated_(success, address, *problems);
+  }
+
+  assert(pending_ > 0);
+  if (--pending_ == 0) {
+    delete this;
+  }
+}
+
+}  // namespace addressinput
+}  // namespace i18n
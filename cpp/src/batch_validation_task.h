@@ -0,0 +1,83 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef I18N_ADDRESSINPUT_BATCH_VALIDATION_TASK_H_
+#define I18N_ADDRESSINPUT_BATCH_VALIDATION_TASK_H_
+
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "validation_task.h"
+
+namespace i18n {
+namespace addressinput {
+
+class LookupKey;
+struct AddressData;
+
+// A BatchValidationTask object encapsulates the information necessary to
+// perform validation of a list of addresses and call a callback for each one of
+// them when that has been done. Calling the Run() method will group the
+// addresses by the metadata needed to validate them, load that metadata once
+// for each group, then perform validation of all addresses in the group, call
+// the callback for each address and finally delete the BatchValidationTask
+// object itself.
+class BatchValidationTask {
+ public:
+  BatchValidationTask(const std::vector<AddressData>& addresses,
+                      bool allow_postal,
+                      bool require_name,
+                      const FieldProblemMap* filter,
+                      std::vector<FieldProblemMap>* problems,
+                      const AddressValidator::Callback& validated);
+
+  ~BatchValidationTask();
+
+  // Calls supplier->Supply() once for each group of addresses, with Validate()
+  // as callback.
+  void Run(Supplier* supplier);
+
+ private:
+  // Maps each distinct LookupKey to the indices of the addresses in
+  // |addresses_| that share the metadata described by that key.
+  typedef std::map<const LookupKey*, std::vector<size_t> > GroupMap;
+
+  // Uses the address metadata of |hierarchy| to validate all addresses in the
+  // group of |lookup_key|, calls the |validated_| callback for each of them and
+  // deletes this BatchValidationTask object after the final group is done.
+  void Validate(bool success,
+                const LookupKey& lookup_key,
+                const Supplier::RuleHierarchy& hierarchy);
+
+  const std::vector<AddressData>& addresses_;
+  std::vector<FieldProblemMap>* const problems_;
+  const AddressValidator::Callback& validated_;
+  const scoped_ptr<const Supplier::Callback> supplied_;
+  ValidationTask checker_;
+  GroupMap groups_;
+  size_t pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(BatchValidationTask);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_BATCH_VALIDATION_TASK_H_
@@ -0,0 +1,151 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// CompressingStorage stores data in this format:
+//
+//    <version> <size> <compressed data>
+//
+// The version is a single byte, currently 1, which uncompressed address
+// metadata never starts with. The size is the size of the uncompressed data,
+// as 4 bytes, little-endian.
+
+#include <libaddressinput/compressing_storage.h>
+
+#include <libaddressinput/callback.h>
+#include <libaddressinput/storage.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "util/compression.h"
+
+namespace i18n {
+namespace addressinput {
+
+namespace {
+
+const char kVersion = '\x01';
+const size_t kHeaderSize = 5;
+
+// Nothing decompresses to more than this many times its compressed size.
+const size_t kMaxCompressionRatio = 255;
+
+// Returns the decompressed |data|, or NULL if it's corrupted. Returns |data|
+// itself if it isn't compressed.
+std::string* Decompress(std::string* data) {
+  assert(data != NULL);
+  if (data->empty() || (*data)[0] != kVersion) {
+    return data;
+  }
+  if (data->size() < kHeaderSize) {
+    delete data;
+    return NULL;
+  }
+  size_t size = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    size |= static_cast<size_t>(static_cast<unsigned char>((*data)[1 + i]))
+        << (8 * i);
+  }
+  size_t compressed_size = data->size() - kHeaderSize;
+  std::string* decompressed = NULL;
+  if (size / kMaxCompressionRatio <= compressed_size) {
+    decompressed = new std::string(size, '\0');
+    if (!DecompressBlock(data->data() + kHeaderSize, compressed_size,
+                         size > 0 ? &(*decompressed)[0] : NULL, size)) {
+      delete decompressed;
+      decompressed = NULL;
+    }
+  }
+  delete data;
+  return decompressed;
+}
+
+class Helper {
+ public:
+  Helper(const std::vector<std::string>& keys,
+         const CompressingStorage::Callback& data_ready,
+         const Storage& wrapped_storage)
+      : data_ready_(data_ready),
+        remaining_(keys.size()),
+        wrapped_data_ready_(BuildCallback(this, &Helper::OnWrappedDataReady)) {
+    assert(!keys.empty());
+    wrapped_storage.GetMulti(keys, *wrapped_data_ready_);
+  }
+
+ private:
+  ~Helper() {}
+
+  void OnWrappedDataReady(bool success,
+                          const std::string& key,
+                          std::string* data) {
+    if (success) {
+      assert(data != NULL);
+      data = Decompress(data);
+      success = data != NULL;
+    } else {
+      delete data;
+      data = NULL;
+    }
+    data_ready_(success, key, data);
+    if (--remaining_ == 0) {
+      delete this;
+    }
+  }
+
+  const Storage::Callback& data_ready_;
+  size_t remaining_;  // The number of keys not yet ready.
+  const scoped_ptr<const Storage::Callback> wrapped_data_ready_;
+
+  DISALLOW_COPY_AND_ASSIGN(Helper);
+};
+
+}  // namespace
+
+CompressingStorage::CompressingStorage(Storage* storage)
+    : wrapped_storage_(storage) {
+  assert(wrapped_storage_ != NULL);
+}
+
+CompressingStorage::~CompressingStorage() {}
+
+void CompressingStorage::Put(const std::string& key, std::string* data) {
+  assert(data != NULL);
+  assert(data->size() <= kuint32max);
+  std::string* compressed = new std::string(1, kVersion);
+  for (size_t i = 0; i < 4; ++i) {
+    compressed->push_back(static_cast<char>((data->size() >> (8 * i)) & 0xff));
+  }
+  CompressBlock(data->data(), data->size(), compressed);
+  delete data;
+  wrapped_storage_->Put(key, compressed);
+}
+
+void CompressingStorage::Get(const std::string& key,
+                             const Callback& data_ready) const {
+  new Helper(std::vector<std::string>(1, key), data_ready, *wrapped_storage_);
+}
+
+void CompressingStorage::GetMulti(const std::vector<std::string>& keys,
+                                  const Callback& data_ready) const {
+  if (!keys.empty()) {
+    new Helper(keys, data_ready, *wrapped_storage_);
+  }
+}
+
+}  // namespace addressinput
+}  // namespace i18n
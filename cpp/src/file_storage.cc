@@ -0,0 +1,170 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// The name of the file for a key is the key with all characters other than
+// ASCII letters, digits, '-' and '_' escaped as %XX, so "data/CA/AB--fr" is
+// stored in "data%2FCA%2FAB--fr". Keys for which that would be too long for a
+// file name are stored in "md5-<MD5 of key>" instead. Temporary files have a
+// '.' in their names, which no other files have.
+
+#include <libaddressinput/file_storage.h>
+
+#include <libaddressinput/storage.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "util/atomic.h"
+#include "util/md5.h"
+
+namespace i18n {
+namespace addressinput {
+
+namespace {
+
+// Most file systems allow at most 255 bytes, leaving room for the suffix of
+// temporary file names.
+const size_t kMaxFileNameLength = 200;
+
+const char kMd5Prefix[] = "md5-";
+
+bool IsPlain(char c) {
+  return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') ||
+         ('0' <= c && c <= '9') || c == '-' || c == '_';
+}
+
+std::string EscapeKey(const std::string& key) {
+  static const char kHexDigits[] = "0123456789ABCDEF";
+  std::string name;
+  name.reserve(key.size());
+  for (std::string::const_iterator it = key.begin(); it != key.end(); ++it) {
+    if (IsPlain(*it)) {
+      name.push_back(*it);
+    } else {
+      unsigned char c = static_cast<unsigned char>(*it);
+      name.push_back('%');
+      name.push_back(kHexDigits[c >> 4]);
+      name.push_back(kHexDigits[c & 0xf]);
+    }
+  }
+  return name;
+}
+
+// Writes all of |data| to |fd|. Returns false on failure.
+bool WriteAll(int fd, const std::string& data) {
+  const char* buffer = data.data();
+  size_t remaining = data.size();
+  while (remaining > 0) {
+    ssize_t written = write(fd, buffer, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    buffer += written;
+    remaining -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+// Reads the whole file |fd| into |data|, through a memory mapping. Returns
+// false on failure.
+bool ReadAll(int fd, std::string* data) {
+  assert(data != NULL);
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    return false;
+  }
+  if (status.st_size == 0) {
+    data->clear();
+    return true;  // An empty file can't be mapped.
+  }
+  size_t size = static_cast<size_t>(status.st_size);
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  data->assign(static_cast<const char*>(mapping), size);
+  munmap(mapping, size);
+  return true;
+}
+
+}  // namespace
+
+FileStorage::FileStorage(const std::string& directory)
+    : directory_(directory),
+      temp_files_(0) {
+  assert(!directory_.empty());
+  mkdir(directory_.c_str(), 0755);  // Fails harmlessly if it already exists.
+}
+
+FileStorage::~FileStorage() {
+}
+
+void FileStorage::Put(const std::string& key, std::string* data) {
+  assert(data != NULL);
+  const std::string& path = GetPath(key);
+
+  // A name that is unique among all processes and threads using the directory.
+  char suffix[64];
+  std::sprintf(suffix, ".tmp-%ld-%d",
+               static_cast<long>(getpid()), AtomicAdd(&temp_files_, 1));
+  const std::string& temp_path = path + suffix;
+
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd >= 0) {
+    bool success = WriteAll(fd, *data);
+    success = close(fd) == 0 && success;
+    if (!success || rename(temp_path.c_str(), path.c_str()) != 0) {
+      unlink(temp_path.c_str());
+    }
+  }
+  delete data;
+}
+
+void FileStorage::Get(const std::string& key,
+                      const Callback& data_ready) const {
+  std::string* data = NULL;
+  int fd = open(GetPath(key).c_str(), O_RDONLY);
+  if (fd >= 0) {
+    data = new std::string;
+    if (!ReadAll(fd, data)) {
+      delete data;
+      data = NULL;
+    }
+    close(fd);
+  }
+  data_ready(data != NULL, key, data);
+}
+
+std::string FileStorage::GetPath(const std::string& key) const {
+  std::string name = EscapeKey(key);
+  if (name.size() > kMaxFileNameLength) {
+    name = kMd5Prefix + MD5String(key);
+  }
+  return directory_ + '/' + name;
+}
+
+}  // namespace addressinput
+}  // namespace i18n
@@ -0,0 +1,133 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/incremental_validator.h>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/preload_supplier.h>
+#include <libaddressinput/problem_filter.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/util/basictypes.h>
+
+#include <cassert>
+#include <cstddef>
+
+#include "lookup_key.h"
+#include "validation_task.h"
+
+namespace i18n {
+namespace addressinput {
+
+namespace {
+
+// Returns the bit mask of the fields whose problems depend on which rules the
+// metadata hierarchy contains, apart from the country rule.
+int GetHierarchyDependentFields() {
+  int fields = 1 << POSTAL_CODE;
+  for (size_t depth = 1; depth < arraysize(LookupKey::kHierarchy); ++depth) {
+    fields |= 1 << LookupKey::kHierarchy[depth];
+  }
+  return fields;
+}
+
+bool IsLookupKeyField(AddressField field) {
+  for (size_t depth = 0; depth < arraysize(LookupKey::kHierarchy); ++depth) {
+    if (LookupKey::kHierarchy[depth] == field) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SameRules(const Supplier::RuleHierarchy& a,
+               const Supplier::RuleHierarchy& b) {
+  for (size_t depth = 0; depth < arraysize(a.rule); ++depth) {
+    if (a.rule[depth] != b.rule[depth]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+IncrementalValidator::IncrementalValidator(const PreloadSupplier* supplier,
+                                           const ValidationOptions& options)
+    : supplier_(supplier),
+      checker_(new ValidationTask(
+          options.allow_postal,
+          options.require_name,
+          options.filter != NULL ? *options.filter : ProblemFilter())),
+      hierarchy_(),
+      generation_(0),
+      result_(),
+      validated_(false) {
+  assert(supplier_ != NULL);
+}
+
+IncrementalValidator::~IncrementalValidator() {}
+
+bool IncrementalValidator::Validate(const AddressData& address) {
+  PreloadSupplier::ReadSection section(*supplier_);
+  // Get the generation before the rules, so that if the rules are reloaded in
+  // between, the next Update() sees the new generation and starts over.
+  generation_ = supplier_->GetRulesGeneration(address.region_code);
+  LookupKey lookup_key;
+  lookup_key.FromAddress(address);
+  hierarchy_ = Supplier::RuleHierarchy();
+  validated_ = supplier_->GetRuleHierarchy(lookup_key, &hierarchy_);
+  if (!validated_) {
+    result_.clear();
+    return false;
+  }
+  checker_->Check(address, hierarchy_, &result_);
+  return true;
+}
+
+bool IncrementalValidator::Update(const AddressData& address,
+                                  AddressField changed_field) {
+  PreloadSupplier::ReadSection section(*supplier_);
+
+  // If the rules have been reloaded, then |hierarchy_| may point to deleted
+  // rules. Otherwise the ReadSection keeps them from being deleted.
+  if (!validated_ || changed_field == COUNTRY ||
+      supplier_->GetRulesGeneration(address.region_code) != generation_) {
+    return Validate(address);
+  }
+
+  int fields = 1 << changed_field;
+
+  if (IsLookupKeyField(changed_field)) {
+    LookupKey lookup_key;
+    lookup_key.FromAddress(address);
+    Supplier::RuleHierarchy hierarchy;
+    validated_ = supplier_->GetRuleHierarchy(lookup_key, &hierarchy);
+    if (!validated_) {
+      result_.clear();
+      return false;
+    }
+    if (!SameRules(hierarchy, hierarchy_)) {
+      fields |= GetHierarchyDependentFields();
+      hierarchy_ = hierarchy;
+    }
+  }
+
+  checker_->CheckFields(address, hierarchy_, fields, &result_);
+  return true;
+}
+
+}  // namespace addressinput
+}  // namespace i18n
@@ -29,7 +29,6 @@
 
 #include "language.h"
 #include "region_data_constants.h"
-#include "rule.h"
 #include "util/cctype_tolower_equal.h"
 
 namespace i18n {
@@ -49,14 +48,8 @@ bool ShouldSetLanguageForKey(const std::string& language_tag,
   if (RegionDataConstants::GetMaxLookupKeyDepth(region_code) == 0) {
     return false;
   }
-  Rule rule;
-  rule.CopyFrom(Rule::GetDefault());
-  // TODO: Pre-parse the rules and have a map from region code to rule.
-  if (!rule.ParseSerializedRule(
-          RegionDataConstants::GetRegionData(region_code))) {
-    return false;
-  }
-  const std::vector<std::string>& languages = rule.GetLanguages();
+  const std::vector<std::string>& languages =
+      RegionDataConstants::GetLanguages(region_code);
   // Do not add the default language (we want "data/US", not "data/US--en").
   // (empty should not happen here because we have some sub-region data).
   if (languages.empty() || languages[0] == language_tag) {
@@ -14,10 +14,21 @@
 
 #include <libaddressinput/ondemand_supplier.h>
 
+#include <libaddressinput/callback.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
 #include <algorithm>
+#include <cassert>
 #include <cstddef>
+#include <ctime>
+#include <list>
 #include <map>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "lookup_key.h"
 #include "ondemand_supply_task.h"
@@ -28,33 +39,179 @@
 namespace i18n {
 namespace addressinput {
 
+namespace {
+
+const time_t kDefaultNegativeCacheTtl = 24 * 60 * 60;  // One day.
+
+// The number of keys remembered as missing, above which the expired keys are
+// forgotten.
+const size_t kMaxNegativeCacheSize = 1 << 14;
+
+// Separates the language tag from the rest of a key.
+const char kLanguageDelim[] = "--";
+
+}  // namespace
+
+// Calls the callback of a Supply() request, and then tells the supplier that
+// the request is done.
+class OndemandSupplier::Request {
+ public:
+  // Does not take ownership of its parameters.
+  Request(OndemandSupplier* supplier, const Callback& supplied)
+      : supplier_(supplier),
+        supplied_(supplied),
+        task_(NULL),
+        done_(BuildCallback(this, &Request::OnSupplied)) {
+    assert(supplier_ != NULL);
+    assert(done_ != NULL);
+  }
+
+  const Callback& done() const { return *done_; }
+  void set_task(const OndemandSupplyTask* task) { task_ = task; }
+
+ private:
+  ~Request() {}
+
+  void OnSupplied(bool success,
+                  const LookupKey& lookup_key,
+                  const RuleHierarchy& hierarchy) {
+    supplied_(success, lookup_key, hierarchy);
+    supplier_->OnRequestDone(task_);
+    delete this;
+  }
+
+  OndemandSupplier* const supplier_;
+  const Callback& supplied_;
+  const OndemandSupplyTask* task_;
+  const scoped_ptr<const Callback> done_;
+
+  DISALLOW_COPY_AND_ASSIGN(Request);
+};
+
+// Calls back the supplier when the rules for some keys have been prefetched.
+class OndemandSupplier::Prefetch {
+ public:
+  // Does not take ownership of |supplier|.
+  Prefetch(OndemandSupplier* supplier,
+           size_t levels,
+           size_t budget,
+           size_t max_key_depth)
+      : levels_(levels),
+        budget_(budget),
+        max_key_depth_(max_key_depth),
+        task_(NULL),
+        lookup_key_(),
+        supplier_(supplier),
+        done_(BuildCallback(this, &Prefetch::OnSupplied)) {
+    assert(supplier_ != NULL);
+    assert(done_ != NULL);
+  }
+
+  // A key that isn't used, as the rules are retrieved for no request.
+  const LookupKey& lookup_key() const { return lookup_key_; }
+  const Callback& done() const { return *done_; }
+  void set_task(const OndemandSupplyTask* task) { task_ = task; }
+
+  const size_t levels_;
+  const size_t budget_;
+  const size_t max_key_depth_;
+
+  // The task retrieving the rules, which exists until OnPrefetchDone() has
+  // returned.
+  const OndemandSupplyTask* task_;
+
+ private:
+  ~Prefetch() {}
+
+  void OnSupplied(bool success,
+                  const LookupKey& lookup_key,
+                  const RuleHierarchy& hierarchy) {
+    supplier_->OnPrefetchDone(*this);
+    delete this;
+  }
+
+  const LookupKey lookup_key_;
+  OndemandSupplier* const supplier_;
+  const scoped_ptr<const Callback> done_;
+
+  DISALLOW_COPY_AND_ASSIGN(Prefetch);
+};
+
 OndemandSupplier::OndemandSupplier(const Source* source, Storage* storage)
-    : retriever_(new Retriever(source, storage)) {
+    : retriever_(new Retriever(source, storage)),
+      rule_cache_(),
+      max_cache_bytes_(0),
+      lru_(),
+      cache_entries_(),
+      cache_bytes_(0),
+      evictions_(0),
+      negative_cache_(),
+      negative_cache_ttl_(kDefaultNegativeCacheTtl),
+      negative_cache_hits_(0),
+      in_flight_(),
+      prefetch_options_(),
+      prefetched_(0),
+      prefetches_in_flight_(0) {
+}
+
+OndemandSupplier::OndemandSupplier(const Source* source,
+                                   Storage* storage,
+                                   size_t max_cache_bytes)
+    : retriever_(new Retriever(source, storage)),
+      rule_cache_(),
+      max_cache_bytes_(max_cache_bytes),
+      lru_(),
+      cache_entries_(),
+      cache_bytes_(0),
+      evictions_(0),
+      negative_cache_(),
+      negative_cache_ttl_(kDefaultNegativeCacheTtl),
+      negative_cache_hits_(0),
+      in_flight_(),
+      prefetch_options_(),
+      prefetched_(0),
+      prefetches_in_flight_(0) {
+  assert(max_cache_bytes_ > 0);
 }
 
 OndemandSupplier::~OndemandSupplier() {
+  // The prefetches would call back a deleted object.
+  assert(prefetches_in_flight_ == 0);
   for (std::map<std::string, const Rule*>::const_iterator
        it = rule_cache_.begin(); it != rule_cache_.end(); ++it) {
     delete it->second;
   }
 }
 
+void OndemandSupplier::set_storage_options(const StorageOptions& options) {
+  retriever_->set_options(options);
+}
+
 void OndemandSupplier::Supply(const LookupKey& lookup_key,
                               const Callback& supplied) {
-  OndemandSupplyTask* task =
-      new OndemandSupplyTask(lookup_key, &rule_cache_, supplied);
+  Request* request = new Request(this, supplied);
+  OndemandSupplyTask* task = new OndemandSupplyTask(
+      lookup_key,
+      &rule_cache_,
+      negative_cache_ttl_ > 0 ? &negative_cache_ : NULL,
+      request->done());
+  request->set_task(task);
+  in_flight_.insert(task);
 
   if (RegionDataConstants::IsSupported(lookup_key.GetRegionCode())) {
     size_t max_depth = std::min(
         lookup_key.GetDepth(),
         RegionDataConstants::GetMaxLookupKeyDepth(lookup_key.GetRegionCode()));
 
+    time_t now = time(NULL);
     for (size_t depth = 0; depth <= max_depth; ++depth) {
       const std::string& key = lookup_key.ToKeyString(depth);
       std::map<std::string, const Rule*>::const_iterator it =
           rule_cache_.find(key);
       if (it != rule_cache_.end()) {
         task->hierarchy_.rule[depth] = it->second;
+      } else if (IsMissing(key, now)) {
+        ++negative_cache_hits_;  // Known to have no data, so leave it NULL.
       } else {
         task->Queue(key);  // If not in the cache, it needs to be loaded.
       }
@@ -64,5 +221,224 @@ void OndemandSupplier::Supply(const LookupKey& lookup_key,
   task->Retrieve(*retriever_);
 }
 
+void OndemandSupplier::set_negative_cache_ttl(time_t seconds) {
+  assert(seconds >= 0);
+  negative_cache_ttl_ = seconds;
+  if (negative_cache_ttl_ == 0) {
+    negative_cache_.clear();
+  }
+}
+
+void OndemandSupplier::set_prefetch_options(const PrefetchOptions& options) {
+  prefetch_options_ = options;
+}
+
+void OndemandSupplier::OnRequestDone(const OndemandSupplyTask* task) {
+  assert(task != NULL);
+  size_t status = in_flight_.erase(task);
+  assert(status == 1);
+  (void)status;  // Prevent unused variable if assert() is optimized away.
+
+  if (negative_cache_.size() > kMaxNegativeCacheSize) {
+    PruneNegativeCache(time(NULL));
+  }
+
+  const Rule* deepest = NULL;
+  for (size_t depth = 0; depth < arraysize(task->hierarchy_.rule); ++depth) {
+    if (task->hierarchy_.rule[depth] != NULL) {
+      deepest = task->hierarchy_.rule[depth];
+      Touch(deepest);
+    }
+  }
+
+  // The keys to prefetch are found before evicting, which can delete the
+  // rules of |task|.
+  std::vector<std::string> keys;
+  size_t budget = prefetch_options_.max_rules;
+  size_t max_key_depth = 0;
+  if (deepest != NULL && prefetch_options_.max_depth > 0) {
+    max_key_depth = RegionDataConstants::GetMaxLookupKeyDepth(
+        task->lookup_key().GetRegionCode());
+    AddPrefetchKeys(*deepest, max_key_depth, &budget, &keys);
+  }
+
+  Evict();
+  StartPrefetch(keys, prefetch_options_.max_depth, budget, max_key_depth);
+}
+
+void OndemandSupplier::Touch(const Rule* rule) {
+  assert(rule != NULL);
+  std::map<std::string, CacheEntry>::iterator it =
+      cache_entries_.find(rule->GetId());
+  if (it != cache_entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    return;
+  }
+  AddCacheEntry(rule, lru_.insert(lru_.begin(), rule->GetId()));
+}
+
+void OndemandSupplier::TouchPrefetched(const Rule* rule) {
+  assert(rule != NULL);
+  if (cache_entries_.find(rule->GetId()) == cache_entries_.end()) {
+    AddCacheEntry(rule, lru_.insert(lru_.end(), rule->GetId()));
+  }
+}
+
+void OndemandSupplier::AddCacheEntry(
+    const Rule* rule,
+    std::list<std::string>::iterator lru_position) {
+  assert(rule != NULL);
+  CacheEntry entry;
+  entry.bytes = rule->GetMemoryUsage() + 2 * rule->GetId().size();
+  entry.lru_position = lru_position;
+  cache_entries_.insert(std::make_pair(rule->GetId(), entry));
+  cache_bytes_ += entry.bytes;
+}
+
+void OndemandSupplier::Evict() {
+  if (max_cache_bytes_ == 0 || cache_bytes_ <= max_cache_bytes_) {
+    return;
+  }
+
+  std::set<const Rule*> pinned;
+  for (std::set<const OndemandSupplyTask*>::const_iterator
+       it = in_flight_.begin(); it != in_flight_.end(); ++it) {
+    const RuleHierarchy& hierarchy = (*it)->hierarchy_;
+    pinned.insert(hierarchy.rule, hierarchy.rule + arraysize(hierarchy.rule));
+    pinned.insert((*it)->loaded_rules_.begin(), (*it)->loaded_rules_.end());
+  }
+
+  // Walk from the least recently used rule towards the most recently used.
+  std::list<std::string>::iterator it = lru_.end();
+  while (cache_bytes_ > max_cache_bytes_ && it != lru_.begin()) {
+    --it;
+    std::map<std::string, const Rule*>::iterator rule_it =
+        rule_cache_.find(*it);
+    assert(rule_it != rule_cache_.end());
+    if (pinned.find(rule_it->second) != pinned.end()) {
+      continue;
+    }
+    std::map<std::string, CacheEntry>::iterator entry_it =
+        cache_entries_.find(*it);
+    assert(entry_it != cache_entries_.end());
+    cache_bytes_ -= entry_it->second.bytes;
+    cache_entries_.erase(entry_it);
+    delete rule_it->second;
+    rule_cache_.erase(rule_it);
+    it = lru_.erase(it);
+    ++evictions_;
+  }
+}
+
+bool OndemandSupplier::IsMissing(const std::string& key, time_t now) {
+  std::map<std::string, time_t>::iterator it = negative_cache_.find(key);
+  if (it == negative_cache_.end()) {
+    return false;
+  }
+  if (now - it->second < negative_cache_ttl_) {
+    return true;
+  }
+  negative_cache_.erase(it);
+  return false;
+}
+
+void OndemandSupplier::PruneNegativeCache(time_t now) {
+  for (std::map<std::string, time_t>::iterator it = negative_cache_.begin();
+       it != negative_cache_.end(); ) {
+    if (now - it->second < negative_cache_ttl_) {
+      ++it;
+    } else {
+      negative_cache_.erase(it++);
+    }
+  }
+  if (negative_cache_.size() > kMaxNegativeCacheSize) {
+    negative_cache_.clear();
+  }
+}
+
+void OndemandSupplier::AddPrefetchKeys(const Rule& rule,
+                                       size_t max_key_depth,
+                                       size_t* budget,
+                                       std::vector<std::string>* keys) {
+  assert(budget != NULL);
+  assert(keys != NULL);
+  const std::string& id = rule.GetId();
+  // The depth of the subregion keys, as with OndemandSupplyTask::Load().
+  size_t depth = std::count(id.begin(), id.end(), '/');
+  if (depth > max_key_depth || depth >= arraysize(LookupKey::kHierarchy)) {
+    return;
+  }
+
+  // A language tag comes last, after the keys of all subregions, as in
+  // LookupKey::ToKeyString(). So "data/CA--fr" has "data/CA/QC--fr" below it.
+  std::string::size_type dash = id.find(kLanguageDelim);
+  const std::string& base = id.substr(0, dash);
+  const std::string& language =
+      dash != std::string::npos ? id.substr(dash) : std::string();
+
+  time_t now = time(NULL);
+  const std::vector<std::string>& sub_keys = rule.GetSubKeys();
+  size_t fan_out = 0;
+  for (std::vector<std::string>::const_iterator it = sub_keys.begin();
+       it != sub_keys.end() && fan_out < prefetch_options_.max_fan_out &&
+       *budget > 0; ++it) {
+    const std::string& key = base + '/' + *it + language;
+    if (rule_cache_.find(key) == rule_cache_.end() && !IsMissing(key, now)) {
+      keys->push_back(key);
+      ++fan_out;
+      --*budget;
+    }
+  }
+}
+
+void OndemandSupplier::StartPrefetch(const std::vector<std::string>& keys,
+                                     size_t levels,
+                                     size_t budget,
+                                     size_t max_key_depth) {
+  if (keys.empty()) {
+    return;
+  }
+  prefetched_ += keys.size();
+  ++prefetches_in_flight_;
+  Prefetch* prefetch = new Prefetch(this, levels, budget, max_key_depth);
+  OndemandSupplyTask* task = new OndemandSupplyTask(
+      prefetch->lookup_key(),
+      &rule_cache_,
+      negative_cache_ttl_ > 0 ? &negative_cache_ : NULL,
+      prefetch->done());
+  prefetch->set_task(task);
+  in_flight_.insert(task);
+  for (std::vector<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    task->Queue(*it);
+  }
+  task->Retrieve(*retriever_);
+}
+
+void OndemandSupplier::OnPrefetchDone(const Prefetch& prefetch) {
+  assert(prefetch.task_ != NULL);
+  assert(prefetches_in_flight_ > 0);
+  --prefetches_in_flight_;
+  size_t status = in_flight_.erase(prefetch.task_);
+  assert(status == 1);
+  (void)status;  // Prevent unused variable if assert() is optimized away.
+
+  // The rules are taken from the task, rather than looked up by the keys
+  // prefetched, as a rule can have another ID than the key it was got for.
+  const std::vector<const Rule*>& rules = prefetch.task_->loaded_rules_;
+  std::vector<std::string> keys;
+  size_t budget = prefetch.budget_;
+  for (std::vector<const Rule*>::const_iterator it = rules.begin();
+       it != rules.end(); ++it) {
+    TouchPrefetched(*it);
+    if (prefetch.levels_ > 1) {
+      AddPrefetchKeys(**it, prefetch.max_key_depth_, &budget, &keys);
+    }
+  }
+
+  Evict();
+  StartPrefetch(keys, prefetch.levels_ - 1, budget, prefetch.max_key_depth_);
+}
+
 }  // namespace addressinput
 }  // namespace i18n
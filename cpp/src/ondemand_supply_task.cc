@@ -22,10 +22,12 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <ctime>
 #include <map>
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "lookup_key.h"
 #include "retriever.h"
@@ -37,11 +39,14 @@ namespace addressinput {
 OndemandSupplyTask::OndemandSupplyTask(
     const LookupKey& lookup_key,
     std::map<std::string, const Rule*>* rules,
+    std::map<std::string, time_t>* missing,
     const Supplier::Callback& supplied)
     : hierarchy_(),
+      loaded_rules_(),
       pending_(),
       lookup_key_(lookup_key),
       rule_cache_(rules),
+      missing_(missing),
       supplied_(supplied),
       retrieved_(BuildCallback(this, &OndemandSupplyTask::Load)),
       success_(true) {
@@ -63,18 +68,10 @@ void OndemandSupplyTask::Retrieve(const Retriever& retriever) {
   } else {
     // When the final pending rule has been retrieved, the retrieved_ callback,
     // implemented by Load(), will finish by calling Loaded(), which will finish
-    // by delete'ing this RuleHierarchy object. So after the final call to
-    // retriever.Retrieve() no attributes of this object can be accessed (as the
-    // object then no longer will exist, if the final callback has finished by
-    // then), and the condition statement of the loop must therefore not use the
-    // otherwise obvious it != pending_.end() but instead test a local variable
-    // that isn't affected by the object being deleted.
-    bool done = false;
-    for (std::set<std::string>::const_iterator it = pending_.begin(); !done; ) {
-      const std::string& key = *it++;
-      done = it == pending_.end();
-      retriever.Retrieve(key, *retrieved_);
-    }
+    // by delete'ing this RuleHierarchy object. So the keys are copied, for
+    // RetrieveMulti() to still be able to access them after that.
+    std::vector<std::string> keys(pending_.begin(), pending_.end());
+    retriever.RetrieveMulti(keys, *retrieved_);
   }
 }
 
@@ -90,9 +87,21 @@ void OndemandSupplyTask::Load(bool success,
   (void)status;  // Prevent unused variable if assert() is optimized away.
 
   if (success) {
-    // The address metadata server will return the empty JSON "{}" when it
-    // successfully performed a lookup, but didn't find any data for that key.
-    if (data != "{}") {
+    std::map<std::string, const Rule*>::const_iterator it =
+        rule_cache_->find(key);
+    if (it != rule_cache_->end()) {
+      // Another task that was waiting for the same data, which the Retriever
+      // retrieved only once for all of them, has already parsed it.
+      hierarchy_.rule[depth] = it->second;
+      loaded_rules_.push_back(it->second);
+    } else if (data == "{}") {
+      // The empty JSON "{}" is what the address metadata server returns when
+      // it successfully performed a lookup, but didn't find any data for that
+      // key. Remember this, so that the key isn't looked up again soon.
+      if (missing_ != NULL) {
+        (*missing_)[key] = time(NULL);
+      }
+    } else {
       Rule* rule = new Rule;
       if (LookupKey::kHierarchy[depth] == COUNTRY) {
         // All rules on the COUNTRY level inherit from the default rule.
@@ -116,6 +125,7 @@ void OndemandSupplyTask::Load(bool success,
         }
         // Pointer to object in the map.
         hierarchy_.rule[depth] = result.first->second;
+        loaded_rules_.push_back(result.first->second);
       } else {
         delete rule;
         success_ = false;
@@ -19,9 +19,11 @@
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
+#include <ctime>
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "retriever.h"
 
@@ -36,10 +38,14 @@ class Rule;
 // callback when that has been done. Calling the Retrieve() method will load
 // required metadata, then call the callback and delete the OndemandSupplyTask
 // object itself.
+//
+// Keys for which the data server has no data are recorded in |missing|, if it
+// isn't NULL, together with the time when this was found out.
 class OndemandSupplyTask {
  public:
   OndemandSupplyTask(const LookupKey& lookup_key,
                      std::map<std::string, const Rule*>* rules,
+                     std::map<std::string, time_t>* missing,
                      const Supplier::Callback& supplied);
   ~OndemandSupplyTask();
 
@@ -49,8 +55,15 @@ class OndemandSupplyTask {
   // Retrieves and parses data for all queued keys, then calls |supplied_|.
   void Retrieve(const Retriever& retriever);
 
+  const LookupKey& lookup_key() const { return lookup_key_; }
+
   Supplier::RuleHierarchy hierarchy_;
 
+  // All rules retrieved, also those at the same depth as another one. The ID
+  // of a rule can differ from the key queued for it, as the data server is
+  // free to resolve aliases.
+  std::vector<const Rule*> loaded_rules_;
+
  private:
   void Load(bool success, const std::string& key, const std::string& data);
   void Loaded();
@@ -58,6 +71,7 @@ class OndemandSupplyTask {
   std::set<std::string> pending_;
   const LookupKey& lookup_key_;
   std::map<std::string, const Rule*>* const rule_cache_;
+  std::map<std::string, time_t>* const missing_;
   const Supplier::Callback& supplied_;
   const scoped_ptr<const Retriever::Callback> retrieved_;
   bool success_;
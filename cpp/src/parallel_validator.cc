@@ -0,0 +1,202 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/parallel_validator.h>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/callback.h>
+#include <libaddressinput/preload_supplier.h>
+#include <libaddressinput/problem_filter.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+#include <libaddressinput/validation_result.h>
+
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lookup_key.h"
+#include "region_data_constants.h"
+#include "rule.h"
+#include "util/mutex.h"
+#include "util/thread_pool.h"
+#include "validation_task.h"
+
+namespace i18n {
+namespace addressinput {
+
+namespace {
+
+// The number of addresses that a worker thread validates at a time, before
+// checking again whether there is more work in its part of the batch.
+const size_t kGrain = 16;
+
+// Validates one batch of addresses. The metadata is supplied on the calling
+// thread by Supply(), after which Run() is called by the worker threads.
+class Helper : public ThreadPool::Task {
+ public:
+  // Does not take ownership of its parameters.
+  Helper(const std::vector<AddressData>& addresses,
+         bool allow_postal,
+         bool require_name,
+         const ProblemFilter& filter,
+         std::vector<ValidationResult>* results)
+      : addresses_(addresses),
+        allow_postal_(allow_postal),
+        require_name_(require_name),
+        filter_(filter),
+        results_(results),
+        hierarchies_(),
+        address_hierarchy_(addresses.size()) {
+    assert(results_ != NULL);
+    results_->resize(addresses_.size());
+  }
+
+  virtual ~Helper() {}
+
+  // Looks up the metadata for every distinct lookup key of the batch. Returns
+  // false if the metadata for some address wasn't available.
+  bool Supply(const PreloadSupplier& supplier) {
+    bool success = true;
+    std::map<std::string, const Supplier::RuleHierarchy*> keys;
+    LookupKey lookup_key;
+    for (size_t i = 0; i < addresses_.size(); ++i) {
+      lookup_key.FromAddress(addresses_[i]);
+      const std::string& key = lookup_key.ToKeyString(
+          RegionDataConstants::GetMaxLookupKeyDepth(
+              lookup_key.GetRegionCode()));
+
+      std::map<std::string, const Supplier::RuleHierarchy*>::iterator it =
+          keys.find(key);
+      if (it == keys.end()) {
+        hierarchies_.push_back(Supplier::RuleHierarchy());
+        const Supplier::RuleHierarchy* hierarchy = &hierarchies_.back();
+        if (!supplier.GetRuleHierarchy(lookup_key, &hierarchies_.back())) {
+          // A NULL hierarchy marks the addresses that can't be validated.
+          hierarchies_.pop_back();
+          hierarchy = NULL;
+          success = false;
+        }
+        it = keys.insert(std::make_pair(key, hierarchy)).first;
+      }
+      address_hierarchy_[i] = it->second;
+    }
+    return success;
+  }
+
+  // ThreadPool::Task implementation.
+  virtual void Run(size_t begin, size_t end) {
+    // Each call uses its own ValidationTask object, which doesn't allocate any
+    // memory when constructed for calling Check().
+    ValidationTask checker(allow_postal_, require_name_, filter_);
+    for (size_t i = begin; i < end; ++i) {
+      if (address_hierarchy_[i] != NULL) {
+        checker.Check(addresses_[i], *address_hierarchy_[i], &(*results_)[i]);
+      } else {
+        (*results_)[i].clear();
+      }
+    }
+  }
+
+ private:
+  const std::vector<AddressData>& addresses_;
+  const bool allow_postal_;
+  const bool require_name_;
+  const ProblemFilter& filter_;
+  std::vector<ValidationResult>* const results_;
+
+  // The elements of a list never move, so pointers to them remain valid.
+  std::list<Supplier::RuleHierarchy> hierarchies_;
+  std::vector<const Supplier::RuleHierarchy*> address_hierarchy_;
+
+  DISALLOW_COPY_AND_ASSIGN(Helper);
+};
+
+// Validates an address that makes the validation checks use all the static
+// data that they need, so that it gets initialized before any worker thread
+// runs a check, instead of several worker threads racing to initialize it.
+void InitStaticData() {
+  AddressData address;
+  address.region_code = "US";
+  address.address_line.push_back("P.O. Box 1");
+  address.administrative_area = "X";
+  address.locality = "X";
+  address.dependent_locality = "X";
+  address.postal_code = "X";
+  address.sorting_code = "X";
+  address.recipient = "X";
+
+  Supplier::RuleHierarchy hierarchy;
+  hierarchy.rule[0] = &Rule::GetDefault();
+
+  ValidationResult result;
+  ValidationTask checker(false, true, ProblemFilter());
+  checker.Check(address, hierarchy, &result);
+}
+
+}  // namespace
+
+ParallelValidator::ParallelValidator(PreloadSupplier* supplier,
+                                     size_t num_threads)
+    : supplier_(supplier),
+      mutex_(new Mutex),
+      pool_(new ThreadPool(num_threads)) {
+  assert(supplier_ != NULL);
+  InitStaticData();
+}
+
+ParallelValidator::~ParallelValidator() {}
+
+bool ParallelValidator::ValidateBatch(
+    const std::vector<AddressData>& addresses,
+    bool allow_postal,
+    bool require_name,
+    const FieldProblemMap* filter,
+    std::vector<FieldProblemMap>* problems) const {
+  assert(problems != NULL);
+  std::vector<ValidationResult> results;
+  bool success = ValidateBatch(
+      addresses, allow_postal, require_name, ProblemFilter(filter), &results);
+  problems->resize(results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    results[i].ToFieldProblemMap(&(*problems)[i]);
+  }
+  return success;
+}
+
+bool ParallelValidator::ValidateBatch(
+    const std::vector<AddressData>& addresses,
+    bool allow_postal,
+    bool require_name,
+    const ProblemFilter& filter,
+    std::vector<ValidationResult>* results) const {
+  assert(results != NULL);
+  MutexLock lock(mutex_.get());
+  // The rules must not be deleted by PreloadSupplier::ReloadRules() until all
+  // worker threads are done with them.
+  PreloadSupplier::ReadSection section(*supplier_);
+  Helper helper(addresses, allow_postal, require_name, filter, results);
+  bool success = helper.Supply(*supplier_);
+  pool_->ParallelFor(addresses.size(), kGrain, &helper);
+  return success;
+}
+
+}  // namespace addressinput
+}  // namespace i18n
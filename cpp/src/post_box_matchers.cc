@@ -14,6 +14,10 @@
 
 #include "post_box_matchers.h"
 
+#include <libaddressinput/util/basictypes.h>
+
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
 #include <map>
 #include <string>
@@ -21,104 +25,133 @@
 #include <vector>
 
 #include <re2/re2.h>
+#include <re2/set.h>
 
 #include "language.h"
+#include "region_data_constants.h"
 #include "rule.h"
 #include "util/re2ptr.h"
+#include "util/string_split.h"
 
 namespace i18n {
 namespace addressinput {
 
 namespace {
 
-std::map<std::string, const RE2ptr*> InitMatchers() {
-  static const struct {
-    const char* const language;
-    const RE2ptr ptr;
-  } kMatchers[] = {
+// A regular expression for a language, together with hints for a quick check
+// of whether a line at all could match it: Unless the line contains any of the
+// '|' separated |keywords| (compared case-insensitively), or any digit if
+// |digits| is true, the regular expression can't match the line. Non-ASCII
+// characters aren't covered by the hints, so lines that contain any of those
+// always need to be searched with the regular expression.
+struct Matcher {
+  const char* const language;
+  const RE2ptr ptr;
+  const char* const keywords;
+  const bool digits;
+};
+
+std::map<std::string, const Matcher*> InitMatchers() {
+  static const Matcher kMatchers[] = {
     { "ar",
       /* "صندوق بريد|ص[-. ]ب" */
       new RE2("\xD8\xB5\xD9\x86\xD8\xAF\xD9\x88\xD9\x82 "
-              "\xD8\xA8\xD8\xB1\xD9\x8A\xD8\xAF|\xD8\xB5[-. ]\xD8\xA8") },
+              "\xD8\xA8\xD8\xB1\xD9\x8A\xD8\xAF|\xD8\xB5[-. ]\xD8\xA8"),
+      NULL, false },
 
-    { "cs", new RE2("(?i)p\\.? ?p\\.? \\d") },
-    { "da", new RE2("(?i)Postboks") },
-    { "de", new RE2("(?i)Postfach") },
+    { "cs", new RE2("(?i)p\\.? ?p\\.? \\d"),
+      NULL, true },
+    { "da", new RE2("(?i)Postboks"),
+      "postboks", false },
+    { "de", new RE2("(?i)Postfach"),
+      "postfach", false },
 
     { "el",
       /* "T\\.? ?Θ\\.? \\d{2}" */
-      new RE2("(?i)T\\.? ?\xCE\x98\\.? \\d{2}") },
+      new RE2("(?i)T\\.? ?\xCE\x98\\.? \\d{2}"),
+      NULL, false },
 
-    { "en", new RE2("Private Bag|Post(?:al)? Box") },
-    { "es", new RE2("(?i)(?:Apartado|Casillas) de correos?") },
-    { "fi", new RE2("(?i)Postilokero|P\\.?L\\.? \\d") },
-    { "hr", new RE2("(?i)p\\.? ?p\\.? \\d") },
+    { "en", new RE2("Private Bag|Post(?:al)? Box"),
+      "private bag|post", false },
+    { "es", new RE2("(?i)(?:Apartado|Casillas) de correos?"),
+      "correo", false },
+    { "fi", new RE2("(?i)Postilokero|P\\.?L\\.? \\d"),
+      "postilokero", true },
+    { "hr", new RE2("(?i)p\\.? ?p\\.? \\d"),
+      NULL, true },
 
     { "hu",
       /* "Postafi(?:[oó]|ó)k|Pf\\.? \\d" */
-      new RE2("(?i)Postafi(?:[o\xC3\xB3]|o\xCC\x81)k|Pf\\.? \\d") },
+      new RE2("(?i)Postafi(?:[o\xC3\xB3]|o\xCC\x81)k|Pf\\.? \\d"),
+      "postafi", true },
 
     { "fr",
       /* "Bo(?:[iî]|î)te Postale|BP \\d|CEDEX \\d" */
-      new RE2("(?i)Bo(?:[i\xC3\xAE]|i\xCC\x82)te Postale|BP \\d|CEDEX \\d") },
+      new RE2("(?i)Bo(?:[i\xC3\xAE]|i\xCC\x82)te Postale|BP \\d|CEDEX \\d"),
+      "postale", true },
 
     { "ja",
       /* "私書箱\\d{1,5}号" */
-      new RE2("(?i)\xE7\xA7\x81\xE6\x9B\xB8\xE7\xAE\xB1\\d{1,5}\xE5\x8F\xB7") },
+      new RE2("(?i)\xE7\xA7\x81\xE6\x9B\xB8\xE7\xAE\xB1\\d{1,5}\xE5\x8F\xB7"),
+      NULL, false },
 
-    { "nl", new RE2("(?i)Postbus") },
-    { "no", new RE2("(?i)Postboks") },
-    { "pl", new RE2("(?i)Skr(?:\\.?|ytka) poczt(?:\\.?|owa)") },
-    { "pt", new RE2("(?i)Apartado") },
+    { "nl", new RE2("(?i)Postbus"),
+      "postbus", false },
+    { "no", new RE2("(?i)Postboks"),
+      "postboks", false },
+    { "pl", new RE2("(?i)Skr(?:\\.?|ytka) poczt(?:\\.?|owa)"),
+      "skr", false },
+    { "pt", new RE2("(?i)Apartado"),
+      "apartado", false },
 
     { "ru",
       /* "абонентский ящик|[аa]\\\" */
       new RE2("(?i)\xD0\xB0\xD0\xB1\xD0\xBE\xD0\xBD\xD0\xB5\xD0\xBD\xD1\x82\xD1"
               "\x81\xD0\xBA\xD0\xB8\xD0\xB9 \xD1\x8F\xD1\x89\xD0\xB8\xD0\xBA|"
-              "[\xD0\xB0""a]\\\"\xD1\x8F (?:(?:\xE2\x84\x96|#|N) ?)?\\d") },
+              "[\xD0\xB0""a]\\\"\xD1\x8F (?:(?:\xE2\x84\x96|#|N) ?)?\\d"),
+      NULL, false },
 
-    { "sv", new RE2("(?i)Box \\d") },
+    { "sv", new RE2("(?i)Box \\d"),
+      NULL, true },
 
     { "zh",
       /* "郵政信箱.{1,5}號|郵局第.{1,10}號信箱" */
       new RE2("(?i)\xE9\x83\xB5\xE6\x94\xBF\xE4\xBF\xA1\xE7\xAE\xB1.{1,5}"
               "\xE8\x99\x9F|\xE9\x83\xB5\xE5\xB1\x80\xE7\xAC\xAC.{1,10}"
-              "\xE8\x99\x9F\xE4\xBF\xA1\xE7\xAE\xB1") },
+              "\xE8\x99\x9F\xE4\xBF\xA1\xE7\xAE\xB1"),
+      NULL, false },
 
-    { "und", new RE2("P\\.? ?O\\.? Box") }
+    { "und", new RE2("P\\.? ?O\\.? Box"),
+      "box", false }
   };
 
-  std::map<std::string, const RE2ptr*> matchers;
+  std::map<std::string, const Matcher*> matchers;
 
   for (size_t i = 0; i < sizeof kMatchers / sizeof *kMatchers; ++i) {
-    matchers.insert(std::make_pair(kMatchers[i].language, &kMatchers[i].ptr));
+    matchers.insert(std::make_pair(kMatchers[i].language, &kMatchers[i]));
   }
 
   return matchers;
 }
 
-}  // namespace
-
-// static
-std::vector<const RE2ptr*> PostBoxMatchers::GetMatchers(
-    const Rule& country_rule) {
-  static const std::map<std::string, const RE2ptr*> kMatchers(InitMatchers());
+// Returns the matchers for those of |languages| that have any, always starting
+// with the matcher for "und" (English-like defaults).
+std::vector<const Matcher*> GetLanguageMatchers(
+    const std::vector<std::string>& languages) {
+  static const std::map<std::string, const Matcher*> kMatchers(InitMatchers());
 
-  // Always add any expressions defined for "und" (English-like defaults).
-  std::vector<std::string> languages(1, "und");
+  std::vector<std::string> bases(1, "und");
   for (std::vector<std::string>::const_iterator
-       it = country_rule.GetLanguages().begin();
-       it != country_rule.GetLanguages().end(); ++it) {
+       it = languages.begin(); it != languages.end(); ++it) {
     Language language(*it);
-    languages.push_back(language.base);
+    bases.push_back(language.base);
   }
 
-  std::vector<const RE2ptr*> result;
+  std::vector<const Matcher*> result;
 
   for (std::vector<std::string>::const_iterator
-       it = languages.begin();
-       it != languages.end(); ++it) {
-    std::map<std::string, const RE2ptr*>::const_iterator
+       it = bases.begin(); it != bases.end(); ++it) {
+    std::map<std::string, const Matcher*>::const_iterator
         jt = kMatchers.find(*it);
     if (jt != kMatchers.end()) {
       result.push_back(jt->second);
@@ -128,5 +161,158 @@ std::vector<const RE2ptr*> PostBoxMatchers::GetMatchers(
   return result;
 }
 
+// Returns true if |c| isn't an ASCII character.
+bool IsNonAscii(char c) {
+  return (static_cast<unsigned char>(c) & 0x80) != 0;
+}
+
+// Compares ASCII characters case-insensitively.
+bool EqualIgnoringAsciiCase(char a, char b) {
+  if ('A' <= a && a <= 'Z') {
+    a += 'a' - 'A';
+  }
+  if ('A' <= b && b <= 'Z') {
+    b += 'a' - 'A';
+  }
+  return a == b;
+}
+
+// All the regular expressions for a set of languages, compiled into a single
+// RE2::Set, which searches a line for all of them in a single pass.
+class MatcherSet {
+ public:
+  explicit MatcherSet(const std::vector<std::string>& languages)
+      : set_(RE2::DefaultOptions, RE2::UNANCHORED),
+        keywords_(),
+        digits_(false) {
+    const std::vector<const Matcher*>& matchers =
+        GetLanguageMatchers(languages);
+    for (std::vector<const Matcher*>::const_iterator
+         it = matchers.begin(); it != matchers.end(); ++it) {
+      int index = set_.Add((*it)->ptr.ptr->pattern(), NULL);
+      assert(index >= 0);
+      (void)index;  // Prevent unused variable if assert() is optimized away.
+      if ((*it)->keywords != NULL) {
+        std::vector<std::string> keywords;
+        SplitString((*it)->keywords, '|', &keywords);
+        keywords_.insert(keywords_.end(), keywords.begin(), keywords.end());
+      }
+      digits_ = digits_ || (*it)->digits;
+    }
+    bool compiled = set_.Compile();
+    assert(compiled);
+    (void)compiled;  // Prevent unused variable if assert() is optimized away.
+  }
+
+  ~MatcherSet() {}
+
+  bool MatchAny(const std::vector<std::string>& lines) const {
+    for (std::vector<std::string>::const_iterator
+         it = lines.begin(); it != lines.end(); ++it) {
+      if (MightMatch(*it) && set_.Match(*it, NULL)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  // Returns false if none of the regular expressions can match |line|.
+  bool MightMatch(const std::string& line) const {
+    for (std::string::const_iterator
+         it = line.begin(); it != line.end(); ++it) {
+      if (IsNonAscii(*it) || (digits_ && '0' <= *it && *it <= '9')) {
+        return true;
+      }
+    }
+    for (std::vector<std::string>::const_iterator
+         it = keywords_.begin(); it != keywords_.end(); ++it) {
+      if (std::search(line.begin(), line.end(), it->begin(), it->end(),
+                      EqualIgnoringAsciiCase) != line.end()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  RE2::Set set_;
+  std::vector<std::string> keywords_;
+  bool digits_;
+
+  DISALLOW_COPY_AND_ASSIGN(MatcherSet);
+};
+
+// The MatcherSet objects for the languages of all regions, created once.
+class MatcherSetCache {
+ public:
+  MatcherSetCache() : sets_() {
+    // Rules without any languages, like the default rule.
+    Add(std::vector<std::string>());
+
+    const std::vector<std::string>& region_codes =
+        RegionDataConstants::GetRegionCodes();
+    for (std::vector<std::string>::const_iterator
+         it = region_codes.begin(); it != region_codes.end(); ++it) {
+      Add(RegionDataConstants::GetLanguages(*it));
+    }
+  }
+
+  ~MatcherSetCache() {
+    for (std::map<std::vector<std::string>, const MatcherSet*>::const_iterator
+         it = sets_.begin(); it != sets_.end(); ++it) {
+      delete it->second;
+    }
+  }
+
+  // Returns NULL if there is no MatcherSet for |languages|.
+  const MatcherSet* Find(const std::vector<std::string>& languages) const {
+    std::map<std::vector<std::string>, const MatcherSet*>::const_iterator
+        it = sets_.find(languages);
+    return it != sets_.end() ? it->second : NULL;
+  }
+
+ private:
+  void Add(const std::vector<std::string>& languages) {
+    if (sets_.find(languages) == sets_.end()) {
+      sets_.insert(std::make_pair(languages, new MatcherSet(languages)));
+    }
+  }
+
+  std::map<std::vector<std::string>, const MatcherSet*> sets_;
+
+  DISALLOW_COPY_AND_ASSIGN(MatcherSetCache);
+};
+
+}  // namespace
+
+// static
+std::vector<const RE2ptr*> PostBoxMatchers::GetMatchers(
+    const Rule& country_rule) {
+  const std::vector<const Matcher*>& matchers =
+      GetLanguageMatchers(country_rule.GetLanguages());
+
+  std::vector<const RE2ptr*> result;
+
+  for (std::vector<const Matcher*>::const_iterator
+       it = matchers.begin(); it != matchers.end(); ++it) {
+    result.push_back(&(*it)->ptr);
+  }
+
+  return result;
+}
+
+// static
+bool PostBoxMatchers::HasPostBox(const Rule& country_rule,
+                                 const std::vector<std::string>& lines) {
+  static const MatcherSetCache kCache;
+  const MatcherSet* cached = kCache.Find(country_rule.GetLanguages());
+  if (cached != NULL) {
+    return cached->MatchAny(lines);
+  }
+  // Languages not used by any known region, so compile the expressions now.
+  MatcherSet matcher_set(country_rule.GetLanguages());
+  return matcher_set.MatchAny(lines);
+}
+
 }  // namespace addressinput
 }  // namespace i18n
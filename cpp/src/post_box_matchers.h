@@ -17,6 +17,7 @@
 #ifndef I18N_ADDRESSINPUT_POST_BOX_MATCHERS_H_
 #define I18N_ADDRESSINPUT_POST_BOX_MATCHERS_H_
 
+#include <string>
 #include <vector>
 
 namespace i18n {
@@ -30,6 +31,14 @@ class PostBoxMatchers {
   // Returns pointers to RE2 regular expression objects to test address lines
   // for those languages that are relevant for |country_rule|.
   static std::vector<const RE2ptr*> GetMatchers(const Rule& country_rule);
+
+  // Returns true if any of the regular expressions returned by GetMatchers()
+  // matches any of |lines|. The expressions for each set of languages used by
+  // a region are compiled once into a single RE2::Set, and lines that can't
+  // contain a post office box according to a quick literal check are never
+  // searched with the regular expressions.
+  static bool HasPostBox(const Rule& country_rule,
+                         const std::vector<std::string>& lines);
 };
 
 }  // namespace addressinput
@@ -0,0 +1,437 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "postal_code_matcher.h"
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <bitset>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <re2/re2.h>
+
+#include "util/atomic.h"
+#include "util/re2ptr.h"
+
+namespace i18n {
+namespace addressinput {
+
+namespace {
+
+// The state machine has at most this many states, so that the set of current
+// states always fits into a uint64.
+const size_t kMaxStates = 64;
+
+// Compiles a fixed-shape regular expression into the states of a state
+// machine, by recursive descent parsing of this grammar:
+//
+//   alternation := sequence ('|' sequence)*
+//   sequence    := repetition*
+//   repetition  := '(' ['?:'] alternation ')' ['?']
+//                | atom ['?' | '{' n '}' | '{' n ',' m '}']
+//   atom        := '[' class-item+ ']' | '\d' | '\' punctuation | literal
+//
+// Compile() returns false for anything else, in which case the caller falls
+// back to RE2.
+class ShapeCompiler {
+ public:
+  typedef std::bitset<128> CharClass;
+
+  ShapeCompiler(const std::string& pattern,
+                std::vector<CharClass>* classes,
+                std::vector<uint64>* skips)
+      : pattern_(pattern),
+        pos_(0),
+        classes_(classes),
+        skips_(skips) {
+    assert(classes_ != NULL);
+    assert(skips_ != NULL);
+    classes_->clear();
+    skips_->assign(1, 0);
+  }
+
+  bool Compile() {
+    return ParseAlternation() && pos_ == pattern_.size();
+  }
+
+ private:
+  bool AtEnd() const { return pos_ >= pattern_.size(); }
+  char Peek() const { return pattern_[pos_]; }
+
+  // Adds a state that moves on |char_class| to a new last state. Returns the
+  // index of the added state, or kMaxStates if there are too many states.
+  size_t AddState(const CharClass& char_class) {
+    if (classes_->size() + 1 >= kMaxStates) {
+      return kMaxStates;
+    }
+    classes_->push_back(char_class);
+    skips_->push_back(0);
+    return classes_->size() - 1;
+  }
+
+  void AddSkip(size_t from, size_t to) {
+    assert(from <= to);
+    assert(to < kMaxStates);
+    (*skips_)[from] |= static_cast<uint64>(1) << to;
+  }
+
+  bool ParseAlternation() {
+    size_t start = classes_->size();
+    std::vector<size_t> branch_ends;
+    for (;;) {
+      if (!ParseSequence()) {
+        return false;
+      }
+      if (AtEnd() || Peek() != '|') {
+        break;
+      }
+      ++pos_;
+      // End the branch with a state that doesn't accept any character, and
+      // start the next branch after it.
+      size_t branch_end = AddState(CharClass());
+      if (branch_end == kMaxStates) {
+        return false;
+      }
+      branch_ends.push_back(branch_end);
+      AddSkip(start, classes_->size());
+    }
+    for (std::vector<size_t>::const_iterator
+         it = branch_ends.begin(); it != branch_ends.end(); ++it) {
+      AddSkip(*it, classes_->size());
+    }
+    return true;
+  }
+
+  bool ParseSequence() {
+    while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+      if (!ParseRepetition()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ParseRepetition() {
+    size_t start = classes_->size();
+
+    if (Peek() == '(') {
+      ++pos_;
+      if (pattern_.compare(pos_, 2, "?:") == 0) {
+        pos_ += 2;
+      } else if (!AtEnd() && Peek() == '?') {
+        return false;  // Flags or named groups.
+      }
+      if (!ParseAlternation() || AtEnd() || Peek() != ')') {
+        return false;
+      }
+      ++pos_;
+      if (!AtEnd() && Peek() == '?') {
+        ++pos_;
+        AddSkip(start, classes_->size());
+      }
+      return AtEnd() || std::strchr("?*+{", Peek()) == NULL;
+    }
+
+    CharClass char_class;
+    if (!ParseAtom(&char_class)) {
+      return false;
+    }
+
+    size_t min = 1;
+    size_t max = 1;
+    if (!AtEnd() && Peek() == '?') {
+      ++pos_;
+      min = 0;
+    } else if (!AtEnd() && Peek() == '{') {
+      ++pos_;
+      if (!ParseNumber(&min)) {
+        return false;
+      }
+      max = min;
+      if (!AtEnd() && Peek() == ',') {
+        ++pos_;
+        if (!ParseNumber(&max)) {
+          return false;
+        }
+      }
+      if (AtEnd() || Peek() != '}' || min > max) {
+        return false;
+      }
+      ++pos_;
+    }
+    if (!AtEnd() && std::strchr("?*+{", Peek()) != NULL) {
+      return false;
+    }
+
+    for (size_t i = 0; i < max; ++i) {
+      size_t state = AddState(char_class);
+      if (state == kMaxStates) {
+        return false;
+      }
+      if (i >= min) {
+        AddSkip(state, state + 1);
+      }
+    }
+    return true;
+  }
+
+  // Parses a number of at most two digits, which is more than enough for any
+  // repetition that fits into the state machine.
+  bool ParseNumber(size_t* number) {
+    assert(number != NULL);
+    size_t digits = 0;
+    *number = 0;
+    while (!AtEnd() && '0' <= Peek() && Peek() <= '9') {
+      if (++digits > 2) {
+        return false;
+      }
+      *number = *number * 10 + (Peek() - '0');
+      ++pos_;
+    }
+    return digits > 0;
+  }
+
+  bool ParseAtom(CharClass* char_class) {
+    assert(char_class != NULL);
+    char c = Peek();
+    if (c == '[') {
+      return ParseClass(char_class);
+    }
+    if (c == '\\') {
+      return ParseEscape(char_class, NULL);
+    }
+    if (!IsLiteral(c)) {
+      return false;
+    }
+    char_class->set(c);
+    ++pos_;
+    return true;
+  }
+
+  bool ParseClass(CharClass* char_class) {
+    assert(char_class != NULL);
+    ++pos_;  // '['
+    if (AtEnd() || Peek() == '^' || Peek() == ']') {
+      return false;
+    }
+    while (!AtEnd() && Peek() != ']') {
+      int low;
+      if (!ParseClassItem(char_class, &low)) {
+        return false;
+      }
+      if (pattern_.compare(pos_, 1, "-") == 0 &&
+          pos_ + 1 < pattern_.size() && pattern_[pos_ + 1] != ']') {
+        ++pos_;
+        if (low < 0) {
+          return false;  // A range can't start with \d.
+        }
+        int high;
+        if (!ParseClassItem(char_class, &high) || high < low) {
+          return false;
+        }
+        for (int i = low; i <= high; ++i) {
+          char_class->set(i);
+        }
+      }
+    }
+    if (AtEnd()) {
+      return false;
+    }
+    ++pos_;  // ']'
+    return true;
+  }
+
+  // Parses a single character of a class into |character|, or a \d into
+  // |char_class| (setting |character| to -1).
+  bool ParseClassItem(CharClass* char_class, int* character) {
+    assert(char_class != NULL);
+    assert(character != NULL);
+    char c = Peek();
+    if (c == '\\') {
+      return ParseEscape(char_class, character);
+    }
+    if (c == '[' || !IsPrintableAscii(c)) {
+      return false;  // '[' could start a POSIX class like "[:alpha:]".
+    }
+    *character = c;
+    char_class->set(c);
+    ++pos_;
+    return true;
+  }
+
+  // Parses an escape sequence: \d, or an escaped punctuation character. The
+  // escaped character is stored in |character|, if not NULL (or -1 for \d).
+  bool ParseEscape(CharClass* char_class, int* character) {
+    assert(char_class != NULL);
+    ++pos_;  // '\'
+    if (AtEnd()) {
+      return false;
+    }
+    char c = Peek();
+    ++pos_;
+    if (c == 'd') {
+      for (char digit = '0'; digit <= '9'; ++digit) {
+        char_class->set(digit);
+      }
+      if (character != NULL) {
+        *character = -1;
+      }
+      return true;
+    }
+    if (!IsPrintableAscii(c) || IsAlphanumeric(c)) {
+      return false;  // Some other escape sequence, like \w or \pL.
+    }
+    char_class->set(c);
+    if (character != NULL) {
+      *character = c;
+    }
+    return true;
+  }
+
+  static bool IsPrintableAscii(char c) { return ' ' <= c && c <= '~'; }
+
+  static bool IsAlphanumeric(char c) {
+    return ('0' <= c && c <= '9') || ('A' <= c && c <= 'Z') ||
+           ('a' <= c && c <= 'z');
+  }
+
+  static bool IsLiteral(char c) {
+    return IsPrintableAscii(c) && std::strchr("\\^$.|?*+()[]{}", c) == NULL;
+  }
+
+  const std::string& pattern_;
+  size_t pos_;
+  std::vector<CharClass>* const classes_;
+  std::vector<uint64>* const skips_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShapeCompiler);
+};
+
+}  // namespace
+
+PostalCodeMatcher::PostalCodeMatcher(const std::string& pattern)
+    : pattern_(pattern),
+      classes_(),
+      skips_(),
+      regexp_(NULL) {
+  ShapeCompiler compiler(pattern_, &classes_, &skips_);
+  if (!compiler.Compile()) {
+    classes_.clear();
+    skips_.clear();
+  }
+}
+
+PostalCodeMatcher::~PostalCodeMatcher() {
+  delete regexp_;
+}
+
+bool PostalCodeMatcher::ok() const {
+  return is_specialized() || GetRegexp().ptr->ok();
+}
+
+bool PostalCodeMatcher::FullMatch(const std::string& postal_code) const {
+  if (!is_specialized()) {
+    return RE2::FullMatch(postal_code, *GetRegexp().ptr);
+  }
+  return Match(postal_code, false);
+}
+
+bool PostalCodeMatcher::PrefixMatch(const std::string& postal_code) const {
+  if (!is_specialized()) {
+    return RE2::PartialMatch(postal_code, *GetRegexp().ptr);
+  }
+  return Match(postal_code, true);
+}
+
+size_t PostalCodeMatcher::GetMemoryUsage() const {
+  // The size of an RE2 program instruction, which is close to the number of
+  // bytes per instruction that RE2 needs for both its programs and its cache.
+  static const size_t kBytesPerInstruction = 16;
+
+  size_t bytes = sizeof *this + pattern_.capacity() +
+                 classes_.capacity() * sizeof(CharClass) +
+                 skips_.capacity() * sizeof(uint64);
+  const RE2ptr* regexp = AcquireLoad(&regexp_);
+  if (regexp != NULL) {
+    bytes += sizeof *regexp + sizeof *regexp->ptr + 2 * pattern_.size() +
+             regexp->ptr->ProgramSize() * kBytesPerInstruction;
+  }
+  return bytes;
+}
+
+const RE2ptr& PostalCodeMatcher::GetRegexp() const {
+  assert(!is_specialized());
+  const RE2ptr* regexp = AcquireLoad(&regexp_);
+  if (regexp == NULL) {
+    // The pattern is anchored to the beginning of the string so that it can be
+    // used either with RE2::PartialMatch() to perform prefix matching or else
+    // with RE2::FullMatch() to perform matching against the entire string.
+    RE2::Options options;
+    options.set_never_capture(true);
+    const RE2ptr* compiled =
+        new RE2ptr(new RE2("^(" + pattern_ + ")", options));
+    // If another thread got there first, use its object instead.
+    if (CompareAndSwap(&regexp_, regexp, compiled)) {
+      regexp = compiled;
+    } else {
+      delete compiled;
+      regexp = AcquireLoad(&regexp_);
+    }
+  }
+  assert(regexp != NULL);
+  return *regexp;
+}
+
+bool PostalCodeMatcher::Match(const std::string& postal_code,
+                              bool prefix) const {
+  const uint64 accept = static_cast<uint64>(1) << classes_.size();
+  uint64 states = Closure(1);
+  for (std::string::const_iterator
+       it = postal_code.begin(); it != postal_code.end(); ++it) {
+    if (prefix && (states & accept) != 0) {
+      return true;
+    }
+    unsigned char c = static_cast<unsigned char>(*it);
+    uint64 next = 0;
+    if (c < 128) {
+      for (size_t i = 0; i < classes_.size(); ++i) {
+        if ((states & (static_cast<uint64>(1) << i)) != 0 && classes_[i][c]) {
+          next |= static_cast<uint64>(1) << (i + 1);
+        }
+      }
+    }
+    states = Closure(next);
+    if (states == 0) {
+      return false;
+    }
+  }
+  return (states & accept) != 0;
+}
+
+uint64 PostalCodeMatcher::Closure(uint64 states) const {
+  // All skips go forward, so a single pass in state order is enough.
+  for (size_t i = 0; i < skips_.size(); ++i) {
+    if ((states & (static_cast<uint64>(1) << i)) != 0) {
+      states |= skips_[i];
+    }
+  }
+  return states;
+}
+
+}  // namespace addressinput
+}  // namespace i18n
@@ -0,0 +1,111 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Matching of postal codes against the "zip" regular expressions of the
+// address metadata.
+
+#ifndef I18N_ADDRESSINPUT_POSTAL_CODE_MATCHER_H_
+#define I18N_ADDRESSINPUT_POSTAL_CODE_MATCHER_H_
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <bitset>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+struct RE2ptr;
+
+// Matches strings against a postal code regular expression. Sample usage:
+//    PostalCodeMatcher matcher("\\d{5}(?:[ \\-]\\d{4})?");
+//    if (matcher.ok() && matcher.FullMatch("94043")) {
+//      ...
+//    }
+//
+// Most postal code patterns have a simple fixed shape, built only from
+// character classes, \d, literal characters, bounded repetitions, optional
+// groups and alternations. Such a pattern is compiled into a small state
+// machine with one character class per state, which is much cheaper both to
+// compile and to run than an RE2 object. Any other pattern is compiled into an
+// RE2 object instead, the first time that it's needed.
+//
+// All const methods can be called from any number of threads at the same
+// time.
+class PostalCodeMatcher {
+ public:
+  // Compiles |pattern|, which is a regular expression from the "zip" field of
+  // a rule. Check ok() to see whether |pattern| was valid.
+  explicit PostalCodeMatcher(const std::string& pattern);
+  ~PostalCodeMatcher();
+
+  // Returns false if |pattern| wasn't a valid regular expression. This
+  // compiles the RE2 object, if needed, so it can be left out for patterns
+  // that are already known to be valid.
+  bool ok() const;
+
+  // Returns the pattern that this object was constructed from.
+  const std::string& pattern() const { return pattern_; }
+
+  // Returns true if the pattern was compiled into a state machine, instead of
+  // into an RE2 object.
+  bool is_specialized() const { return !skips_.empty(); }
+
+  // Returns a rough estimate of the number of bytes of memory used by this
+  // object, including the RE2 object if it has been compiled.
+  size_t GetMemoryUsage() const;
+
+  // Returns true if all of |postal_code| matches the pattern.
+  bool FullMatch(const std::string& postal_code) const;
+
+  // Returns true if some prefix of |postal_code| matches the pattern.
+  bool PrefixMatch(const std::string& postal_code) const;
+
+ private:
+  // The set of ASCII characters that a state accepts.
+  typedef std::bitset<128> CharClass;
+
+  // Runs the state machine over |postal_code|.
+  bool Match(const std::string& postal_code, bool prefix) const;
+
+  // Returns the RE2 object, compiling it if this hasn't been done already.
+  // Must not be called if is_specialized() returns true.
+  const RE2ptr& GetRegexp() const;
+
+  // Returns |states| together with all states reachable from them without
+  // consuming any character.
+  uint64 Closure(uint64 states) const;
+
+  const std::string pattern_;
+
+  // State i moves to state i + 1 on the characters in classes_[i], and to
+  // all states in skips_[i] without consuming any character. The last state,
+  // which is the only accepting state, has no class. All skips go forward.
+  std::vector<CharClass> classes_;
+  std::vector<uint64> skips_;
+
+  // The RE2 object, for patterns that can't be compiled into a state machine,
+  // or NULL if not yet compiled. Set only once, through CompareAndSwap(), and
+  // deleted by the destructor.
+  mutable const RE2ptr* regexp_;
+
+  DISALLOW_COPY_AND_ASSIGN(PostalCodeMatcher);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_POSTAL_CODE_MATCHER_H_
@@ -24,7 +24,6 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
-#include <functional>
 #include <map>
 #include <set>
 #include <stack>
@@ -32,62 +31,355 @@
 #include <utility>
 #include <vector>
 
+#if !defined(_WIN32)
+#include <time.h>
+#endif  // Else <windows.h> is included by util/mutex.h.
+
 #include "lookup_key.h"
 #include "region_data_constants.h"
 #include "retriever.h"
 #include "rule.h"
+#include "util/atomic.h"
 #include "util/json.h"
+#include "util/mutex.h"
+#include "util/read_copy_update.h"
+#include "util/shared_string.h"
+#include "util/snapshot_io.h"
 #include "util/string_compare.h"
+#include "util/thread_pool.h"
 
 namespace i18n {
 namespace addressinput {
 
-namespace {
-
-// STL predicate less<> that uses StringCompare to match strings that a human
-// reader would consider to be "the same". The default implementation just does
-// case insensitive string comparison, but StringCompare can be overriden with
-// more sophisticated implementations.
-class IndexLess : public std::binary_function<std::string, std::string, bool> {
+// The rules of one region, which never change after having been published to
+// the readers.
+class RegionRules {
  public:
-  result_type operator()(const first_argument_type& a,
-                         const second_argument_type& b) const {
-    static const StringCompare kStringCompare;
-    return kStringCompare.NaturalLess(a, b);
+  RegionRules()
+      : generation_(0),
+        rule_storage_(),
+        region_rules_(),
+        index_(),
+        exact_index_() {}
+
+  ~RegionRules() {
+    for (std::vector<const Rule*>::const_iterator
+         it = rule_storage_.begin(); it != rule_storage_.end(); ++it) {
+      delete *it;
+    }
   }
-};
 
-}  // namespace
+  // Takes ownership of |rule|, and adds it under its ID.
+  void AddRule(const Rule* rule) {
+    assert(rule != NULL);
+    rule_storage_.push_back(rule);
+    region_rules_.insert(
+        region_rules_.end(), std::make_pair(rule->GetId(), rule));
+    AddKey(rule->GetId(), rule);
+  }
+
+  // Adds |rule| under |key|, unless it's already got a key that StringCompare
+  // considers to be the same.
+  void AddKey(const std::string& key, const Rule* rule) {
+    assert(rule != NULL);
+    std::map<std::string, const Rule*>::const_iterator it = index_.insert(
+        std::make_pair(StringCompare::NaturalSortKey(key), rule)).first;
+    exact_index_.insert(std::make_pair(key, it->second));
+  }
+
+  // Returns the rule for the ID |id|, or NULL if there is none.
+  const Rule* GetRuleForId(const std::string& id) const {
+    std::map<std::string, const Rule*>::const_iterator it =
+        region_rules_.find(id);
+    return it != region_rules_.end() ? it->second : NULL;
+  }
+
+  // Returns the rule for |key|, or NULL if there is none. The rule can have
+  // been added under any key that a human reader would consider to be the same
+  // as |key|, eg. with different capitalization.
+  const Rule* Find(const std::string& key) const {
+    // Looking up the key as it is avoids computing the sort key, which for
+    // non-ASCII strings means locking a shared cache, in the common case that
+    // there's an exact match.
+    std::map<std::string, const Rule*>::const_iterator it =
+        exact_index_.find(key);
+    if (it != exact_index_.end()) {
+      return it->second;
+    }
+    it = index_.find(StringCompare::NaturalSortKey(key));
+    return it != index_.end() ? it->second : NULL;
+  }
+
+  size_t size() const { return rule_storage_.size(); }
+
+  int generation() const { return generation_; }
+  void set_generation(int generation) { generation_ = generation; }
+
+  const std::map<std::string, const Rule*>& region_rules() const {
+    return region_rules_;
+  }
+
+  // Writes the rules and the indexes to |writer|, so that the indexes refer to
+  // each rule by its position in |rule_storage_|.
+  void WriteSnapshot(SnapshotWriter* writer) const {
+    assert(writer != NULL);
+    std::map<const Rule*, uint32> positions;
+    writer->WriteUint32(static_cast<uint32>(rule_storage_.size()));
+    for (std::vector<const Rule*>::const_iterator
+         it = rule_storage_.begin(); it != rule_storage_.end(); ++it) {
+      positions.insert(std::make_pair(
+          *it, static_cast<uint32>(it - rule_storage_.begin())));
+      (*it)->WriteSnapshot(writer);
+    }
+    WriteIndex(index_, positions, writer);
+    WriteIndex(exact_index_, positions, writer);
+  }
 
-class IndexMap : public std::map<std::string, const Rule*, IndexLess> {};
+  // Reads rules and indexes written by WriteSnapshot() into this object, which
+  // must be empty. Returns false if the data isn't valid.
+  bool ParseSnapshot(SnapshotReader* reader) {
+    assert(reader != NULL);
+    assert(rule_storage_.empty());
+    size_t size;
+    // Each rule takes more than 32 bytes.
+    if (!reader->ReadCount(32, &size)) {
+      return false;
+    }
+    rule_storage_.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+      Rule* rule = new Rule;
+      rule_storage_.push_back(rule);
+      if (!rule->ParseSnapshot(reader)) {
+        return false;
+      }
+      region_rules_.insert(
+          region_rules_.end(), std::make_pair(rule->GetId(), rule));
+    }
+    return ReadIndex(reader, &index_) && ReadIndex(reader, &exact_index_);
+  }
+
+ private:
+  static void WriteIndex(const std::map<std::string, const Rule*>& index,
+                         const std::map<const Rule*, uint32>& positions,
+                         SnapshotWriter* writer) {
+    writer->WriteUint32(static_cast<uint32>(index.size()));
+    for (std::map<std::string, const Rule*>::const_iterator
+         it = index.begin(); it != index.end(); ++it) {
+      std::map<const Rule*, uint32>::const_iterator position =
+          positions.find(it->second);
+      assert(position != positions.end());
+      writer->WriteString(it->first);
+      writer->WriteUint32(position->second);
+    }
+  }
+
+  bool ReadIndex(SnapshotReader* reader,
+                 std::map<std::string, const Rule*>* index) const {
+    size_t size;
+    if (!reader->ReadCount(8, &size)) {
+      return false;
+    }
+    std::string key;
+    uint32 position;
+    for (size_t i = 0; i < size; ++i) {
+      if (!reader->ReadString(&key) ||
+          !reader->ReadUint32(&position) ||
+          position >= rule_storage_.size()) {
+        return false;
+      }
+      // The keys were written in order, so each goes at the end.
+      index->insert(index->end(), std::make_pair(key, rule_storage_[position]));
+    }
+    return true;
+  }
+
+  int generation_;
+  std::vector<const Rule*> rule_storage_;
+
+  // The rules by ID, with exact string comparison for keys.
+  std::map<std::string, const Rule*> region_rules_;
+
+  // The rules by ID and by human readable and Latin script names, keyed by the
+  // StringCompare::NaturalSortKey() of each of these.
+  std::map<std::string, const Rule*> index_;
+
+  // The same rules as in |index_|, keyed by the keys as they were added.
+  std::map<std::string, const Rule*> exact_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegionRules);
+};
 
 namespace {
 
+// Parses the aggregated JSON rules in |data| and adds them to |rules|, which
+// isn't yet visible to any other thread. Returns false on parse failure.
+bool BuildRules(const std::string& data, RegionRules* rules) {
+  assert(rules != NULL);
+
+  Json json;
+  std::string id;
+  std::vector<const Rule*> sub_rules;
+
+  if (!json.ParseObject(data)) {
+    return false;
+  }
+
+  for (std::vector<const Json*>::const_iterator
+       it = json.GetSubDictionaries().begin();
+       it != json.GetSubDictionaries().end();
+       ++it) {
+    const Json* value = *it;
+    assert(value != NULL);
+    if (!value->GetStringValueForKey("id", &id)) {
+      return false;
+    }
+    assert(!id.empty());
+
+    size_t depth = std::count(id.begin(), id.end(), '/') - 1;
+    assert(depth < arraysize(LookupKey::kHierarchy));
+    AddressField field = LookupKey::kHierarchy[depth];
+
+    Rule* rule = new Rule;
+    if (field == COUNTRY) {
+      // All rules on the COUNTRY level inherit from the default rule.
+      rule->CopyFrom(Rule::GetDefault());
+    }
+    rule->ParseJsonRule(*value);
+    assert(id == rule->GetId());  // Sanity check.
+
+    // Add the ID of this Rule object both to the region-specific rule index
+    // with exact string comparison for keys, and to the rule index with
+    // natural string comparison for keys.
+    rules->AddRule(rule);
+    if (depth > 0) {
+      sub_rules.push_back(rule);
+    }
+  }
+
+  /*
+   * Normally the address metadata server takes care of mapping from natural
+   * language names to metadata IDs (eg. "São Paulo" -> "SP") and from Latin
+   * script names to local script names (eg. "Tokushima" -> "徳島県").
+   *
+   * As the PreloadSupplier doesn't contact the metadata server upon each
+   * Supply() request, it instead has an internal lookup table (the index of
+   * each RegionRules object) that contains such mappings.
+   *
+   * This lookup table is populated by iterating over all sub rules and for
+   * each of them construct ID strings using human readable names (eg. "São
+   * Paulo") and using Latin script names (eg. "Tokushima").
+   */
+  for (std::vector<const Rule*>::const_iterator
+       it = sub_rules.begin(); it != sub_rules.end(); ++it) {
+    std::stack<const Rule*> hierarchy;
+    hierarchy.push(*it);
+
+    // Push pointers to all parent Rule objects onto the hierarchy stack.
+    for (std::string parent_id((*it)->GetId());;) {
+      // Strip the last part of parent_id. Break if COUNTRY level is reached.
+      std::string::size_type pos = parent_id.rfind('/');
+      if (pos == sizeof "data/ZZ" - 1) {
+        break;
+      }
+      parent_id.resize(pos);
+
+      const Rule* parent = rules->GetRuleForId(parent_id);
+      assert(parent != NULL);
+      hierarchy.push(parent);
+    }
+
+    std::string human_id((*it)->GetId().substr(0, sizeof "data/ZZ" - 1));
+    std::string latin_id(human_id);
+
+    // Append the names from all Rule objects on the hierarchy stack.
+    for (; !hierarchy.empty(); hierarchy.pop()) {
+      const Rule* rule = hierarchy.top();
+
+      human_id.push_back('/');
+      if (!rule->GetName().empty()) {
+        human_id.append(rule->GetName());
+      } else {
+        // If the "name" field is empty, the name is the last part of the ID.
+        const std::string& id = rule->GetId();
+        std::string::size_type pos = id.rfind('/');
+        assert(pos != std::string::npos);
+        human_id.append(id.substr(pos + 1));
+      }
+
+      if (!rule->GetLatinName().empty()) {
+        latin_id.push_back('/');
+        latin_id.append(rule->GetLatinName());
+      }
+    }
+
+    // If the ID has a language tag, copy it.
+    {
+      const std::string& id = (*it)->GetId();
+      std::string::size_type pos = id.rfind("--");
+      if (pos != std::string::npos) {
+        human_id.append(id, pos, id.size() - pos);
+      }
+    }
+
+    rules->AddKey(human_id, *it);
+
+    // Add the Latin script ID, if a Latin script name could be found for
+    // every part of the ID.
+    if (std::count(human_id.begin(), human_id.end(), '/') ==
+        std::count(latin_id.begin(), latin_id.end(), '/')) {
+      rules->AddKey(latin_id, *it);
+    }
+  }
+
+  return true;
+}
+
+// Publishes |rules| into |region_rules|, taking ownership of it, and returns
+// the rules that were published there before, if any, which can't be deleted
+// until readers are done with them. Must be called with the mutex held, so
+// that only one thread at a time replaces the rules of a region.
+const RegionRules* PublishRules(RegionRules* rules,
+                                const RegionRules** region_rules) {
+  assert(rules != NULL);
+  assert(region_rules != NULL);
+  const RegionRules* old_rules = AcquireLoad(region_rules);
+  rules->set_generation(old_rules != NULL ? old_rules->generation() + 1 : 1);
+  ReleaseStore(region_rules, static_cast<const RegionRules*>(rules));
+  return old_rules;
+}
+
 class Helper {
  public:
-  // Does not take ownership of its parameters.
+  // Does not take ownership of its parameters. The |key| must already have
+  // been added to |pending|. The rules are published into |region_rules|,
+  // replacing any rules published there before. If |reload| is true, then the
+  // data is got from the source even if it's fresh in storage.
   Helper(const std::string& region_code,
          const std::string& key,
+         bool reload,
          const PreloadSupplier::Callback& loaded,
          const Retriever& retriever,
+         ReadCopyUpdate* rcu,
+         Mutex* mutex,
          std::set<std::string>* pending,
-         IndexMap* rule_index,
-         std::vector<const Rule*>* rule_storage,
-         std::map<std::string, const Rule*>* region_rules)
+         const RegionRules** region_rules)
       : region_code_(region_code),
         loaded_(loaded),
+        rcu_(rcu),
+        mutex_(mutex),
         pending_(pending),
-        rule_index_(rule_index),
-        rule_storage_(rule_storage),
         region_rules_(region_rules),
         retrieved_(BuildCallback(this, &Helper::OnRetrieved)) {
+    assert(rcu_ != NULL);
+    assert(mutex_ != NULL);
     assert(pending_ != NULL);
-    assert(rule_index_ != NULL);
-    assert(rule_storage_ != NULL);
     assert(region_rules_ != NULL);
     assert(retrieved_ != NULL);
-    pending_->insert(key);
-    retriever.Retrieve(key, *retrieved_);
+    if (reload) {
+      retriever.Refresh(key, *retrieved_);
+    } else {
+      retriever.Retrieve(key, *retrieved_);
+    }
   }
 
  private:
@@ -96,197 +388,296 @@ class Helper {
   void OnRetrieved(bool success,
                    const std::string& key,
                    const std::string& data) {
-    int rule_count = 0;
+    scoped_ptr<RegionRules> rules(new RegionRules);
+    if (success) {
+      success = BuildRules(data, rules.get());
+    }
+    int rule_count = static_cast<int>(rules->size());
+
+    // Only one Helper object at a time loads the rules of a region, so nothing
+    // else can replace or delete |old_rules|.
+    const RegionRules* old_rules = NULL;
+    {
+      MutexLock lock(mutex_);
+      size_t status = pending_->erase(key);
+      assert(status == 1);  // There will always be one item erased from the set.
+      (void)status;  // Prevent unused variable if assert() is optimized away.
+
+      if (success) {
+        old_rules = PublishRules(rules.release(), region_rules_);
+      }
+    }
 
-    size_t status = pending_->erase(key);
-    assert(status == 1);  // There will always be one item erased from the set.
-    (void)status;  // Prevent unused variable if assert() is optimized away.
+    if (old_rules != NULL) {
+      // Readers that got the old rules before they were replaced may still be
+      // using them.
+      rcu_->Retire(old_rules);
+    }
 
-    Json json;
-    std::string id;
-    std::vector<const Rule*> sub_rules;
+    loaded_(success, region_code_, rule_count);
+    delete this;
+  }
 
-    IndexMap::iterator last_index_it = rule_index_->end();
-    IndexMap::iterator last_latin_it = rule_index_->end();
-    std::map<std::string, const Rule*>::iterator last_region_it =
-        region_rules_->end();
+  const std::string region_code_;
+  const PreloadSupplier::Callback& loaded_;
+  ReadCopyUpdate* const rcu_;
+  Mutex* const mutex_;
+  std::set<std::string>* const pending_;
+  const RegionRules** const region_rules_;
+  const scoped_ptr<const Retriever::Callback> retrieved_;
 
-    IndexMap::const_iterator hints[arraysize(LookupKey::kHierarchy) - 1];
-    std::fill(hints, hints + arraysize(hints), rule_index_->end());
+  DISALLOW_COPY_AND_ASSIGN(Helper);
+};
 
-    if (!success) {
-      goto callback;
-    }
+std::string KeyFromRegionCode(const std::string& region_code) {
+  AddressData address;
+  address.region_code = region_code;
+  LookupKey lookup_key;
+  lookup_key.FromAddress(address);
+  return lookup_key.ToKeyString(0);  // Zero depth = COUNTRY level.
+}
+
+// Returns the time in seconds since some fixed point in the past.
+double GetSeconds() {
+#if defined(_WIN32)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER now;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&now);
+  return static_cast<double>(now.QuadPart) / frequency.QuadPart;
+#else
+  timespec now;
+  int status = clock_gettime(CLOCK_MONOTONIC, &now);
+  assert(status == 0);
+  (void)status;  // Prevent unused variable if assert() is optimized away.
+  return now.tv_sec + now.tv_nsec / 1e9;
+#endif
+}
 
-    if (!json.ParseObject(data)) {
-      success = false;
-      goto callback;
+// Loads the rules for a list of regions. The data for all regions is first
+// retrieved, then parsed and indexed on a pool of worker threads by Run(), and
+// finally all the rules are published at once.
+class LoadAllHelper : public ThreadPool::Task {
+ public:
+  // Does not take ownership of its parameters. The keys of all |region_codes|
+  // must already have been added to |pending|. The rules for region_codes[i]
+  // are published into (*region_rules)[indices[i]].
+  LoadAllHelper(const std::vector<std::string>& region_codes,
+                const std::vector<size_t>& indices,
+                size_t num_threads,
+                const PreloadSupplier::LoadAllCallback& loaded,
+                const Retriever& retriever,
+                ReadCopyUpdate* rcu,
+                Mutex* mutex,
+                std::set<std::string>* pending,
+                std::vector<const RegionRules*>* region_rules)
+      : indices_(indices),
+        num_threads_(num_threads),
+        loaded_(loaded),
+        rcu_(rcu),
+        mutex_(mutex),
+        pending_(pending),
+        region_rules_(region_rules),
+        start_seconds_(GetSeconds()),
+        keys_(),
+        data_(region_codes.size()),
+        built_(region_codes.size()),
+        stats_(region_codes.size()),
+        data_mutex_(),
+        remaining_(region_codes.size() + 1),
+        retrieved_(BuildCallback(this, &LoadAllHelper::OnRetrieved)) {
+    assert(indices_.size() == region_codes.size());
+    assert(rcu_ != NULL);
+    assert(mutex_ != NULL);
+    assert(pending_ != NULL);
+    assert(region_rules_ != NULL);
+    assert(retrieved_ != NULL);
+    for (size_t i = 0; i < region_codes.size(); ++i) {
+      keys_.insert(std::make_pair(KeyFromRegionCode(region_codes[i]), i));
+      stats_[i].region_code = region_codes[i];
     }
+    // The extra count in |remaining_| keeps this object from being deleted
+    // by a callback until all retrievals have been started.
+    std::vector<std::string> keys;
+    keys.reserve(keys_.size());
+    for (std::map<std::string, size_t>::const_iterator
+         it = keys_.begin(); it != keys_.end(); ++it) {
+      keys.push_back(it->first);
+    }
+    retriever.RetrieveMulti(keys, *retrieved_);
+    OnRegionDone();
+  }
 
-    for (std::vector<const Json*>::const_iterator
-         it = json.GetSubDictionaries().begin();
-         it != json.GetSubDictionaries().end();
-         ++it) {
-      const Json* value = *it;
-      assert(value != NULL);
-      if (!value->GetStringValueForKey("id", &id)) {
-        success = false;
-        goto callback;
+  // ThreadPool::Task implementation.
+  virtual void Run(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (!stats_[i].success) {
+        continue;
       }
-      assert(!id.empty());
-
-      size_t depth = std::count(id.begin(), id.end(), '/') - 1;
-      assert(depth < arraysize(LookupKey::kHierarchy));
-      AddressField field = LookupKey::kHierarchy[depth];
+      double start_seconds = GetSeconds();
+      built_[i] = new RegionRules;
+      stats_[i].success = BuildRules(data_[i].get(), built_[i]);
+      stats_[i].num_rules = static_cast<int>(built_[i]->size());
+      stats_[i].build_seconds = GetSeconds() - start_seconds;
+      data_[i] = SharedString();  // Free the memory now.
+    }
+  }
 
-      Rule* rule = new Rule;
-      if (field == COUNTRY) {
-        // All rules on the COUNTRY level inherit from the default rule.
-        rule->CopyFrom(Rule::GetDefault());
-      }
-      rule->ParseJsonRule(*value);
-      assert(id == rule->GetId());  // Sanity check.
+ private:
+  virtual ~LoadAllHelper() {
+    for (std::vector<RegionRules*>::const_iterator
+         it = built_.begin(); it != built_.end(); ++it) {
+      delete *it;
+    }
+  }
 
-      rule_storage_->push_back(rule);
-      if (depth > 0) {
-        sub_rules.push_back(rule);
+  void OnRetrieved(bool success,
+                   const std::string& key,
+                   const SharedString& data) {
+    std::map<std::string, size_t>::const_iterator it = keys_.find(key);
+    assert(it != keys_.end());
+    {
+      MutexLock lock(&data_mutex_);
+      stats_[it->second].success = success;
+      if (success) {
+        data_[it->second] = data;
       }
+    }
+    OnRegionDone();
+  }
 
-      // Add the ID of this Rule object to the rule index with natural string
-      // comparison for keys.
-      last_index_it =
-          rule_index_->insert(last_index_it, std::make_pair(id, rule));
-
-      // Add the ID of this Rule object to the region-specific rule index with
-      // exact string comparison for keys.
-      last_region_it =
-          region_rules_->insert(last_region_it, std::make_pair(id, rule));
-
-      ++rule_count;
-    }
-
-    /*
-     * Normally the address metadata server takes care of mapping from natural
-     * language names to metadata IDs (eg. "São Paulo" -> "SP") and from Latin
-     * script names to local script names (eg. "Tokushima" -> "徳島県").
-     *
-     * As the PreloadSupplier doesn't contact the metadata server upon each
-     * Supply() request, it instead has an internal lookup table (rule_index_)
-     * that contains such mappings.
-     *
-     * This lookup table is populated by iterating over all sub rules and for
-     * each of them construct ID strings using human readable names (eg. "São
-     * Paulo") and using Latin script names (eg. "Tokushima").
-     */
-    for (std::vector<const Rule*>::const_iterator
-         it = sub_rules.begin(); it != sub_rules.end(); ++it) {
-      std::stack<const Rule*> hierarchy;
-      hierarchy.push(*it);
-
-      // Push pointers to all parent Rule objects onto the hierarchy stack.
-      for (std::string parent_id((*it)->GetId());;) {
-        // Strip the last part of parent_id. Break if COUNTRY level is reached.
-        std::string::size_type pos = parent_id.rfind('/');
-        if (pos == sizeof "data/ZZ" - 1) {
-          break;
-        }
-        parent_id.resize(pos);
-
-        IndexMap::const_iterator* const hint = &hints[hierarchy.size() - 1];
-        if (*hint == rule_index_->end() || (*hint)->first != parent_id) {
-          *hint = rule_index_->find(parent_id);
-        }
-        assert(*hint != rule_index_->end());
-        hierarchy.push((*hint)->second);
-      }
+  void OnRegionDone() {
+    bool done;
+    {
+      MutexLock lock(&data_mutex_);
+      done = --remaining_ == 0;
+    }
+    if (done) {
+      Build();
+    }
+  }
 
-      std::string human_id((*it)->GetId().substr(0, sizeof "data/ZZ" - 1));
-      std::string latin_id(human_id);
-
-      // Append the names from all Rule objects on the hierarchy stack.
-      for (; !hierarchy.empty(); hierarchy.pop()) {
-        const Rule* rule = hierarchy.top();
-
-        human_id.push_back('/');
-        if (!rule->GetName().empty()) {
-          human_id.append(rule->GetName());
-        } else {
-          // If the "name" field is empty, the name is the last part of the ID.
-          const std::string& id = rule->GetId();
-          std::string::size_type pos = id.rfind('/');
-          assert(pos != std::string::npos);
-          human_id.append(id.substr(pos + 1));
-        }
+  void Build() {
+    // Initialize the static data used for parsing rules before any worker
+    // thread needs it, instead of several worker threads racing to do so.
+    Rule::GetDefault();
+    {
+      ThreadPool pool(num_threads_);
+      pool.ParallelFor(stats_.size(), 1, this);
+    }
 
-        if (!rule->GetLatinName().empty()) {
-          latin_id.push_back('/');
-          latin_id.append(rule->GetLatinName());
+    bool success = true;
+    std::vector<const RegionRules*> old_rules;
+    {
+      MutexLock lock(mutex_);
+      for (std::map<std::string, size_t>::const_iterator
+           it = keys_.begin(); it != keys_.end(); ++it) {
+        size_t i = it->second;
+        size_t status = pending_->erase(it->first);
+        assert(status == 1);
+        (void)status;  // Prevent unused variable if assert() is optimized away.
+        if (!stats_[i].success) {
+          success = false;
+          continue;
         }
-      }
-
-      // If the ID has a language tag, copy it.
-      {
-        const std::string& id = (*it)->GetId();
-        std::string::size_type pos = id.rfind("--");
-        if (pos != std::string::npos) {
-          human_id.append(id, pos, id.size() - pos);
+        const RegionRules* old =
+            PublishRules(built_[i], &(*region_rules_)[indices_[i]]);
+        built_[i] = NULL;
+        if (old != NULL) {
+          old_rules.push_back(old);
         }
       }
+    }
 
-      last_index_it =
-          rule_index_->insert(last_index_it, std::make_pair(human_id, *it));
-
-      // Add the Latin script ID, if a Latin script name could be found for
-      // every part of the ID.
-      if (std::count(human_id.begin(), human_id.end(), '/') ==
-          std::count(latin_id.begin(), latin_id.end(), '/')) {
-        last_latin_it =
-            rule_index_->insert(last_latin_it, std::make_pair(latin_id, *it));
-      }
+    // Readers that got the old rules before they were replaced may still be
+    // using them.
+    for (std::vector<const RegionRules*>::const_iterator
+         it = old_rules.begin(); it != old_rules.end(); ++it) {
+      rcu_->Retire(*it);
     }
 
-  callback:
-    loaded_(success, region_code_, rule_count);
+    loaded_(success, stats_, GetSeconds() - start_seconds_);
     delete this;
   }
 
-  const std::string region_code_;
-  const PreloadSupplier::Callback& loaded_;
+  const std::vector<size_t> indices_;
+  const size_t num_threads_;
+  const PreloadSupplier::LoadAllCallback& loaded_;
+  ReadCopyUpdate* const rcu_;
+  Mutex* const mutex_;
   std::set<std::string>* const pending_;
-  IndexMap* const rule_index_;
-  std::vector<const Rule*>* const rule_storage_;
-  std::map<std::string, const Rule*>* const region_rules_;
-  const scoped_ptr<const Retriever::Callback> retrieved_;
+  std::vector<const RegionRules*>* const region_rules_;
+  const double start_seconds_;
 
-  DISALLOW_COPY_AND_ASSIGN(Helper);
+  // The index into the vectors below of the region of each key.
+  std::map<std::string, size_t> keys_;
+
+  // The data retrieved, the rules built from it, and the stats of each region.
+  // The data is shared with the retriever, so that it isn't copied.
+  std::vector<SharedString> data_;
+  std::vector<RegionRules*> built_;
+  std::vector<PreloadSupplier::RegionLoadStats> stats_;
+
+  // Guards |data_| and |stats_| until all data has been retrieved, and
+  // |remaining_|.
+  Mutex data_mutex_;
+  size_t remaining_;
+
+  const scoped_ptr<const Retriever::SharedCallback> retrieved_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadAllHelper);
 };
 
-std::string KeyFromRegionCode(const std::string& region_code) {
-  AddressData address;
-  address.region_code = region_code;
-  LookupKey lookup_key;
-  lookup_key.FromAddress(address);
-  return lookup_key.ToKeyString(0);  // Zero depth = COUNTRY level.
+// The first bytes of a snapshot, "LAIS" in ASCII, and the version of its
+// format, which must be changed whenever the format of the snapshot or the
+// meaning of anything in it (like message IDs) changes.
+const uint32 kSnapshotMagic = 0x5349414c;
+const uint32 kSnapshotVersion = 1;
+
+// Returns the index of |region_code| in RegionDataConstants::GetRegionCodes(),
+// or the size of that vector if it's not there.
+size_t GetRegionIndex(const std::string& region_code) {
+  const std::vector<std::string>& region_codes =
+      RegionDataConstants::GetRegionCodes();
+  std::vector<std::string>::const_iterator it = std::lower_bound(
+      region_codes.begin(), region_codes.end(), region_code);
+  if (it == region_codes.end() || *it != region_code) {
+    return region_codes.size();
+  }
+  return it - region_codes.begin();
 }
 
 }  // namespace
 
+PreloadSupplier::ReadSection::ReadSection(const PreloadSupplier& supplier)
+    : rcu_(*supplier.rcu_),
+      token_(rcu_.ReadLock()) {}
+
+PreloadSupplier::ReadSection::~ReadSection() {
+  rcu_.ReadUnlock(token_);
+}
+
 PreloadSupplier::PreloadSupplier(const Source* source, Storage* storage)
     : retriever_(new Retriever(source, storage)),
+      rcu_(new ReadCopyUpdate),
+      mutex_(new Mutex),
       pending_(),
-      rule_index_(new IndexMap),
-      rule_storage_(),
-      region_rules_() {}
+      region_rules_(RegionDataConstants::GetRegionCodes().size()) {}
 
 PreloadSupplier::~PreloadSupplier() {
-  for (std::vector<const Rule*>::const_iterator
-       it = rule_storage_.begin(); it != rule_storage_.end(); ++it) {
+  for (std::vector<const RegionRules*>::const_iterator
+       it = region_rules_.begin(); it != region_rules_.end(); ++it) {
     delete *it;
   }
 }
 
+void PreloadSupplier::set_storage_options(const StorageOptions& options) {
+  retriever_->set_options(options);
+}
+
 void PreloadSupplier::Supply(const LookupKey& lookup_key,
                              const Supplier::Callback& supplied) {
+  ReadSection section(*this);
   Supplier::RuleHierarchy hierarchy;
   bool success = GetRuleHierarchy(lookup_key, &hierarchy);
   supplied(success, lookup_key, hierarchy);
@@ -305,34 +696,190 @@ void PreloadSupplier::LoadRules(const std::string& region_code,
                                 const Callback& loaded) {
   const std::string& key = KeyFromRegionCode(region_code);
 
-  if (IsLoadedKey(key)) {
+  // The rules are published and the key is removed from |pending_| while
+  // holding the lock, so that the rules are loaded only once even if this is
+  // called from several threads.
+  bool is_loaded;
+  {
+    MutexLock lock(mutex_.get());
+    if (pending_.find(key) != pending_.end()) {
+      return;
+    }
+    is_loaded = IsLoaded(region_code);
+    if (!is_loaded) {
+      pending_.insert(key);
+    }
+  }
+
+  if (is_loaded) {
     loaded(true, region_code, 0);
     return;
   }
 
-  if (IsPendingKey(key)) {
+  StartLoading(region_code, key, false, loaded);
+}
+
+void PreloadSupplier::LoadAllRules(size_t num_threads,
+                                   const LoadAllCallback& loaded) {
+  const std::vector<std::string>& region_codes =
+      RegionDataConstants::GetRegionCodes();
+  std::vector<std::string> load_region_codes;
+  std::vector<size_t> indices;
+  {
+    MutexLock lock(mutex_.get());
+    for (size_t i = 0; i < region_codes.size(); ++i) {
+      if (AcquireLoad(&region_rules_[i]) == NULL &&
+          pending_.insert(KeyFromRegionCode(region_codes[i])).second) {
+        load_region_codes.push_back(region_codes[i]);
+        indices.push_back(i);
+      }
+    }
+  }
+
+  new LoadAllHelper(load_region_codes,
+                    indices,
+                    num_threads,
+                    loaded,
+                    *retriever_,
+                    rcu_.get(),
+                    mutex_.get(),
+                    &pending_,
+                    &region_rules_);
+}
+
+void PreloadSupplier::ReloadRules(const std::string& region_code,
+                                  const Callback& loaded) {
+  if (GetRegionIndex(region_code) == region_rules_.size()) {
+    loaded(true, region_code, 0);  // Nothing to load, as in IsLoaded().
     return;
   }
 
-  new Helper(
-      region_code,
-      key,
-      loaded,
-      *retriever_,
-      &pending_,
-      rule_index_.get(),
-      &rule_storage_,
-      &region_rules_[region_code]);
+  const std::string& key = KeyFromRegionCode(region_code);
+
+  {
+    MutexLock lock(mutex_.get());
+    if (!pending_.insert(key).second) {
+      return;
+    }
+  }
+
+  StartLoading(region_code, key, true, loaded);
+}
+
+void PreloadSupplier::SaveSnapshot(std::string* snapshot) const {
+  assert(snapshot != NULL);
+  snapshot->clear();
+  ReadSection section(*this);
+  std::vector<std::pair<size_t, const RegionRules*> > loaded;
+  for (size_t i = 0; i < region_rules_.size(); ++i) {
+    const RegionRules* rules = AcquireLoad(&region_rules_[i]);
+    if (rules != NULL) {
+      loaded.push_back(std::make_pair(i, rules));
+    }
+  }
+
+  const std::vector<std::string>& region_codes =
+      RegionDataConstants::GetRegionCodes();
+  SnapshotWriter writer(snapshot);
+  writer.WriteUint32(kSnapshotMagic);
+  writer.WriteUint32(kSnapshotVersion);
+  writer.WriteUint32(static_cast<uint32>(loaded.size()));
+  for (std::vector<std::pair<size_t, const RegionRules*> >::const_iterator
+       it = loaded.begin(); it != loaded.end(); ++it) {
+    writer.WriteString(region_codes[it->first]);
+    it->second->WriteSnapshot(&writer);
+  }
+}
+
+bool PreloadSupplier::LoadSnapshot(const char* data, size_t size) {
+  SnapshotReader reader(data, size);
+  uint32 magic;
+  uint32 version;
+  size_t region_count;
+  if (!reader.ReadUint32(&magic) || magic != kSnapshotMagic ||
+      !reader.ReadUint32(&version) || version != kSnapshotVersion ||
+      !reader.ReadCount(4, &region_count)) {
+    return false;
+  }
+
+  // All of the snapshot is read before anything is published, so that either
+  // all or none of it is loaded.
+  std::vector<std::pair<size_t, RegionRules*> > loaded;
+  std::set<size_t> indices;
+  std::string region_code;
+  bool success = true;
+  for (size_t i = 0; success && i < region_count; ++i) {
+    success = reader.ReadString(&region_code);
+    if (success) {
+      size_t index = GetRegionIndex(region_code);
+      success = index < region_rules_.size() && indices.insert(index).second;
+      if (success) {
+        RegionRules* rules = new RegionRules;
+        loaded.push_back(std::make_pair(index, rules));
+        success = rules->ParseSnapshot(&reader);
+      }
+    }
+  }
+
+  if (!success || !reader.AtEnd()) {
+    for (std::vector<std::pair<size_t, RegionRules*> >::const_iterator
+         it = loaded.begin(); it != loaded.end(); ++it) {
+      delete it->second;
+    }
+    return false;
+  }
+
+  std::vector<const RegionRules*> old_rules;
+  {
+    MutexLock lock(mutex_.get());
+    for (std::vector<std::pair<size_t, RegionRules*> >::const_iterator
+         it = loaded.begin(); it != loaded.end(); ++it) {
+      const RegionRules* old =
+          PublishRules(it->second, &region_rules_[it->first]);
+      if (old != NULL) {
+        old_rules.push_back(old);
+      }
+    }
+  }
+
+  // Readers that got the old rules before they were replaced may still be
+  // using them.
+  for (std::vector<const RegionRules*>::const_iterator
+       it = old_rules.begin(); it != old_rules.end(); ++it) {
+    rcu_->Retire(*it);
+  }
+
+  return true;
+}
+
+int PreloadSupplier::GetRulesGeneration(const std::string& region_code) const {
+  ReadSection section(*this);
+  const RegionRules* rules = GetRegionRules(region_code);
+  return rules != NULL ? rules->generation() : 0;
 }
 
 const std::map<std::string, const Rule*>& PreloadSupplier::GetRulesForRegion(
     const std::string& region_code) const {
   assert(IsLoaded(region_code));
-  return region_rules_.find(region_code)->second;
+  ReadSection section(*this);
+  const RegionRules* rules = GetRegionRules(region_code);
+  if (rules == NULL) {  // A region that isn't supported.
+    static const std::map<std::string, const Rule*> kNoRules;
+    return kNoRules;
+  }
+  return rules->region_rules();
 }
 
 bool PreloadSupplier::IsLoaded(const std::string& region_code) const {
-  return IsLoadedKey(KeyFromRegionCode(region_code));
+  if (GetRegionIndex(region_code) == region_rules_.size()) {
+    // The rules for a region that isn't supported would never be used, the
+    // same way as GetRuleHierarchy() never uses them, so there is nothing to
+    // load.
+    return true;
+  }
+  ReadSection section(*this);
+  const RegionRules* rules = GetRegionRules(region_code);
+  return rules != NULL && rules->Find(KeyFromRegionCode(region_code)) != NULL;
 }
 
 bool PreloadSupplier::IsPending(const std::string& region_code) const {
@@ -344,28 +891,55 @@ bool PreloadSupplier::GetRuleHierarchy(const LookupKey& lookup_key,
   assert(hierarchy != NULL);
 
   if (RegionDataConstants::IsSupported(lookup_key.GetRegionCode())) {
+    ReadSection section(*this);
+    const RegionRules* rules = GetRegionRules(lookup_key.GetRegionCode());
+    if (rules == NULL) {
+      return false;
+    }
+
     size_t max_depth = std::min(
         lookup_key.GetDepth(),
         RegionDataConstants::GetMaxLookupKeyDepth(lookup_key.GetRegionCode()));
 
     for (size_t depth = 0; depth <= max_depth; ++depth) {
-      const std::string& key = lookup_key.ToKeyString(depth);
-      IndexMap::const_iterator it = rule_index_->find(key);
-      if (it == rule_index_->end()) {
+      const Rule* rule = rules->Find(lookup_key.ToKeyString(depth));
+      if (rule == NULL) {
         return depth > 0;  // No data on COUNTRY level is failure.
       }
-      hierarchy->rule[depth] = it->second;
+      hierarchy->rule[depth] = rule;
     }
   }
 
   return true;
 }
 
-bool PreloadSupplier::IsLoadedKey(const std::string& key) const {
-  return rule_index_->find(key) != rule_index_->end();
+const RegionRules* PreloadSupplier::GetRegionRules(
+    const std::string& region_code) const {
+  size_t index = GetRegionIndex(region_code);
+  return index < region_rules_.size() ? AcquireLoad(&region_rules_[index])
+                                      : NULL;
+}
+
+void PreloadSupplier::StartLoading(const std::string& region_code,
+                                   const std::string& key,
+                                   bool reload,
+                                   const Callback& loaded) {
+  size_t index = GetRegionIndex(region_code);
+  assert(index < region_rules_.size());
+  new Helper(
+      region_code,
+      key,
+      reload,
+      loaded,
+      *retriever_,
+      rcu_.get(),
+      mutex_.get(),
+      &pending_,
+      &region_rules_[index]);
 }
 
 bool PreloadSupplier::IsPendingKey(const std::string& key) const {
+  MutexLock lock(mutex_.get());
   return pending_.find(key) != pending_.end();
 }
 
@@ -0,0 +1,45 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/problem_filter.h>
+
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/validation_result.h>
+
+#include <cstddef>
+
+namespace i18n {
+namespace addressinput {
+
+ProblemFilter::ProblemFilter()
+    : all_(true),
+      pairs_(),
+      problems_(0) {}
+
+ProblemFilter::ProblemFilter(const FieldProblemMap* filter)
+    : all_(filter == NULL || filter->empty()),
+      pairs_(),
+      problems_(0) {
+  if (all_) {
+    return;
+  }
+  pairs_ = ValidationResult(*filter);
+  for (FieldProblemMap::const_iterator
+       it = filter->begin(); it != filter->end(); ++it) {
+    problems_ |= 1 << it->second;
+  }
+}
+
+}  // namespace addressinput
+}  // namespace i18n
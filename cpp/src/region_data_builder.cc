@@ -172,6 +172,7 @@ const RegionData& RegionDataBuilder::Build(
   LanguageRegionMap::const_iterator language_it =
       region_it->second->find(best_language.tag);
   if (language_it == region_it->second->end()) {
+    PreloadSupplier::ReadSection section(*supplier_);
     const std::map<std::string, const Rule*>& rules =
         supplier_->GetRulesForRegion(region_code);
     language_it =
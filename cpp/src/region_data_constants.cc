@@ -30,6 +30,7 @@
 #include "address_field_util.h"
 #include "format_element.h"
 #include "lookup_key.h"
+#include "rule.h"
 
 namespace i18n {
 namespace addressinput {
@@ -1432,6 +1433,59 @@ const std::map<std::string, size_t> InitMaxLookupKeyDepth() {
   return max_depth;
 }
 
+// The fields used and required by a region, as bitmasks.
+struct FieldMasks {
+  int used;
+  int required;
+};
+
+std::map<std::string, FieldMasks> InitFieldMasks() {
+  std::map<std::string, FieldMasks> field_masks;
+  for (std::map<std::string, std::string>::const_iterator
+       it = GetAllRegionData().begin(); it != GetAllRegionData().end(); ++it) {
+    Rule rule;
+    rule.CopyFrom(Rule::GetDefault());
+    if (!rule.ParseSerializedRule(it->second)) {
+      continue;
+    }
+
+    FieldMasks masks = { 1 << COUNTRY, 1 << COUNTRY };
+    for (std::vector<FormatElement>::const_iterator
+         element_it = rule.GetFormat().begin();
+         element_it != rule.GetFormat().end(); ++element_it) {
+      if (element_it->IsField()) {
+        masks.used |= 1 << element_it->GetField();
+      }
+    }
+    for (std::vector<AddressField>::const_iterator
+         field_it = rule.GetRequired().begin();
+         field_it != rule.GetRequired().end(); ++field_it) {
+      masks.required |= 1 << *field_it;
+    }
+    field_masks.insert(std::make_pair(it->first, masks));
+  }
+  return field_masks;
+}
+
+std::map<std::string, std::vector<std::string> > InitLanguages() {
+  std::map<std::string, std::vector<std::string> > languages;
+  for (std::map<std::string, std::string>::const_iterator
+       it = GetAllRegionData().begin(); it != GetAllRegionData().end(); ++it) {
+    Rule rule;
+    if (rule.ParseSerializedRule(it->second)) {
+      languages.insert(std::make_pair(it->first, rule.GetLanguages()));
+    }
+  }
+  return languages;
+}
+
+const FieldMasks* GetFieldMasks(const std::string& region_code) {
+  static const std::map<std::string, FieldMasks> kFieldMasks(InitFieldMasks());
+  std::map<std::string, FieldMasks>::const_iterator it =
+      kFieldMasks.find(region_code);
+  return it != kFieldMasks.end() ? &it->second : NULL;
+}
+
 }  // namespace
 
 // static
@@ -1465,5 +1519,28 @@ size_t RegionDataConstants::GetMaxLookupKeyDepth(
   return it != kMaxDepth.end() ? it->second : 0;
 }
 
+// static
+const std::vector<std::string>& RegionDataConstants::GetLanguages(
+    const std::string& region_code) {
+  static const std::map<std::string, std::vector<std::string> > kLanguages(
+      InitLanguages());
+  static const std::vector<std::string> kNoLanguages;
+  std::map<std::string, std::vector<std::string> >::const_iterator it =
+      kLanguages.find(region_code);
+  return it != kLanguages.end() ? it->second : kNoLanguages;
+}
+
+// static
+int RegionDataConstants::GetUsedFields(const std::string& region_code) {
+  const FieldMasks* masks = GetFieldMasks(region_code);
+  return masks != NULL ? masks->used : 0;
+}
+
+// static
+int RegionDataConstants::GetRequiredFields(const std::string& region_code) {
+  const FieldMasks* masks = GetFieldMasks(region_code);
+  return masks != NULL ? masks->required : 0;
+}
+
 }  // namespace addressinput
 }  // namespace i18n
@@ -29,6 +29,18 @@ class RegionDataConstants {
   static const std::string& GetRegionData(const std::string& region_code);
   static const std::string& GetDefaultRegionData();
   static size_t GetMaxLookupKeyDepth(const std::string& region_code);
+
+  // Returns the language tags of the region data for |region_code|, parsed
+  // once for all regions, or an empty vector if there are none.
+  static const std::vector<std::string>& GetLanguages(
+      const std::string& region_code);
+
+  // Returns a bitmask of the fields used (or required) by |region_code|, where
+  // the bit for |field| is (1 << field). COUNTRY is always included. Returns 0
+  // if no data could be found for |region_code|. The masks for all regions are
+  // computed once, on the first call to either of these functions.
+  static int GetUsedFields(const std::string& region_code);
+  static int GetRequiredFields(const std::string& region_code);
 };
 
 }  // namespace addressinput
@@ -22,96 +22,266 @@
 
 #include <cassert>
 #include <cstddef>
+#include <map>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "util/mutex.h"
+#include "util/shared_string.h"
 #include "validating_storage.h"
 
 namespace i18n {
 namespace addressinput {
 
-namespace {
-
-class Helper {
+// Retrieves the data for several keys, first from storage and then, if
+// needed, from the source, with a single call to each. Deletes itself when
+// done.
+class Retriever::Helper {
  public:
-  // Does not take ownership of its parameters.
-  Helper(const std::string& key,
-         const Retriever::Callback& retrieved,
-         const Source& source,
-         ValidatingStorage* storage)
-      : retrieved_(retrieved),
-        source_(source),
-        storage_(storage),
+  // Does not take ownership of its parameters. If |refresh| is not NULL, then
+  // the data is got from the source even if it's fresh in storage, and handed
+  // to |refresh| instead of to the callbacks waiting in |in_flight_|.
+  Helper(const std::vector<std::string>& keys,
+         const Retriever& retriever,
+         const Waiter* refresh)
+      : retriever_(retriever),
+        refresh_(refresh != NULL),
+        waiter_(),
         fresh_data_ready_(BuildCallback(this, &Helper::OnFreshDataReady)),
         validated_data_ready_(
             BuildCallback(this, &Helper::OnValidatedDataReady)),
-        stale_data_() {
-    assert(storage_ != NULL);
-    storage_->Get(key, *validated_data_ready_);
+        stale_data_(),
+        refreshing_(),
+        fetch_keys_(),
+        storage_pending_(keys.size()),
+        source_pending_(0) {
+    assert(!keys.empty());
+    if (refresh != NULL) {
+      waiter_ = *refresh;
+    }
+    retriever_.storage_->GetMulti(keys, *validated_data_ready_);
   }
 
  private:
   ~Helper() {}
 
+  void Retrieved(bool success,
+                 const std::string& key,
+                 const SharedString& data) {
+    if (refresh_) {
+      Retriever::Invoke(waiter_, success, key, data);
+    } else {
+      (*retriever_.retrieved_)(success, key, data);
+    }
+  }
+
   void OnValidatedDataReady(bool success,
                             const std::string& key,
                             std::string* data) {
-    if (success) {
+    const SharedString shared(data);  // Takes ownership of |data|.
+    if (refresh_) {
+      // Data from storage, fresh or stale, is used only if the request fails.
+      if (!shared.get().empty()) {
+        stale_data_.insert(std::make_pair(key, shared));
+      }
+      fetch_keys_.push_back(key);
+    } else if (success) {
       assert(data != NULL);
-      retrieved_(success, key, *data);
-      delete this;
+      Retrieved(success, key, shared);
+    } else if (!shared.get().empty() && retriever_.stale_while_revalidate_) {
+      // Validating storage returns (false, key, stale-data) for valid but
+      // stale data. Use the stale data right away, and refresh it for later
+      // use, unless that is already being done.
+      Retrieved(true, key, shared);
+      if (retriever_.StartRefresh(key)) {
+        refreshing_.insert(key);
+        fetch_keys_.push_back(key);
+      }
     } else {
-      // Validating storage returns (false, key, stale-data) for valid but stale
-      // data. If |data| is empty, however, then it's either missing or invalid.
-      if (data != NULL && !data->empty()) {
-        stale_data_ = *data;
+      // If |data| is empty, then it's either missing or invalid.
+      if (!shared.get().empty()) {
+        stale_data_.insert(std::make_pair(key, shared));
       }
-      source_.Get(key, *fresh_data_ready_);
+      fetch_keys_.push_back(key);
+    }
+
+    assert(storage_pending_ > 0);
+    if (--storage_pending_ == 0) {
+      FetchFromSource();
     }
-    delete data;
+  }
+
+  void FetchFromSource() {
+    if (fetch_keys_.empty()) {
+      delete this;
+      return;
+    }
+    // The keys must outlive this object, which can be deleted by the final
+    // callback before GetMulti() returns.
+    std::vector<std::string> keys;
+    keys.swap(fetch_keys_);
+    source_pending_ = keys.size();
+    retriever_.source_->GetMulti(keys, *fresh_data_ready_);
   }
 
   void OnFreshDataReady(bool success,
                         const std::string& key,
                         std::string* data) {
-    if (success) {
+    std::map<std::string, SharedString>::const_iterator stale_it;
+    if (refreshing_.erase(key) > 0) {
+      // The stale data has already been used.
+      if (success) {
+        assert(data != NULL);
+        retriever_.storage_->Put(key, data);
+        data = NULL;  // Deleted by Storage::Put().
+      }
+      retriever_.RefreshDone(key);
+    } else if (success) {
       assert(data != NULL);
-      retrieved_(true, key, *data);
-      storage_->Put(key, data);
-      data = NULL;  // Deleted by Storage::Put().
-    } else if (!stale_data_.empty()) {
+      SharedString shared(data);
+      data = NULL;  // Owned by |shared|.
+      Retrieved(true, key, shared);
+      retriever_.storage_->Put(key, shared.Release());
+    } else if ((stale_it = stale_data_.find(key)) != stale_data_.end()) {
       // Reuse the stale data if a download fails. It's better to have slightly
       // outdated validation rules than to suddenly lose validation ability.
-      retrieved_(true, key, stale_data_);
+      Retrieved(true, key, stale_it->second);
     } else {
-      retrieved_(false, key, std::string());
+      Retrieved(false, key, SharedString());
     }
     delete data;
-    delete this;
+
+    assert(source_pending_ > 0);
+    if (--source_pending_ == 0) {
+      delete this;
+    }
   }
 
-  const Retriever::Callback& retrieved_;
-  const Source& source_;
-  ValidatingStorage* storage_;
+  const Retriever& retriever_;
+  const bool refresh_;
+  Waiter waiter_;  // The callback of Refresh(), if |refresh_| is true.
   const scoped_ptr<const Source::Callback> fresh_data_ready_;
   const scoped_ptr<const Storage::Callback> validated_data_ready_;
-  std::string stale_data_;
+  std::map<std::string, SharedString> stale_data_;
+  std::set<std::string> refreshing_;  // Keys of stale data already used.
+  std::vector<std::string> fetch_keys_;  // Keys to get from the source.
+  size_t storage_pending_;
+  size_t source_pending_;
 
   DISALLOW_COPY_AND_ASSIGN(Helper);
 };
 
-}  // namespace
-
 Retriever::Retriever(const Source* source, Storage* storage)
-    : source_(source), storage_(new ValidatingStorage(storage)) {
+    : source_(source),
+      storage_(new ValidatingStorage(storage)),
+      retrieved_(BuildCallback(this, &Retriever::OnRetrieved)),
+      stale_while_revalidate_(false),
+      mutex_(new Mutex),
+      in_flight_(),
+      refreshing_() {
   assert(source_ != NULL);
   assert(storage_ != NULL);
+  assert(retrieved_ != NULL);
 }
 
 Retriever::~Retriever() {}
 
 void Retriever::Retrieve(const std::string& key,
                          const Callback& retrieved) const {
-  new Helper(key, retrieved, *source_, storage_.get());
+  RetrieveMulti(std::vector<std::string>(1, key), retrieved);
+}
+
+void Retriever::RetrieveMulti(const std::vector<std::string>& keys,
+                              const Callback& retrieved) const {
+  Waiter waiter = { &retrieved, NULL };
+  RetrieveMulti(keys, waiter);
+}
+
+void Retriever::Retrieve(const std::string& key,
+                         const SharedCallback& retrieved) const {
+  RetrieveMulti(std::vector<std::string>(1, key), retrieved);
+}
+
+void Retriever::RetrieveMulti(const std::vector<std::string>& keys,
+                              const SharedCallback& retrieved) const {
+  Waiter waiter = { NULL, &retrieved };
+  RetrieveMulti(keys, waiter);
+}
+
+void Retriever::RetrieveMulti(const std::vector<std::string>& keys,
+                              const Waiter& waiter) const {
+  std::vector<std::string> new_keys;
+  {
+    MutexLock lock(mutex_.get());
+    for (std::vector<std::string>::const_iterator it = keys.begin();
+         it != keys.end(); ++it) {
+      std::vector<Waiter>& waiting = in_flight_[*it];
+      waiting.push_back(waiter);
+      if (waiting.size() == 1) {
+        new_keys.push_back(*it);
+      }  // Else the first caller has already started retrieving the data.
+    }
+  }
+  if (!new_keys.empty()) {
+    new Helper(new_keys, *this, NULL);
+  }
+}
+
+void Retriever::Refresh(const std::string& key,
+                        const Callback& retrieved) const {
+  Waiter waiter = { &retrieved, NULL };
+  new Helper(std::vector<std::string>(1, key), *this, &waiter);
+}
+
+void Retriever::set_options(const StorageOptions& options) {
+  storage_->set_max_age(options.max_age);
+  stale_while_revalidate_ = options.stale_while_revalidate;
+}
+
+void Retriever::OnRetrieved(bool success,
+                            const std::string& key,
+                            const SharedString& data) {
+  // The callbacks are invoked without holding the lock, so that they can call
+  // Retrieve() again, for this key or any other.
+  std::vector<Waiter> waiting;
+  {
+    MutexLock lock(mutex_.get());
+    std::map<std::string, std::vector<Waiter> >::iterator it =
+        in_flight_.find(key);
+    assert(it != in_flight_.end());
+    waiting.swap(it->second);
+    in_flight_.erase(it);
+  }
+  for (std::vector<Waiter>::const_iterator
+       it = waiting.begin(); it != waiting.end(); ++it) {
+    Invoke(*it, success, key, data);
+  }
+}
+
+// static
+void Retriever::Invoke(const Waiter& waiter,
+                       bool success,
+                       const std::string& key,
+                       const SharedString& data) {
+  if (waiter.retrieved != NULL) {
+    (*waiter.retrieved)(success, key, data.get());
+  } else {
+    (*waiter.shared_retrieved)(success, key, data);
+  }
+}
+
+bool Retriever::StartRefresh(const std::string& key) const {
+  MutexLock lock(mutex_.get());
+  return refreshing_.insert(key).second;
+}
+
+void Retriever::RefreshDone(const std::string& key) const {
+  MutexLock lock(mutex_.get());
+  size_t status = refreshing_.erase(key);
+  assert(status == 1);
+  (void)status;  // Prevent unused variable if assert() is optimized away.
 }
 
 }  // namespace addressinput
@@ -21,14 +21,20 @@
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 namespace i18n {
 namespace addressinput {
 
+class Mutex;
+class SharedString;
 class Source;
 class Storage;
 class ValidatingStorage;
+struct StorageOptions;
 
 // Retrieves data. Sample usage:
 //    Source* source = ...;
@@ -42,6 +48,11 @@ class Retriever {
   typedef i18n::addressinput::Callback<const std::string&,
                                        const std::string&> Callback;
 
+  // Same as Callback, but hands over the data as a SharedString, which the
+  // callee can keep instead of copying the data.
+  typedef i18n::addressinput::Callback<const std::string&,
+                                       const SharedString&> SharedCallback;
+
   // Takes ownership of |source| and |storage|.
   Retriever(const Source* source, Storage* storage);
   ~Retriever();
@@ -53,11 +64,84 @@ class Retriever {
   // the data is stale, then it's requested anew. If the request fails, then
   // stale data will be returned this one time. Any subsequent call to
   // Retrieve() will attempt to get fresh data again.
+  //
+  // If the data for |key| is already being retrieved, then |retrieved| is
+  // invoked with that data as well when it arrives, instead of retrieving it
+  // again. The callbacks are invoked in the order that Retrieve() was called.
+  //
+  // If |options| has stale_while_revalidate set, then stale data is instead
+  // returned right away, and |source_| is asked for fresh data to place in
+  // storage afterwards, at most once at a time for each key.
   void Retrieve(const std::string& key, const Callback& retrieved) const;
 
+  // Same as Retrieve(), for each of the |keys|, invoking |retrieved| once for
+  // each of them. The keys not already being retrieved are requested from
+  // storage all at once, and those not found there from the source all at
+  // once, so that a Source or Storage implementing GetMulti() can handle them
+  // with a single request.
+  void RetrieveMulti(const std::vector<std::string>& keys,
+                     const Callback& retrieved) const;
+
+  // Same as Retrieve() and RetrieveMulti(), but with a SharedCallback. The
+  // data is never copied on its way from storage to |retrieved|. Data that
+  // comes from the source is copied once when put in storage, if |retrieved|
+  // keeps a reference to it.
+  void Retrieve(const std::string& key,
+                const SharedCallback& retrieved) const;
+  void RetrieveMulti(const std::vector<std::string>& keys,
+                     const SharedCallback& retrieved) const;
+
+  // Same as Retrieve(), but gets the data for |key| from |source_| even if
+  // |storage_| has fresh data for it, which is then used only if the request
+  // fails, the same way as stale data is. The data is not shared with any
+  // concurrent call to Retrieve() for the same key, which could get it from
+  // storage.
+  void Refresh(const std::string& key, const Callback& retrieved) const;
+
+  // Sets how data in storage is used. Must not be called while retrieving.
+  void set_options(const StorageOptions& options);
+
  private:
+  class Helper;
+
+  // A callback of either type, waiting for data. Exactly one of the pointers is
+  // not NULL.
+  struct Waiter {
+    const Callback* retrieved;
+    const SharedCallback* shared_retrieved;
+  };
+
+  void RetrieveMulti(const std::vector<std::string>& keys,
+                     const Waiter& waiter) const;
+
+  // Invokes the callbacks of all calls to Retrieve() for |key| that are
+  // waiting for the data.
+  void OnRetrieved(bool success,
+                   const std::string& key,
+                   const SharedString& data);
+
+  static void Invoke(const Waiter& waiter,
+                     bool success,
+                     const std::string& key,
+                     const SharedString& data);
+
+  // Returns false if stale data for |key| is already being refreshed, or else
+  // marks it as being refreshed until RefreshDone() is called.
+  bool StartRefresh(const std::string& key) const;
+  void RefreshDone(const std::string& key) const;
+
   scoped_ptr<const Source> source_;
   scoped_ptr<ValidatingStorage> storage_;
+  const scoped_ptr<const SharedCallback> retrieved_;
+  bool stale_while_revalidate_;
+
+  // The callbacks waiting for each key that is being retrieved, guarded by
+  // |mutex_|.
+  const scoped_ptr<Mutex> mutex_;
+  mutable std::map<std::string, std::vector<Waiter> > in_flight_;
+
+  // The keys for which stale data is being refreshed, guarded by |mutex_|.
+  mutable std::set<std::string> refreshing_;
 
   DISALLOW_COPY_AND_ASSIGN(Retriever);
 };
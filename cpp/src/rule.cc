@@ -19,16 +19,16 @@
 #include <map>
 #include <string>
 #include <utility>
-
-#include <re2/re2.h>
+#include <vector>
 
 #include "address_field_util.h"
 #include "format_element.h"
 #include "grit.h"
 #include "messages.h"
+#include "postal_code_matcher.h"
 #include "region_data_constants.h"
 #include "util/json.h"
-#include "util/re2ptr.h"
+#include "util/snapshot_io.h"
 #include "util/string_split.h"
 
 namespace i18n {
@@ -105,6 +105,114 @@ bool ContainsRegExSpecialCharacters(const std::string& input) {
   return input.find_first_of("([\\{?") != std::string::npos;
 }
 
+void WriteField(AddressField field, SnapshotWriter* writer) {
+  writer->WriteUint32(static_cast<uint32>(field));
+}
+
+bool ReadField(SnapshotReader* reader, AddressField* field) {
+  uint32 value;
+  if (!reader->ReadUint32(&value) || value > RECIPIENT) {
+    return false;
+  }
+  *field = static_cast<AddressField>(value);
+  return true;
+}
+
+// A format element is written as its literal string, followed by the field if
+// the literal string is empty.
+void WriteFormat(const std::vector<FormatElement>& format,
+                 SnapshotWriter* writer) {
+  writer->WriteUint32(static_cast<uint32>(format.size()));
+  for (std::vector<FormatElement>::const_iterator
+       it = format.begin(); it != format.end(); ++it) {
+    writer->WriteString(it->GetLiteral());
+    if (it->IsField()) {
+      WriteField(it->GetField(), writer);
+    }
+  }
+}
+
+bool ReadFormat(SnapshotReader* reader, std::vector<FormatElement>* format) {
+  size_t size;
+  if (!reader->ReadCount(4, &size)) {
+    return false;
+  }
+  format->clear();
+  format->reserve(size);
+  std::string literal;
+  for (size_t i = 0; i < size; ++i) {
+    if (!reader->ReadString(&literal)) {
+      return false;
+    }
+    if (!literal.empty()) {
+      format->push_back(FormatElement(literal));
+    } else {
+      AddressField field;
+      if (!ReadField(reader, &field)) {
+        return false;
+      }
+      format->push_back(FormatElement(field));
+    }
+  }
+  return true;
+}
+
+void WriteStrings(const std::vector<std::string>& strings,
+                  SnapshotWriter* writer) {
+  writer->WriteUint32(static_cast<uint32>(strings.size()));
+  for (std::vector<std::string>::const_iterator
+       it = strings.begin(); it != strings.end(); ++it) {
+    writer->WriteString(*it);
+  }
+}
+
+bool ReadStrings(SnapshotReader* reader, std::vector<std::string>* strings) {
+  size_t size;
+  if (!reader->ReadCount(4, &size)) {
+    return false;
+  }
+  strings->resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    if (!reader->ReadString(&(*strings)[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t GetFormatMemoryUsage(const std::vector<FormatElement>& format) {
+  size_t bytes = format.capacity() * sizeof(FormatElement);
+  for (std::vector<FormatElement>::const_iterator
+       it = format.begin(); it != format.end(); ++it) {
+    bytes += it->GetLiteral().capacity();
+  }
+  return bytes;
+}
+
+size_t GetStringsMemoryUsage(const std::vector<std::string>& strings) {
+  size_t bytes = strings.capacity() * sizeof(std::string);
+  for (std::vector<std::string>::const_iterator
+       it = strings.begin(); it != strings.end(); ++it) {
+    bytes += it->capacity();
+  }
+  return bytes;
+}
+
+// Message IDs are written offset by one, so that INVALID_MESSAGE_ID (-1) can be
+// written as an unsigned value.
+void WriteMessageId(int message_id, SnapshotWriter* writer) {
+  writer->WriteUint32(static_cast<uint32>(message_id + 1));
+}
+
+bool ReadMessageId(SnapshotReader* reader, int* message_id) {
+  uint32 value;
+  if (!reader->ReadUint32(&value)) {
+    return false;
+  }
+  *message_id = static_cast<int>(value) - 1;
+  return true;
+}
+
 }  // namespace
 
 Rule::Rule()
@@ -148,8 +256,7 @@ void Rule::CopyFrom(const Rule& rule) {
   postal_code_matcher_.reset(
       rule.postal_code_matcher_ == NULL
           ? NULL
-          : new RE2ptr(new RE2(rule.postal_code_matcher_->ptr->pattern(),
-                               rule.postal_code_matcher_->ptr->options())));
+          : new PostalCodeMatcher(rule.postal_code_matcher_->pattern()));
   sole_postal_code_ = rule.sole_postal_code_;
   admin_area_name_message_id_ = rule.admin_area_name_message_id_;
   postal_code_name_message_id_ = rule.postal_code_name_message_id_;
@@ -159,6 +266,93 @@ void Rule::CopyFrom(const Rule& rule) {
   post_service_url_ = rule.post_service_url_;
 }
 
+void Rule::WriteSnapshot(SnapshotWriter* writer) const {
+  assert(writer != NULL);
+  writer->WriteString(id_);
+  WriteFormat(format_, writer);
+  WriteFormat(latin_format_, writer);
+  writer->WriteUint32(static_cast<uint32>(required_.size()));
+  for (std::vector<AddressField>::const_iterator
+       it = required_.begin(); it != required_.end(); ++it) {
+    WriteField(*it, writer);
+  }
+  WriteStrings(sub_keys_, writer);
+  WriteStrings(languages_, writer);
+  writer->WriteUint32(postal_code_matcher_ != NULL ? 1 : 0);
+  if (postal_code_matcher_ != NULL) {
+    writer->WriteString(postal_code_matcher_->pattern());
+  }
+  writer->WriteString(sole_postal_code_);
+  WriteMessageId(admin_area_name_message_id_, writer);
+  WriteMessageId(postal_code_name_message_id_, writer);
+  writer->WriteString(name_);
+  writer->WriteString(latin_name_);
+  writer->WriteString(postal_code_example_);
+  writer->WriteString(post_service_url_);
+}
+
+bool Rule::ParseSnapshot(SnapshotReader* reader) {
+  assert(reader != NULL);
+  if (!reader->ReadString(&id_) ||
+      !ReadFormat(reader, &format_) ||
+      !ReadFormat(reader, &latin_format_)) {
+    return false;
+  }
+
+  size_t size;
+  if (!reader->ReadCount(4, &size)) {
+    return false;
+  }
+  required_.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    if (!ReadField(reader, &required_[i])) {
+      return false;
+    }
+  }
+
+  uint32 has_matcher;
+  if (!ReadStrings(reader, &sub_keys_) ||
+      !ReadStrings(reader, &languages_) ||
+      !reader->ReadUint32(&has_matcher) || has_matcher > 1) {
+    return false;
+  }
+  postal_code_matcher_.reset(NULL);
+  if (has_matcher != 0) {
+    std::string pattern;
+    if (!reader->ReadString(&pattern)) {
+      return false;
+    }
+    // The pattern was checked with PostalCodeMatcher::ok() before it was
+    // written, so there's no need to compile it now.
+    postal_code_matcher_.reset(new PostalCodeMatcher(pattern));
+  }
+
+  return reader->ReadString(&sole_postal_code_) &&
+         ReadMessageId(reader, &admin_area_name_message_id_) &&
+         ReadMessageId(reader, &postal_code_name_message_id_) &&
+         reader->ReadString(&name_) &&
+         reader->ReadString(&latin_name_) &&
+         reader->ReadString(&postal_code_example_) &&
+         reader->ReadString(&post_service_url_);
+}
+
+size_t Rule::GetMemoryUsage() const {
+  return sizeof *this +
+         id_.capacity() +
+         GetFormatMemoryUsage(format_) +
+         GetFormatMemoryUsage(latin_format_) +
+         required_.capacity() * sizeof(AddressField) +
+         GetStringsMemoryUsage(sub_keys_) +
+         GetStringsMemoryUsage(languages_) +
+         (postal_code_matcher_ != NULL
+              ? postal_code_matcher_->GetMemoryUsage() : 0) +
+         sole_postal_code_.capacity() +
+         name_.capacity() +
+         latin_name_.capacity() +
+         postal_code_example_.capacity() +
+         post_service_url_.capacity();
+}
+
 bool Rule::ParseSerializedRule(const std::string& serialized_rule) {
   Json json;
   if (!json.ParseObject(serialized_rule)) {
@@ -202,16 +396,11 @@ void Rule::ParseJsonRule(const Json& json) {
     // the country. At other levels, the regular expression indicates the postal
     // code prefix expected for addresses in that region.
     //
-    // In order to make the RE2 object created from the "zip" field useable for
-    // both these purposes, the pattern string is here prefixed with "^" to
-    // anchor it at the beginning of the string so that it can be used with
-    // RE2::PartialMatch() to perform prefix matching or else with
-    // RE2::FullMatch() to perform matching against the entire string.
-    RE2::Options options;
-    options.set_never_capture(true);
-    RE2* matcher = new RE2("^(" + value + ")", options);
+    // The PostalCodeMatcher object created from the "zip" field is useable for
+    // both these purposes.
+    PostalCodeMatcher* matcher = new PostalCodeMatcher(value);
     if (matcher->ok()) {
-      postal_code_matcher_.reset(new RE2ptr(matcher));
+      postal_code_matcher_.reset(matcher);
     } else {
       postal_code_matcher_.reset(NULL);
       delete matcher;
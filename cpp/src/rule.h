@@ -24,6 +24,7 @@
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -32,7 +33,9 @@ namespace addressinput {
 
 class FormatElement;
 class Json;
-struct RE2ptr;
+class PostalCodeMatcher;
+class SnapshotReader;
+class SnapshotWriter;
 
 // Stores address metadata addressing rules, to be used for determining the
 // layout of an address input widget or for address validation. Sample usage:
@@ -60,6 +63,20 @@ class Rule {
   // Reads data from |json|, which must already have parsed a serialized rule.
   void ParseJsonRule(const Json& json);
 
+  // Writes all data of this rule to |writer|, in the format read by
+  // ParseSnapshot().
+  void WriteSnapshot(SnapshotWriter* writer) const;
+
+  // Reads the data of a rule written by WriteSnapshot() from |reader|. Returns
+  // false if the data isn't valid. This is much faster than parsing JSON, as
+  // the postal code pattern, known to be valid, is compiled into an RE2 object
+  // only when first needed.
+  bool ParseSnapshot(SnapshotReader* reader);
+
+  // Returns a rough estimate of the number of bytes of memory used by this
+  // object.
+  size_t GetMemoryUsage() const;
+
   // Returns the ID string for this rule.
   const std::string& GetId() const { return id_; }
 
@@ -88,12 +105,12 @@ class Rule {
   // "fr", "it"].
   const std::vector<std::string>& GetLanguages() const { return languages_; }
 
-  // Returns a pointer to a RE2 regular expression object created from the
-  // postal code format string, if specified, or NULL otherwise. The regular
-  // expression is anchored to the beginning of the string so that it can be
-  // used either with RE2::PartialMatch() to perform prefix matching or else
-  // with RE2::FullMatch() to perform matching against the entire string.
-  const RE2ptr* GetPostalCodeMatcher() const {
+  // Returns a pointer to a matcher created from the postal code format string,
+  // if specified, or NULL otherwise. The matcher can be used either with
+  // PostalCodeMatcher::PrefixMatch() to perform prefix matching or else with
+  // PostalCodeMatcher::FullMatch() to perform matching against the entire
+  // string.
+  const PostalCodeMatcher* GetPostalCodeMatcher() const {
     return postal_code_matcher_.get();
   }
 
@@ -133,7 +150,7 @@ class Rule {
   std::vector<AddressField> required_;
   std::vector<std::string> sub_keys_;
   std::vector<std::string> languages_;
-  scoped_ptr<const RE2ptr> postal_code_matcher_;
+  scoped_ptr<const PostalCodeMatcher> postal_code_matcher_;
   std::string sole_postal_code_;
   int admin_area_name_message_id_;
   int postal_code_name_message_id_;
@@ -0,0 +1,211 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/tiered_storage.h>
+
+#include <libaddressinput/callback.h>
+#include <libaddressinput/storage.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/mutex.h"
+
+namespace i18n {
+namespace addressinput {
+
+// Gets data from the wrapped storage, promoting what is found to memory.
+// Deletes itself when done.
+class TieredStorage::Helper {
+ public:
+  // Does not take ownership of its parameters.
+  Helper(const std::vector<std::string>& keys,
+         const Storage::Callback& data_ready,
+         const TieredStorage& storage)
+      : data_ready_(data_ready),
+        storage_(storage),
+        remaining_(keys.size()),
+        wrapped_data_ready_(BuildCallback(this, &Helper::OnWrappedDataReady)) {
+    assert(!keys.empty());
+    storage_.wrapped_storage_->GetMulti(keys, *wrapped_data_ready_);
+  }
+
+ private:
+  ~Helper() {}
+
+  void OnWrappedDataReady(bool success,
+                          const std::string& key,
+                          std::string* data) {
+    storage_.OnStorageResult(success, key, data);
+    data_ready_(success, key, data);
+    if (--remaining_ == 0) {
+      delete this;
+    }
+  }
+
+  const Storage::Callback& data_ready_;
+  const TieredStorage& storage_;
+  size_t remaining_;  // The number of keys not yet ready.
+  const scoped_ptr<const Storage::Callback> wrapped_data_ready_;
+
+  DISALLOW_COPY_AND_ASSIGN(Helper);
+};
+
+TieredStorage::TieredStorage(Storage* storage, size_t max_memory_bytes)
+    : wrapped_storage_(storage),
+      max_memory_bytes_(max_memory_bytes),
+      mutex_(new Mutex),
+      lru_(),
+      memory_(),
+      memory_bytes_(0),
+      memory_hits_(0),
+      storage_hits_(0),
+      misses_(0) {
+  assert(wrapped_storage_ != NULL);
+}
+
+TieredStorage::~TieredStorage() {}
+
+void TieredStorage::Put(const std::string& key, std::string* data) {
+  assert(data != NULL);
+  PutInMemory(key, *data, true);
+  wrapped_storage_->Put(key, data);
+}
+
+void TieredStorage::Get(const std::string& key,
+                        const Callback& data_ready) const {
+  std::string* data = GetFromMemory(key);
+  if (data != NULL) {
+    data_ready(true, key, data);
+  } else {
+    new Helper(std::vector<std::string>(1, key), data_ready, *this);
+  }
+}
+
+void TieredStorage::GetMulti(const std::vector<std::string>& keys,
+                             const Callback& data_ready) const {
+  std::vector<std::string> missing_keys;
+  for (std::vector<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    std::string* data = GetFromMemory(*it);
+    if (data != NULL) {
+      data_ready(true, *it, data);
+    } else {
+      missing_keys.push_back(*it);
+    }
+  }
+  if (!missing_keys.empty()) {
+    new Helper(missing_keys, data_ready, *this);
+  }
+}
+
+size_t TieredStorage::memory_size() const {
+  MutexLock lock(mutex_.get());
+  return memory_.size();
+}
+
+size_t TieredStorage::memory_bytes() const {
+  MutexLock lock(mutex_.get());
+  return memory_bytes_;
+}
+
+size_t TieredStorage::memory_hits() const {
+  MutexLock lock(mutex_.get());
+  return memory_hits_;
+}
+
+size_t TieredStorage::storage_hits() const {
+  MutexLock lock(mutex_.get());
+  return storage_hits_;
+}
+
+size_t TieredStorage::misses() const {
+  MutexLock lock(mutex_.get());
+  return misses_;
+}
+
+std::string* TieredStorage::GetFromMemory(const std::string& key) const {
+  MutexLock lock(mutex_.get());
+  std::map<std::string, Entry>::iterator it = memory_.find(key);
+  if (it == memory_.end()) {
+    return NULL;
+  }
+  ++memory_hits_;
+  lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+  return new std::string(it->second.data);
+}
+
+void TieredStorage::PutInMemory(const std::string& key,
+                                const std::string& data,
+                                bool replace) const {
+  // The key is stored twice, in |lru_| and |memory_|.
+  size_t bytes = data.size() + 2 * key.size();
+  MutexLock lock(mutex_.get());
+  std::map<std::string, Entry>::iterator it = memory_.find(key);
+  if (it != memory_.end()) {
+    if (!replace) {
+      return;
+    }
+    lru_.erase(it->second.lru_position);
+    memory_bytes_ -= it->second.bytes;
+    memory_.erase(it);
+  }
+  if (bytes > max_memory_bytes_) {
+    return;  // Would only push everything else out of memory.
+  }
+
+  lru_.push_front(key);
+  Entry& entry = memory_[key];
+  entry.data = data;
+  entry.bytes = bytes;
+  entry.lru_position = lru_.begin();
+  memory_bytes_ += bytes;
+
+  while (memory_bytes_ > max_memory_bytes_) {
+    assert(!lru_.empty());
+    std::map<std::string, Entry>::iterator lru_it = memory_.find(lru_.back());
+    assert(lru_it != memory_.end());
+    memory_bytes_ -= lru_it->second.bytes;
+    memory_.erase(lru_it);
+    lru_.pop_back();
+  }
+}
+
+void TieredStorage::OnStorageResult(bool success,
+                                    const std::string& key,
+                                    const std::string* data) const {
+  if (success) {
+    assert(data != NULL);
+    {
+      MutexLock lock(mutex_.get());
+      ++storage_hits_;
+    }
+    // Data put while this was being got from the wrapped storage is newer, so
+    // it's not replaced.
+    PutInMemory(key, *data, false);
+  } else {
+    MutexLock lock(mutex_.get());
+    ++misses_;
+  }
+}
+
+}  // namespace addressinput
+}  // namespace i18n
@@ -0,0 +1,113 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Minimal atomic operations, for publishing objects from one thread to others
+// without a lock, and for counters shared between threads.
+
+#ifndef I18N_ADDRESSINPUT_UTIL_ATOMIC_H_
+#define I18N_ADDRESSINPUT_UTIL_ATOMIC_H_
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace i18n {
+namespace addressinput {
+
+// Returns the value of |*ptr|. Everything written by the thread that stored
+// the value, before it called ReleaseStore(), is visible to the calling thread
+// after this returns. Sample usage:
+//    Data* data = new Data(...);          // Writer thread.
+//    ReleaseStore(&shared_, data);
+//
+//    const Data* data = AcquireLoad(&shared_);  // Reader thread.
+//    if (data != NULL) {
+//      ... All of *data is initialized ...
+//    }
+template <typename T>
+inline T AcquireLoad(const T* ptr) {
+#if defined(_MSC_VER)
+  // On the platforms supported by MSVC, a volatile read has acquire semantics.
+  T value = *static_cast<const volatile T*>(ptr);
+  _ReadWriteBarrier();
+  return value;
+#else
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// Sets |*ptr| to |value|, so that it can be read by AcquireLoad() on other
+// threads.
+template <typename T>
+inline void ReleaseStore(T* ptr, T value) {
+#if defined(_MSC_VER)
+  // On the platforms supported by MSVC, a volatile write has release semantics.
+  _ReadWriteBarrier();
+  *static_cast<volatile T*>(ptr) = value;
+#else
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Sets |*ptr| to |desired| if it's |expected|, and returns true, or else
+// returns false without changing |*ptr|. Sequentially consistent.
+template <typename T>
+inline bool CompareAndSwap(T** ptr, T* expected, T* desired) {
+#if defined(_MSC_VER)
+  return _InterlockedCompareExchangePointer(
+      reinterpret_cast<void* volatile*>(ptr),
+      const_cast<void*>(static_cast<const void*>(desired)),
+      const_cast<void*>(static_cast<const void*>(expected))) == expected;
+#else
+  return __atomic_compare_exchange_n(
+      ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// The following operations are all sequentially consistent, ie. they are seen
+// in the same order by all threads.
+
+// Returns the value of |*ptr|.
+inline int AtomicLoad(const int* ptr) {
+#if defined(_MSC_VER)
+  return _InterlockedCompareExchange(
+      reinterpret_cast<volatile long*>(const_cast<int*>(ptr)), 0, 0);
+#else
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Adds |delta| to |*ptr|, and returns the new value.
+inline int AtomicAdd(int* ptr, int delta) {
+#if defined(_MSC_VER)
+  return _InterlockedExchangeAdd(
+      reinterpret_cast<volatile long*>(ptr), delta) + delta;
+#else
+  return __atomic_add_fetch(ptr, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Sets |*ptr| to |value|, and returns the old value.
+inline int AtomicExchange(int* ptr, int value) {
+#if defined(_MSC_VER)
+  return _InterlockedExchange(reinterpret_cast<volatile long*>(ptr), value);
+#else
+  return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_UTIL_ATOMIC_H_
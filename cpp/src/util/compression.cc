@@ -0,0 +1,202 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// The compressed data is a series of sequences, each of which is:
+//
+//    <token> [<literal length>] <literals> [<offset> [<match length>]]
+//
+// The high 4 bits of the token is the number of literals, and the low 4 bits
+// is the length of the match minus 4. If either of these is 15, then it's
+// followed by bytes that are added to it, until a byte that isn't 255. The
+// literals are copied to the output, and then the match is copied from the
+// output |offset| bytes back, which is stored as 2 bytes, little-endian. The
+// last sequence has no match, and is the only sequence without one, so that
+// truncated data can be detected.
+
+#include "compression.h"
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+namespace {
+
+const size_t kMinMatch = 4;
+const size_t kMaxOffset = 65535;
+const int kHashBits = 12;
+const unsigned char kMaxNibble = 15;
+
+uint32 Read32(const unsigned char* p) {
+  uint32 value;
+  std::memcpy(&value, p, sizeof value);
+  return value;
+}
+
+uint32 Hash(uint32 value) {
+  return (value * 2654435761U) >> (32 - kHashBits);
+}
+
+// Appends |length| - 15 in the variable length format of lengths.
+void AppendLength(size_t length, std::string* output) {
+  assert(length >= kMaxNibble);
+  for (length -= kMaxNibble; length >= 255; length -= 255) {
+    output->push_back(static_cast<char>(255));
+  }
+  output->push_back(static_cast<char>(length));
+}
+
+void AppendSequence(const unsigned char* literals,
+                    size_t literal_length,
+                    size_t offset,
+                    size_t match_length,
+                    std::string* output) {
+  unsigned char literal_nibble = literal_length < kMaxNibble
+      ? static_cast<unsigned char>(literal_length) : kMaxNibble;
+  unsigned char match_nibble = 0;
+  if (offset > 0) {
+    assert(match_length >= kMinMatch);
+    match_length -= kMinMatch;
+    match_nibble = match_length < kMaxNibble
+        ? static_cast<unsigned char>(match_length) : kMaxNibble;
+  }
+  output->push_back(static_cast<char>(literal_nibble << 4 | match_nibble));
+  if (literal_nibble == kMaxNibble) {
+    AppendLength(literal_length, output);
+  }
+  output->append(reinterpret_cast<const char*>(literals), literal_length);
+  if (offset > 0) {
+    output->push_back(static_cast<char>(offset & 0xff));
+    output->push_back(static_cast<char>(offset >> 8));
+    if (match_nibble == kMaxNibble) {
+      AppendLength(match_length, output);
+    }
+  }
+}
+
+// Reads a length, of which |nibble| is the first part, and adds it to
+// |*length|. Returns false if the input ends first.
+bool ReadLength(unsigned char nibble,
+                const unsigned char** input,
+                const unsigned char* input_end,
+                size_t* length) {
+  *length += nibble;
+  if (nibble != kMaxNibble) {
+    return true;
+  }
+  unsigned char byte;
+  do {
+    if (*input == input_end) {
+      return false;
+    }
+    byte = *(*input)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+}  // namespace
+
+void CompressBlock(const char* data, size_t size, std::string* compressed) {
+  assert(data != NULL || size == 0);
+  assert(compressed != NULL);
+  const unsigned char* input = reinterpret_cast<const unsigned char*>(data);
+  compressed->reserve(compressed->size() + size / 2 + 16);
+
+  // The position + 1 of the last occurrence of each hashed 4 bytes.
+  std::vector<size_t> table(1 << kHashBits, 0);
+
+  size_t anchor = 0;  // The start of the literals not yet written.
+  size_t pos = 0;
+  while (pos + kMinMatch <= size) {
+    uint32 value = Read32(input + pos);
+    size_t& entry = table[Hash(value)];
+    size_t candidate = entry;
+    entry = pos + 1;
+    if (candidate == 0 || pos - (candidate - 1) > kMaxOffset ||
+        Read32(input + candidate - 1) != value) {
+      ++pos;
+      continue;
+    }
+    --candidate;
+    size_t length = kMinMatch;
+    while (pos + length < size && input[candidate + length] ==
+                                  input[pos + length]) {
+      ++length;
+    }
+    AppendSequence(input + anchor, pos - anchor, pos - candidate, length,
+                   compressed);
+    pos += length;
+    anchor = pos;
+  }
+  AppendSequence(input + anchor, size - anchor, 0, 0, compressed);
+}
+
+bool DecompressBlock(const char* compressed,
+                     size_t size,
+                     char* output,
+                     size_t output_size) {
+  assert(compressed != NULL || size == 0);
+  assert(output != NULL || output_size == 0);
+  const unsigned char* input = reinterpret_cast<const unsigned char*>(
+      compressed);
+  const unsigned char* input_end = input + size;
+  size_t out = 0;
+
+  for (;;) {
+    if (input == input_end) {
+      return false;  // The last sequence is missing.
+    }
+    unsigned char token = *input++;
+
+    size_t literal_length = 0;
+    if (!ReadLength(token >> 4, &input, input_end, &literal_length) ||
+        literal_length > static_cast<size_t>(input_end - input) ||
+        literal_length > output_size - out) {
+      return false;
+    }
+    std::memcpy(output + out, input, literal_length);
+    input += literal_length;
+    out += literal_length;
+
+    if (input == input_end) {
+      return out == output_size;  // The last sequence, which has no match.
+    }
+
+    if (input_end - input < 2) {
+      return false;
+    }
+    size_t offset = input[0] | static_cast<size_t>(input[1]) << 8;
+    input += 2;
+    size_t match_length = kMinMatch;
+    if (offset == 0 || offset > out ||
+        !ReadLength(token & kMaxNibble, &input, input_end, &match_length) ||
+        match_length > output_size - out) {
+      return false;
+    }
+    // The match can overlap the output being written, so copy byte by byte.
+    for (size_t i = 0; i < match_length; ++i, ++out) {
+      output[out] = output[out - offset];
+    }
+  }
+}
+
+}  // namespace addressinput
+}  // namespace i18n
@@ -0,0 +1,52 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A fast block compressor, in a format like the LZ4 block format, for data
+// that is compressed once and decompressed many times.
+
+#ifndef I18N_ADDRESSINPUT_UTIL_COMPRESSION_H_
+#define I18N_ADDRESSINPUT_UTIL_COMPRESSION_H_
+
+#include <cstddef>
+#include <string>
+
+namespace i18n {
+namespace addressinput {
+
+// Appends the compressed |size| bytes at |data| to |compressed|. The size of
+// the uncompressed data isn't stored, so it must be kept by the caller. Sample
+// usage:
+//    std::string compressed;
+//    CompressBlock(data.data(), data.size(), &compressed);
+//
+//    std::string decompressed(data.size(), '\0');
+//    if (DecompressBlock(compressed.data(), compressed.size(),
+//                        &decompressed[0], decompressed.size())) {
+//      ...
+//    }
+void CompressBlock(const char* data, size_t size, std::string* compressed);
+
+// Decompresses the |size| bytes at |compressed| into the |output_size| bytes
+// at |output|. Returns false if the compressed data is invalid, or if it
+// doesn't decompress to exactly |output_size| bytes. Never reads or writes
+// outside the buffers given, whatever the compressed data.
+bool DecompressBlock(const char* compressed,
+                     size_t size,
+                     char* output,
+                     size_t output_size);
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_UTIL_COMPRESSION_H_
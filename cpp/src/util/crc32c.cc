@@ -0,0 +1,89 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "crc32c.h"
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cassert>
+#include <cstddef>
+
+namespace i18n {
+namespace addressinput {
+
+namespace {
+
+// The CRC-32C polynomial, in reversed bit order.
+const uint32 kPolynomial = 0x82f63b78;
+
+// The tables for processing 8 bytes at a time: table_[0] is the ordinary byte
+// wise CRC table, and table_[k][i] is the CRC of byte i followed by k zero
+// bytes. Built during static initialization, so that no locking is needed.
+class Crc32cTables {
+ public:
+  Crc32cTables() {
+    for (uint32 i = 0; i < 256; ++i) {
+      uint32 crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ ((crc & 1) != 0 ? kPolynomial : 0);
+      }
+      table_[0][i] = crc;
+    }
+    for (uint32 i = 0; i < 256; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        uint32 crc = table_[k - 1][i];
+        table_[k][i] = (crc >> 8) ^ table_[0][crc & 0xff];
+      }
+    }
+  }
+
+  uint32 Compute(const unsigned char* data, size_t size) const {
+    uint32 crc = 0xffffffff;
+    for (; size >= 8; size -= 8, data += 8) {
+      uint32 low = crc ^ (static_cast<uint32>(data[0]) |
+                          static_cast<uint32>(data[1]) << 8 |
+                          static_cast<uint32>(data[2]) << 16 |
+                          static_cast<uint32>(data[3]) << 24);
+      crc = table_[7][low & 0xff] ^
+            table_[6][(low >> 8) & 0xff] ^
+            table_[5][(low >> 16) & 0xff] ^
+            table_[4][low >> 24] ^
+            table_[3][data[4]] ^
+            table_[2][data[5]] ^
+            table_[1][data[6]] ^
+            table_[0][data[7]];
+    }
+    for (; size > 0; --size, ++data) {
+      crc = (crc >> 8) ^ table_[0][(crc ^ *data) & 0xff];
+    }
+    return ~crc;
+  }
+
+ private:
+  uint32 table_[8][256];
+
+  DISALLOW_COPY_AND_ASSIGN(Crc32cTables);
+};
+
+const Crc32cTables kTables;
+
+}  // namespace
+
+uint32 Crc32c(const char* data, size_t size) {
+  assert(data != NULL || size == 0);
+  return kTables.Compute(reinterpret_cast<const unsigned char*>(data), size);
+}
+
+}  // namespace addressinput
+}  // namespace i18n
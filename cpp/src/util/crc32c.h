@@ -0,0 +1,35 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// CRC-32C (Castagnoli) checksum, as used by iSCSI, SCTP and ext4.
+
+#ifndef I18N_ADDRESSINPUT_UTIL_CRC32C_H_
+#define I18N_ADDRESSINPUT_UTIL_CRC32C_H_
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cstddef>
+
+namespace i18n {
+namespace addressinput {
+
+// Returns the CRC-32C of the |size| bytes at |data|. This is a portable table
+// driven implementation, which processes 8 bytes at a time ("slicing-by-8"),
+// and is many times faster than computing an MD5 digest of the same data.
+uint32 Crc32c(const char* data, size_t size);
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_UTIL_CRC32C_H_
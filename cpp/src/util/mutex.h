@@ -0,0 +1,140 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Minimal wrappers around the mutexes and condition variables of POSIX threads,
+// or of Windows.
+
+#ifndef I18N_ADDRESSINPUT_UTIL_MUTEX_H_
+#define I18N_ADDRESSINPUT_UTIL_MUTEX_H_
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cassert>
+
+#if defined(_WIN32)
+// Keeps <windows.h> from defining min() and max() macros, which would break
+// std::min() and std::max() in the files that include this one.
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace i18n {
+namespace addressinput {
+
+class Mutex {
+ public:
+#if defined(_WIN32)
+  Mutex() { InitializeSRWLock(&mutex_); }
+  ~Mutex() {}
+
+  void Lock() { AcquireSRWLockExclusive(&mutex_); }
+  void Unlock() { ReleaseSRWLockExclusive(&mutex_); }
+#else
+  Mutex() {
+    int status = pthread_mutex_init(&mutex_, NULL);
+    assert(status == 0);
+    (void)status;  // Prevent unused variable if assert() is optimized away.
+  }
+
+  ~Mutex() { pthread_mutex_destroy(&mutex_); }
+
+  void Lock() { pthread_mutex_lock(&mutex_); }
+  void Unlock() { pthread_mutex_unlock(&mutex_); }
+#endif
+
+ private:
+  friend class ConditionVariable;
+
+#if defined(_WIN32)
+  SRWLOCK mutex_;
+#else
+  pthread_mutex_t mutex_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(Mutex);
+};
+
+// Locks a Mutex for the lifetime of the MutexLock object. Sample usage:
+//    void MyClass::Increment() {
+//      MutexLock lock(&mutex_);
+//      ++counter_;
+//    }
+class MutexLock {
+ public:
+  explicit MutexLock(Mutex* mutex) : mutex_(mutex) {
+    assert(mutex_ != NULL);
+    mutex_->Lock();
+  }
+
+  ~MutexLock() { mutex_->Unlock(); }
+
+ private:
+  Mutex* const mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(MutexLock);
+};
+
+class ConditionVariable {
+ public:
+#if defined(_WIN32)
+  ConditionVariable() { InitializeConditionVariable(&cond_); }
+  ~ConditionVariable() {}
+#else
+  ConditionVariable() {
+    int status = pthread_cond_init(&cond_, NULL);
+    assert(status == 0);
+    (void)status;  // Prevent unused variable if assert() is optimized away.
+  }
+
+  ~ConditionVariable() { pthread_cond_destroy(&cond_); }
+#endif
+
+  // Atomically unlocks |mutex|, which must be locked by the calling thread,
+  // and waits to be woken up by Signal() or Broadcast(). Spurious wakeups are
+  // possible, so the caller must always check the condition waited for.
+  void Wait(Mutex* mutex) {
+    assert(mutex != NULL);
+#if defined(_WIN32)
+    SleepConditionVariableSRW(&cond_, &mutex->mutex_, INFINITE, 0);
+#else
+    pthread_cond_wait(&cond_, &mutex->mutex_);
+#endif
+  }
+
+#if defined(_WIN32)
+  void Signal() { WakeConditionVariable(&cond_); }
+  void Broadcast() { WakeAllConditionVariable(&cond_); }
+#else
+  void Signal() { pthread_cond_signal(&cond_); }
+  void Broadcast() { pthread_cond_broadcast(&cond_); }
+#endif
+
+ private:
+#if defined(_WIN32)
+  CONDITION_VARIABLE cond_;
+#else
+  pthread_cond_t cond_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(ConditionVariable);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_UTIL_MUTEX_H_
@@ -0,0 +1,117 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "read_copy_update.h"
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "atomic.h"
+#include "mutex.h"
+
+namespace i18n {
+namespace addressinput {
+
+ReadCopyUpdate::ReadCopyUpdate()
+    : phase_(0), pending_(0), mutex_(), waiting_(), next_() {
+  readers_[0] = 0;
+  readers_[1] = 0;
+}
+
+ReadCopyUpdate::~ReadCopyUpdate() {
+  assert(AtomicLoad(&readers_[0]) == 0);
+  assert(AtomicLoad(&readers_[1]) == 0);
+  waiting_.insert(waiting_.end(), next_.begin(), next_.end());
+  for (std::vector<Retired>::const_iterator
+       it = waiting_.begin(); it != waiting_.end(); ++it) {
+    it->deleter(it->object);
+  }
+}
+
+int ReadCopyUpdate::ReadLock() const {
+  for (;;) {
+    int phase = AtomicLoad(&phase_);
+    AtomicAdd(&readers_[phase], 1);
+    // If the phase was switched before the reader was counted, then the
+    // objects retired might not wait for this reader, so count it again in
+    // the counter of the new phase.
+    if (AtomicLoad(&phase_) == phase) {
+      return phase;
+    }
+    ReadUnlock(phase);
+  }
+}
+
+void ReadCopyUpdate::ReadUnlock(int token) const {
+  assert(token == 0 || token == 1);
+  int readers = AtomicAdd(&readers_[token], -1);
+  assert(readers >= 0);
+  // The phase is switched only after |pending_| has been set, so if this was
+  // the last reader of the old phase, then either Reclaim() has seen it leave
+  // or this sees |pending_| set.
+  if (readers == 0 && AtomicLoad(&pending_) != 0) {
+    Reclaim();
+  }
+}
+
+void ReadCopyUpdate::RetireObject(Deleter deleter, const void* object) {
+  assert(deleter != NULL);
+  assert(object != NULL);
+  {
+    MutexLock lock(&mutex_);
+    Retired retired = { deleter, object };
+    next_.push_back(retired);
+  }
+  Reclaim();
+}
+
+void ReadCopyUpdate::Reclaim() const {
+  std::vector<Retired> deletable;
+  {
+    MutexLock lock(&mutex_);
+    for (;;) {
+      if (!waiting_.empty()) {
+        int old_phase = 1 - AtomicLoad(&phase_);
+        if (AtomicLoad(&readers_[old_phase]) != 0) {
+          break;
+        }
+        deletable.insert(deletable.end(), waiting_.begin(), waiting_.end());
+        waiting_.clear();
+      }
+      if (next_.empty()) {
+        break;
+      }
+      // Any reader that can still see an object retired since the phase was
+      // last switched is counted in the current phase. New readers are counted
+      // in the other one.
+      waiting_.swap(next_);
+      AtomicExchange(&pending_, 1);
+      AtomicExchange(&phase_, 1 - AtomicLoad(&phase_));
+    }
+    if (waiting_.empty() && next_.empty()) {
+      AtomicExchange(&pending_, 0);
+    }
+  }
+
+  // The objects are deleted without holding the lock, as that can take a
+  // while.
+  for (std::vector<Retired>::const_iterator
+       it = deletable.begin(); it != deletable.end(); ++it) {
+    it->deleter(it->object);
+  }
+}
+
+}  // namespace addressinput
+}  // namespace i18n
@@ -0,0 +1,112 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Deferred deletion of objects that readers may still be using, in the style
+// of read-copy-update (RCU).
+
+#ifndef I18N_ADDRESSINPUT_UTIL_READ_COPY_UPDATE_H_
+#define I18N_ADDRESSINPUT_UTIL_READ_COPY_UPDATE_H_
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <vector>
+
+#include "mutex.h"
+
+namespace i18n {
+namespace addressinput {
+
+// Deletes an object that has been replaced once no reader can be using it
+// anymore. Sample usage:
+//    int token = rcu.ReadLock();            // Reader thread.
+//    const Data* data = AcquireLoad(&shared_);
+//    ... Use data ...
+//    rcu.ReadUnlock(token);
+//
+//    const Data* old = AcquireLoad(&shared_);  // Writer thread.
+//    ReleaseStore(&shared_, new_data);
+//    rcu.Retire(old);
+//
+// Neither readers nor writers ever wait for each other. Each reader is counted
+// in one of two counters, selected by the current phase. Retired objects are
+// deleted once the phase has been switched, so that all new readers are
+// counted in the other counter, and the counter of the old phase has dropped
+// to zero. That is done by whichever thread finds it so, which can be the
+// reader that leaves the last read-side critical section of the old phase.
+class ReadCopyUpdate {
+ public:
+  ReadCopyUpdate();
+
+  // Deletes the objects that are still retired. No read-side critical section
+  // may remain.
+  ~ReadCopyUpdate();
+
+  // Enters a read-side critical section, and returns a token to pass to
+  // ReadUnlock() when leaving it. Read-side critical sections can be nested,
+  // and can be left on another thread than the one that entered them.
+  int ReadLock() const;
+
+  // Leaves a read-side critical section, and deletes the retired objects that
+  // no reader can be using anymore, if any.
+  void ReadUnlock(int token) const;
+
+  // Deletes |object| once all read-side critical sections entered before this
+  // call have been left, which can be right away. Never blocks, so it can be
+  // called from inside a read-side critical section too.
+  template <typename T>
+  void Retire(const T* object) {
+    RetireObject(&Delete<T>, object);
+  }
+
+ private:
+  typedef void (*Deleter)(const void* object);
+
+  struct Retired {
+    Deleter deleter;
+    const void* object;
+  };
+
+  template <typename T>
+  static void Delete(const void* object) {
+    delete static_cast<const T*>(object);
+  }
+
+  void RetireObject(Deleter deleter, const void* object);
+
+  // Deletes the retired objects that no reader can be using anymore, and
+  // switches the phase for those retired since the phase was last switched.
+  void Reclaim() const;
+
+  mutable int phase_;
+  mutable int readers_[2];
+
+  // Not zero while there are retired objects that haven't been deleted, so
+  // that ReadUnlock() needn't lock |mutex_| otherwise.
+  mutable int pending_;
+
+  // Guards |waiting_| and |next_|, and serializes switching the phase.
+  mutable Mutex mutex_;
+
+  // The objects retired before the phase was last switched, waiting for the
+  // readers of the old phase, and those retired since then.
+  mutable std::vector<Retired> waiting_;
+  mutable std::vector<Retired> next_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadCopyUpdate);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_UTIL_READ_COPY_UPDATE_H_
@@ -0,0 +1,97 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shared_string.h"
+
+#include <cassert>
+#include <cstddef>
+#include <string>
+
+#include "atomic.h"
+
+namespace i18n {
+namespace addressinput {
+
+struct SharedString::Rep {
+  explicit Rep(std::string* data) : ref_count(1), data(data) {
+    assert(data != NULL);
+  }
+
+  ~Rep() { delete data; }
+
+  int ref_count;
+  std::string* data;  // Owned.
+};
+
+SharedString::SharedString() : rep_(NULL) {}
+
+SharedString::SharedString(std::string* data)
+    : rep_(data != NULL ? new Rep(data) : NULL) {}
+
+SharedString::SharedString(const SharedString& other) : rep_(other.rep_) {
+  if (rep_ != NULL) {
+    AtomicAdd(&rep_->ref_count, 1);
+  }
+}
+
+SharedString& SharedString::operator=(const SharedString& other) {
+  // Taking the new reference before dropping the old one makes self-assignment
+  // safe.
+  if (other.rep_ != NULL) {
+    AtomicAdd(&other.rep_->ref_count, 1);
+  }
+  Unref();
+  rep_ = other.rep_;
+  return *this;
+}
+
+SharedString::~SharedString() {
+  Unref();
+}
+
+const std::string& SharedString::get() const {
+  static const std::string kEmptyString;
+  return rep_ != NULL ? *rep_->data : kEmptyString;
+}
+
+bool SharedString::unique() const {
+  // No other thread can add a reference without holding one already, so if
+  // this is the only one, then that can't change while this is called.
+  return rep_ != NULL && AtomicLoad(&rep_->ref_count) == 1;
+}
+
+std::string* SharedString::Release() {
+  std::string* data;
+  if (rep_ == NULL) {
+    data = new std::string;
+  } else if (unique()) {
+    data = rep_->data;
+    rep_->data = NULL;
+    delete rep_;
+  } else {
+    data = new std::string(*rep_->data);
+    Unref();
+  }
+  rep_ = NULL;
+  return data;
+}
+
+void SharedString::Unref() {
+  if (rep_ != NULL && AtomicAdd(&rep_->ref_count, -1) == 0) {
+    delete rep_;
+  }
+}
+
+}  // namespace addressinput
+}  // namespace i18n
@@ -0,0 +1,68 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// An immutable string that is shared by reference counting instead of being
+// copied.
+
+#ifndef I18N_ADDRESSINPUT_UTIL_SHARED_STRING_H_
+#define I18N_ADDRESSINPUT_UTIL_SHARED_STRING_H_
+
+#include <string>
+
+namespace i18n {
+namespace addressinput {
+
+// Holds a reference to a string that can't be modified while it's shared.
+// Copying a SharedString only copies the reference, also from one thread to
+// another, and the string is deleted when the last reference to it is gone.
+// Sample usage:
+//    std::string* data = ...;
+//    SharedString shared(data);  // Takes ownership of |data|.
+//    SharedString other = shared;
+//    assert(&other.get() == &shared.get());
+class SharedString {
+ public:
+  // Creates an empty string.
+  SharedString();
+
+  // Takes ownership of |data|, which can be NULL for an empty string.
+  explicit SharedString(std::string* data);
+
+  SharedString(const SharedString& other);
+  SharedString& operator=(const SharedString& other);
+  ~SharedString();
+
+  const std::string& get() const;
+
+  // Returns true if this object holds the only reference to the string.
+  bool unique() const;
+
+  // Returns the string, leaving this object empty. The caller owns the result,
+  // which is the shared string itself if this object held the only reference
+  // to it, or else a copy of it.
+  std::string* Release();
+
+ private:
+  struct Rep;
+
+  // Drops the reference to |rep_|, deleting it if it was the last one.
+  void Unref();
+
+  Rep* rep_;  // NULL for an empty string.
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_UTIL_SHARED_STRING_H_
@@ -0,0 +1,99 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "snapshot_io.h"
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cassert>
+#include <cstddef>
+#include <string>
+
+namespace i18n {
+namespace addressinput {
+
+SnapshotWriter::SnapshotWriter(std::string* snapshot) : snapshot_(snapshot) {
+  assert(snapshot_ != NULL);
+}
+
+SnapshotWriter::~SnapshotWriter() {}
+
+void SnapshotWriter::WriteUint32(uint32 value) {
+  for (int i = 0; i < 4; ++i) {
+    snapshot_->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+void SnapshotWriter::WriteString(const std::string& value) {
+  WriteUint32(static_cast<uint32>(value.size()));
+  snapshot_->append(value);
+}
+
+SnapshotReader::SnapshotReader(const char* data, size_t size)
+    : data_(data),
+      size_(size),
+      pos_(0) {
+  assert(data_ != NULL || size_ == 0);
+}
+
+SnapshotReader::~SnapshotReader() {}
+
+bool SnapshotReader::ReadUint32(uint32* value) {
+  assert(value != NULL);
+  if (!CanRead(4)) {
+    return false;
+  }
+  *value = 0;
+  for (int i = 0; i < 4; ++i) {
+    *value |= static_cast<uint32>(
+        static_cast<unsigned char>(data_[pos_ + i])) << (8 * i);
+  }
+  pos_ += 4;
+  return true;
+}
+
+bool SnapshotReader::ReadString(std::string* value) {
+  assert(value != NULL);
+  uint32 length;
+  if (!ReadUint32(&length) || !CanRead(length)) {
+    return false;
+  }
+  value->assign(data_ + pos_, length);
+  pos_ += length;
+  return true;
+}
+
+bool SnapshotReader::ReadCount(size_t min_item_size, size_t* count) {
+  assert(min_item_size > 0);
+  assert(count != NULL);
+  uint32 value;
+  if (!ReadUint32(&value) || value > (size_ - pos_) / min_item_size) {
+    pos_ = size_ + 1;
+    return false;
+  }
+  *count = value;
+  return true;
+}
+
+bool SnapshotReader::CanRead(size_t size) {
+  // A failed reader has |pos_| past the end of the buffer.
+  if (pos_ > size_ || size > size_ - pos_) {
+    pos_ = size_ + 1;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace addressinput
+}  // namespace i18n
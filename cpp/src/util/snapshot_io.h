@@ -0,0 +1,95 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Writing and reading of the primitive values of a binary snapshot, in a
+// format that is the same on all platforms.
+
+#ifndef I18N_ADDRESSINPUT_UTIL_SNAPSHOT_IO_H_
+#define I18N_ADDRESSINPUT_UTIL_SNAPSHOT_IO_H_
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cstddef>
+#include <string>
+
+namespace i18n {
+namespace addressinput {
+
+// Appends values to a binary snapshot. Integers are written as 4 bytes, least
+// significant byte first, and strings as their length followed by their bytes.
+// Sample usage:
+//    std::string snapshot;
+//    SnapshotWriter writer(&snapshot);
+//    writer.WriteUint32(42);
+//    writer.WriteString("US");
+class SnapshotWriter {
+ public:
+  // Does not take ownership of |snapshot|, to which the values are appended.
+  explicit SnapshotWriter(std::string* snapshot);
+  ~SnapshotWriter();
+
+  void WriteUint32(uint32 value);
+  void WriteString(const std::string& value);
+
+ private:
+  std::string* const snapshot_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotWriter);
+};
+
+// Reads the values written by SnapshotWriter, in the same order, directly from
+// a buffer, which can for example be a memory mapped file. Sample usage:
+//    SnapshotReader reader(data, size);
+//    uint32 number;
+//    std::string region_code;
+//    if (!reader.ReadUint32(&number) || !reader.ReadString(&region_code)) {
+//      ... The snapshot is truncated ...
+//    }
+//
+// Each method returns false, leaving its output parameter unspecified, if the
+// buffer doesn't contain a value of the expected kind at the current position.
+// Once a method has returned false, all following calls return false too.
+class SnapshotReader {
+ public:
+  // Does not take ownership of |data|, which must remain valid for the
+  // lifetime of this object.
+  SnapshotReader(const char* data, size_t size);
+  ~SnapshotReader();
+
+  bool ReadUint32(uint32* value);
+  bool ReadString(std::string* value);
+
+  // Reads a count of items that each take at least |min_item_size| bytes, so
+  // that a corrupt count can be detected before allocating memory for it.
+  bool ReadCount(size_t min_item_size, size_t* count);
+
+  // Returns true if all of the buffer has been read.
+  bool AtEnd() const { return pos_ == size_; }
+
+ private:
+  // Returns true if |size| more bytes can be read, or else marks this object
+  // as failed.
+  bool CanRead(size_t size);
+
+  const char* const data_;
+  const size_t size_;
+  size_t pos_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotReader);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_UTIL_SNAPSHOT_IO_H_
@@ -17,11 +17,16 @@
 #include <libaddressinput/util/basictypes.h>
 
 #include <cassert>
+#include <cstddef>
+#include <list>
+#include <map>
 #include <string>
+#include <utility>
 
 #include <re2/re2.h>
 
 #include "lru_cache_using_std.h"
+#include "mutex.h"
 
 // RE2 uses type string, which is not necessarily the same as type std::string.
 // In order to create objects of the correct type, to be able to pass pointers
@@ -33,8 +38,24 @@ namespace {
 // In order to (mis-)use RE2 to implement UTF-8 capable less<>, this function
 // calls RE2::PossibleMatchRange() to calculate the "lessest" string that would
 // be a case-insensitive match to the string. This is far too expensive to do
-// repeatedly, so the function is only ever called through an LRU cache.
+// repeatedly, so the function is only ever called through an LRU cache, either
+// the one of a StringCompare object or the one shared by all threads, except
+// for ASCII strings, for which the result is simply the string in upper case.
 std::string ComputeMinPossibleMatch(const std::string& str) {
+  std::string upper(str);
+  bool ascii = true;
+  for (std::string::iterator it = upper.begin(); ascii && it != upper.end();
+       ++it) {
+    if ((*it & 0x80) != 0) {
+      ascii = false;
+    } else if ('a' <= *it && *it <= 'z') {
+      *it -= 'a' - 'A';
+    }
+  }
+  if (ascii) {
+    return upper;
+  }
+
   string min, max;  // N.B.: RE2 type string!
 
   RE2::Options options;
@@ -55,6 +76,64 @@ std::string ComputeMinPossibleMatch(const std::string& str) {
 namespace i18n {
 namespace addressinput {
 
+namespace {
+
+bool IsAscii(const std::string& str) {
+  for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+    if ((*it & 0x80) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// An LRU cache of re2::ComputeMinPossibleMatch() that can be used by several
+// threads at the same time. The values are computed without holding the lock,
+// so that threads computing different values don't wait for each other.
+class SortKeyCache {
+  enum { MAX_CACHE_SIZE = 1 << 15 };
+
+ public:
+  SortKeyCache() : mutex_(), lru_(), keys_() {}
+  ~SortKeyCache() {}
+
+  std::string Get(const std::string& str) {
+    {
+      MutexLock lock(&mutex_);
+      std::map<std::string, Entry>::iterator it = keys_.find(str);
+      if (it != keys_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second.second);
+        return it->second.first;
+      }
+    }
+
+    const std::string& key = re2::ComputeMinPossibleMatch(str);
+
+    MutexLock lock(&mutex_);
+    if (keys_.find(str) == keys_.end()) {  // Else another thread added it.
+      if (keys_.size() == MAX_CACHE_SIZE) {
+        keys_.erase(lru_.back());
+        lru_.pop_back();
+      }
+      keys_.insert(
+          std::make_pair(str, Entry(key, lru_.insert(lru_.begin(), str))));
+    }
+    return key;
+  }
+
+ private:
+  // The sort key, and the position of the string in |lru_|.
+  typedef std::pair<std::string, std::list<std::string>::iterator> Entry;
+
+  Mutex mutex_;  // Guards |lru_| and |keys_|.
+  std::list<std::string> lru_;  // The most recently used first.
+  std::map<std::string, Entry> keys_;
+
+  DISALLOW_COPY_AND_ASSIGN(SortKeyCache);
+};
+
+}  // namespace
+
 class StringCompare::Impl {
   enum { MAX_CACHE_SIZE = 1 << 15 };
 
@@ -77,6 +156,14 @@ class StringCompare::Impl {
     return min_a < min_b;
   }
 
+  static std::string NaturalSortKey(const std::string& str) {
+    if (IsAscii(str)) {
+      return re2::ComputeMinPossibleMatch(str);
+    }
+    static SortKeyCache kCache;
+    return kCache.Get(str);
+  }
+
  private:
   RE2::Options options_;
   mutable lru_cache_using_std<std::string, std::string> min_possible_match_;
@@ -98,5 +185,10 @@ bool StringCompare::NaturalLess(const std::string& a,
   return impl_->NaturalLess(a, b);
 }
 
+// static
+std::string StringCompare::NaturalSortKey(const std::string& str) {
+  return Impl::NaturalSortKey(str);
+}
+
 }  // namespace addressinput
 }  // namespace i18n
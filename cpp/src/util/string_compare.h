@@ -39,6 +39,13 @@ class StringCompare {
   // default implementation is VERY SLOW! Must be replaced if you need speed.
   bool NaturalLess(const std::string& a, const std::string& b) const;
 
+  // Returns a key for |str|, such that NaturalLess(a, b) gives the same result
+  // as comparing NaturalSortKey(a) < NaturalSortKey(b). Unlike the other
+  // methods, it's safe to call from several threads at the same time. It's
+  // fast for ASCII strings. Other strings are slow to compute a key for the
+  // first time, so their keys are kept in an LRU cache shared by all threads.
+  static std::string NaturalSortKey(const std::string& str);
+
  private:
   class Impl;
   scoped_ptr<Impl> impl_;
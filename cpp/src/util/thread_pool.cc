@@ -0,0 +1,238 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread_pool.h"
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "mutex.h"
+
+namespace i18n {
+namespace addressinput {
+
+struct ThreadPool::Worker {
+  Worker(ThreadPool* init_pool, size_t init_index)
+      : pool(init_pool),
+        index(init_index),
+        thread(),
+        mutex(),
+        begin(0),
+        end(0) {}
+
+#if defined(_WIN32)
+  // Calls ThreadMain() with the calling convention of _beginthreadex().
+  static unsigned __stdcall Run(void* arg) {
+    ThreadPool::ThreadMain(arg);
+    return 0;
+  }
+#endif
+
+  ThreadPool* const pool;
+  const size_t index;
+#if defined(_WIN32)
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+
+  // Protects |begin| and |end|, the range of indices not yet taken by anyone.
+  Mutex mutex;
+  size_t begin;
+  size_t end;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : workers_(),
+      run_mutex_(),
+      mutex_(),
+      job_started_(),
+      job_finished_(),
+      task_(NULL),
+      grain_(1),
+      generation_(0),
+      finished_(0),
+      shutdown_(false) {
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.push_back(new Worker(this, i));
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+#if defined(_WIN32)
+    workers_[i]->thread = reinterpret_cast<HANDLE>(
+        _beginthreadex(NULL, 0, &Worker::Run, workers_[i], 0, NULL));
+    assert(workers_[i]->thread != 0);
+#else
+    int status = pthread_create(
+        &workers_[i]->thread, NULL, &ThreadPool::ThreadMain, workers_[i]);
+    assert(status == 0);
+    (void)status;  // Prevent unused variable if assert() is optimized away.
+#endif
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    MutexLock lock(&mutex_);
+    shutdown_ = true;
+    job_started_.Broadcast();
+  }
+  for (std::vector<Worker*>::const_iterator
+       it = workers_.begin(); it != workers_.end(); ++it) {
+#if defined(_WIN32)
+    WaitForSingleObject((*it)->thread, INFINITE);
+    CloseHandle((*it)->thread);
+#else
+    pthread_join((*it)->thread, NULL);
+#endif
+    delete *it;
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, Task* task) {
+  assert(grain > 0);
+  assert(task != NULL);
+
+  if (count == 0) {
+    return;
+  }
+
+  if (workers_.empty()) {
+    task->Run(0, count);
+    return;
+  }
+
+  MutexLock run_lock(&run_mutex_);
+
+  // Divide the range into equally sized parts, one for each worker. No worker
+  // can be accessing its range now, as the previous job has finished.
+  size_t part = count / workers_.size();
+  size_t remainder = count % workers_.size();
+  size_t begin = 0;
+  for (std::vector<Worker*>::const_iterator
+       it = workers_.begin(); it != workers_.end(); ++it) {
+    size_t end = begin + part + ((*it)->index < remainder ? 1 : 0);
+    MutexLock lock(&(*it)->mutex);
+    (*it)->begin = begin;
+    (*it)->end = end;
+    begin = end;
+  }
+  assert(begin == count);
+
+  MutexLock lock(&mutex_);
+  task_ = task;
+  grain_ = grain;
+  finished_ = 0;
+  ++generation_;
+  job_started_.Broadcast();
+
+  // All indices have been processed when every worker has run out of work in
+  // its own range and found nothing left to steal from any other range.
+  while (finished_ < workers_.size()) {
+    job_finished_.Wait(&mutex_);
+  }
+  task_ = NULL;
+}
+
+// static
+void* ThreadPool::ThreadMain(void* arg) {
+  Worker* worker = static_cast<Worker*>(arg);
+  ThreadPool* pool = worker->pool;
+  size_t seen_generation = 0;
+
+  for (;;) {
+    {
+      MutexLock lock(&pool->mutex_);
+      while (!pool->shutdown_ && pool->generation_ == seen_generation) {
+        pool->job_started_.Wait(&pool->mutex_);
+      }
+      if (pool->shutdown_) {
+        return NULL;
+      }
+      seen_generation = pool->generation_;
+    }
+
+    pool->Work(worker->index);
+
+    MutexLock lock(&pool->mutex_);
+    if (++pool->finished_ == pool->workers_.size()) {
+      pool->job_finished_.Signal();
+    }
+  }
+}
+
+void ThreadPool::Work(size_t self) {
+  Worker* worker = workers_[self];
+  size_t begin;
+  size_t end;
+  do {
+    while (TakeChunk(worker, &begin, &end)) {
+      task_->Run(begin, end);
+    }
+  } while (Steal(self));
+}
+
+bool ThreadPool::TakeChunk(Worker* worker, size_t* begin, size_t* end) {
+  assert(worker != NULL);
+  assert(begin != NULL);
+  assert(end != NULL);
+  MutexLock lock(&worker->mutex);
+  if (worker->begin == worker->end) {
+    return false;
+  }
+  *begin = worker->begin;
+  *end = std::min(worker->end, worker->begin + grain_);
+  worker->begin = *end;
+  return true;
+}
+
+bool ThreadPool::Steal(size_t self) {
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker* victim = workers_[(self + i) % workers_.size()];
+    size_t begin;
+    size_t end;
+    {
+      MutexLock lock(&victim->mutex);
+      if (victim->begin == victim->end) {
+        continue;
+      }
+      // Leave the front half to the victim, which is processing it from the
+      // front, and steal the back half (or the last index, if only one).
+      begin = victim->begin + (victim->end - victim->begin) / 2;
+      end = victim->end;
+      victim->end = begin;
+    }
+    Worker* worker = workers_[self];
+    MutexLock lock(&worker->mutex);
+    worker->begin = begin;
+    worker->end = end;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace addressinput
+}  // namespace i18n
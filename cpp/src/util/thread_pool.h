@@ -0,0 +1,111 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A fixed size pool of worker threads that process ranges of indices, using
+// work stealing to balance the load between the threads.
+
+#ifndef I18N_ADDRESSINPUT_UTIL_THREAD_POOL_H_
+#define I18N_ADDRESSINPUT_UTIL_THREAD_POOL_H_
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "mutex.h"
+
+namespace i18n {
+namespace addressinput {
+
+// Runs a task over all indices of a range in parallel. Sample usage:
+//    class SquareTask : public ThreadPool::Task {
+//     public:
+//      virtual void Run(size_t begin, size_t end) {
+//        for (size_t i = begin; i < end; ++i) {
+//          output_[i] = input_[i] * input_[i];
+//        }
+//      }
+//      ...
+//    };
+//
+//    ThreadPool pool(8);
+//    SquareTask task(...);
+//    pool.ParallelFor(input.size(), 64, &task);
+//
+// Each worker thread initially owns an equally sized part of the range, and
+// processes that part in chunks from the front. A worker thread that runs out
+// of work steals the back half of the remaining part of another thread.
+class ThreadPool {
+ public:
+  class Task {
+   public:
+    virtual ~Task() {}
+
+    // Processes the indices in [begin, end). Called concurrently from several
+    // threads, but never with overlapping ranges.
+    virtual void Run(size_t begin, size_t end) = 0;
+  };
+
+  // Starts |num_threads| worker threads. If |num_threads| is zero, then all
+  // work is done by the thread that calls ParallelFor().
+  explicit ThreadPool(size_t num_threads);
+
+  // Stops and joins all worker threads.
+  ~ThreadPool();
+
+  size_t size() const { return workers_.size(); }
+
+  // Calls task->Run() for chunks of at most |grain| indices, until all indices
+  // in [0, count) have been processed. Blocks until done. Calls from different
+  // threads are serialized.
+  void ParallelFor(size_t count, size_t grain, Task* task);
+
+ private:
+  struct Worker;
+
+  static void* ThreadMain(void* arg);
+
+  // Runs the current job, for the worker with index |self|.
+  void Work(size_t self);
+
+  // Takes a chunk of at most |grain_| indices from the front of the range of
+  // |worker|. Returns false if the range is empty.
+  bool TakeChunk(Worker* worker, size_t* begin, size_t* end);
+
+  // Moves the back half of the range of some other worker than |self| to the
+  // range of |self|. Returns false if there was nothing left to steal.
+  bool Steal(size_t self);
+
+  std::vector<Worker*> workers_;
+
+  // Serializes calls to ParallelFor().
+  Mutex run_mutex_;
+
+  // Protects all the following fields.
+  Mutex mutex_;
+  ConditionVariable job_started_;
+  ConditionVariable job_finished_;
+  Task* task_;
+  size_t grain_;
+  size_t generation_;
+  size_t finished_;
+  bool shutdown_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace addressinput
+}  // namespace i18n
+
+#endif  // I18N_ADDRESSINPUT_UTIL_THREAD_POOL_H_
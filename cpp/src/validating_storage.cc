@@ -26,6 +26,7 @@
 #include <cstddef>
 #include <ctime>
 #include <string>
+#include <vector>
 
 #include "validating_util.h"
 
@@ -36,12 +37,16 @@ namespace {
 
 class Helper {
  public:
-  Helper(const std::string& key,
+  Helper(const std::vector<std::string>& keys,
          const ValidatingStorage::Callback& data_ready,
-         const Storage& wrapped_storage)
+         const Storage& wrapped_storage,
+         time_t max_age)
       : data_ready_(data_ready),
+        max_age_(max_age),
+        remaining_(keys.size()),
         wrapped_data_ready_(BuildCallback(this, &Helper::OnWrappedDataReady)) {
-    wrapped_storage.Get(key, *wrapped_data_ready_);
+    assert(!keys.empty());
+    wrapped_storage.GetMulti(keys, *wrapped_data_ready_);
   }
 
  private:
@@ -52,7 +57,8 @@ class Helper {
                           std::string* data) {
     if (success) {
       assert(data != NULL);
-      bool is_stale = !ValidatingUtil::UnwrapTimestamp(data, std::time(NULL));
+      bool is_stale =
+          !ValidatingUtil::UnwrapTimestamp(data, std::time(NULL), max_age_);
       bool is_corrupted = !ValidatingUtil::UnwrapChecksum(data);
       success = !is_corrupted && !is_stale;
       if (is_corrupted) {
@@ -64,10 +70,14 @@ class Helper {
       data = NULL;
     }
     data_ready_(success, key, data);
-    delete this;
+    if (--remaining_ == 0) {
+      delete this;
+    }
   }
 
   const Storage::Callback& data_ready_;
+  const time_t max_age_;
+  size_t remaining_;  // The number of keys not yet ready.
   const scoped_ptr<const Storage::Callback> wrapped_data_ready_;
 
   DISALLOW_COPY_AND_ASSIGN(Helper);
@@ -76,7 +86,8 @@ class Helper {
 }  // namespace
 
 ValidatingStorage::ValidatingStorage(Storage* storage)
-    : wrapped_storage_(storage) {
+    : wrapped_storage_(storage),
+      max_age_(ValidatingUtil::kDefaultMaxAge) {
   assert(wrapped_storage_ != NULL);
 }
 
@@ -90,7 +101,20 @@ void ValidatingStorage::Put(const std::string& key, std::string* data) {
 
 void ValidatingStorage::Get(const std::string& key,
                             const Callback& data_ready) const {
-  new Helper(key, data_ready, *wrapped_storage_);
+  new Helper(std::vector<std::string>(1, key),
+             data_ready, *wrapped_storage_, max_age_);
+}
+
+void ValidatingStorage::GetMulti(const std::vector<std::string>& keys,
+                                 const Callback& data_ready) const {
+  if (!keys.empty()) {
+    new Helper(keys, data_ready, *wrapped_storage_, max_age_);
+  }
+}
+
+void ValidatingStorage::set_max_age(time_t max_age) {
+  assert(max_age >= 0);
+  max_age_ = max_age;
 }
 
 }  // namespace addressinput
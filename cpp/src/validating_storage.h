@@ -23,7 +23,9 @@
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
+#include <ctime>
 #include <string>
+#include <vector>
 
 namespace i18n {
 namespace addressinput {
@@ -51,9 +53,19 @@ class ValidatingStorage : public Storage {
   // |data_ready| will be called with (true, key, fresh-data).
   virtual void Get(const std::string& key, const Callback& data_ready) const;
 
+  // Storage implementation. Same as Get(), for each of the |keys|, which are
+  // retrieved from the wrapped storage all at once.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const;
+
+  // Sets the age in seconds, from which data is stale. The default is
+  // ValidatingUtil::kDefaultMaxAge.
+  void set_max_age(time_t max_age);
+
  private:
   // The storage being wrapped.
   scoped_ptr<Storage> wrapped_storage_;
+  time_t max_age_;
 
   DISALLOW_COPY_AND_ASSIGN(ValidatingStorage);
 };
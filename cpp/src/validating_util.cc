@@ -12,22 +12,36 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //
-// ValidatingUtil wraps data with checksum and timestamp. Format:
+// ValidatingUtil wraps data with checksum and timestamp. Format 2:
 //
-//    timestamp=<timestamp>
-//    checksum=<checksum>
 //    <data>
+//    crc32c=<checksum>
+//    timestamp=<timestamp>
+//
+// The checksum and timestamp are appended as a trailer, each on a line of its
+// own, so that neither wrapping nor unwrapping needs to move <data>. There is
+// no newline at the end. The checksum is the 8-character hexadecimal CRC-32C
+// checksum of <data>. It is meant to protect from random file changes on disk.
+// The name of the checksum line identifies the checksum algorithm, so that it
+// can be changed again without breaking data stored earlier.
 //
 // The timestamp is the time_t that was returned from time() function. The
 // timestamp does not need to be portable because it is written and read only by
 // ValidatingUtil. The value is somewhat human-readable: it is the number of
 // seconds since the epoch.
 //
-// The checksum is the 32-character hexadecimal MD5 checksum of <data>. It is
-// meant to protect from random file changes on disk.
+// Data wrapped in format 1 is still unwrapped correctly:
+//
+//    timestamp=<timestamp>
+//    checksum=<checksum>
+//    <data>
+//
+// where the checksum is the 32-character hexadecimal MD5 checksum of <data>.
 
 #include "validating_util.h"
 
+#include <libaddressinput/util/basictypes.h>
+
 #include <cassert>
 #include <cstddef>
 #include <cstdio>
@@ -35,6 +49,7 @@
 #include <ctime>
 #include <string>
 
+#include "util/crc32c.h"
 #include "util/md5.h"
 
 namespace i18n {
@@ -48,6 +63,9 @@ const size_t kTimestampPrefixLength = sizeof kTimestampPrefix - 1;
 const char kChecksumPrefix[] = "checksum=";
 const size_t kChecksumPrefixLength = sizeof kChecksumPrefix - 1;
 
+const char kCrc32cPrefix[] = "crc32c=";
+const size_t kCrc32cPrefixLength = sizeof kCrc32cPrefix - 1;
+
 const char kSeparator = '\n';
 
 // Places the header value into |header_value| parameter and erases the header
@@ -78,8 +96,48 @@ bool UnwrapHeader(const char* header_prefix,
   return true;
 }
 
+// Places the value of the last line of |data| into |trailer_value| and erases
+// that line, together with the newline before it, from |data|. Returns |true|
+// if the last line starts with |trailer_prefix|.
+bool UnwrapTrailer(const char* trailer_prefix,
+                   size_t trailer_prefix_length,
+                   std::string* data,
+                   std::string* trailer_value) {
+  assert(trailer_prefix != NULL);
+  assert(data != NULL);
+  assert(trailer_value != NULL);
+
+  std::string::size_type separator_position = data->rfind(kSeparator);
+  if (separator_position == std::string::npos ||
+      data->compare(separator_position + 1,
+                    trailer_prefix_length,
+                    trailer_prefix,
+                    trailer_prefix_length) != 0) {
+    return false;
+  }
+
+  trailer_value->assign(
+      *data, separator_position + 1 + trailer_prefix_length, std::string::npos);
+  data->resize(separator_position);
+
+  return true;
+}
+
+std::string Crc32cString(const std::string& data) {
+  char checksum[9];
+  int size = std::sprintf(checksum, "%08x",
+                          static_cast<unsigned int>(
+                              Crc32c(data.data(), data.size())));
+  assert(size == 8);
+  (void)size;
+  return std::string(checksum, 8);
+}
+
 }  // namespace
 
+// static
+const time_t ValidatingUtil::kDefaultMaxAge;
+
 // static
 void ValidatingUtil::Wrap(time_t timestamp, std::string* data) {
   assert(data != NULL);
@@ -87,30 +145,39 @@ void ValidatingUtil::Wrap(time_t timestamp, std::string* data) {
   int size = std::sprintf(timestamp_string, "%ld", timestamp);
   assert(size > 0);
   assert(size < sizeof timestamp_string);
-  (void)size;
 
-  std::string header;
-  header.append(kTimestampPrefix, kTimestampPrefixLength);
-  header.append(timestamp_string);
-  header.push_back(kSeparator);
+  const std::string& checksum = Crc32cString(*data);
+  data->reserve(data->size() + 2 + kCrc32cPrefixLength + checksum.size() +
+                kTimestampPrefixLength + size);
 
-  header.append(kChecksumPrefix, kChecksumPrefixLength);
-  header.append(MD5String(*data));
-  header.push_back(kSeparator);
+  data->push_back(kSeparator);
+  data->append(kCrc32cPrefix, kCrc32cPrefixLength);
+  data->append(checksum);
 
-  data->reserve(header.size() + data->size());
-  data->insert(0, header);
+  data->push_back(kSeparator);
+  data->append(kTimestampPrefix, kTimestampPrefixLength);
+  data->append(timestamp_string, size);
 }
 
 // static
 bool ValidatingUtil::UnwrapTimestamp(std::string* data, time_t now) {
+  return UnwrapTimestamp(data, now, kDefaultMaxAge);
+}
+
+// static
+bool ValidatingUtil::UnwrapTimestamp(std::string* data,
+                                     time_t now,
+                                     time_t max_age) {
   assert(data != NULL);
+  assert(max_age >= 0);
   if (now < 0) {
     return false;
   }
 
   std::string timestamp_string;
   if (!UnwrapHeader(
+          kTimestampPrefix, kTimestampPrefixLength, data, &timestamp_string) &&
+      !UnwrapTrailer(
           kTimestampPrefix, kTimestampPrefixLength, data, &timestamp_string)) {
     return false;
   }
@@ -120,24 +187,22 @@ bool ValidatingUtil::UnwrapTimestamp(std::string* data, time_t now) {
     return false;
   }
 
-  // One month contains:
-  //    30 days *
-  //    24 hours per day *
-  //    60 minutes per hour *
-  //    60 seconds per minute.
-  static const double kOneMonthInSeconds = 30.0 * 24.0 * 60.0 * 60.0;
   double age_in_seconds = difftime(now, timestamp);
-  return !(age_in_seconds < 0.0) && age_in_seconds < kOneMonthInSeconds;
+  return !(age_in_seconds < 0.0) &&
+         age_in_seconds < static_cast<double>(max_age);
 }
 
 // static
 bool ValidatingUtil::UnwrapChecksum(std::string* data) {
   assert(data != NULL);
   std::string checksum;
-  if (!UnwrapHeader(kChecksumPrefix, kChecksumPrefixLength, data, &checksum)) {
-    return false;
+  if (UnwrapHeader(kChecksumPrefix, kChecksumPrefixLength, data, &checksum)) {
+    return checksum == MD5String(*data);  // Format 1.
+  }
+  if (UnwrapTrailer(kCrc32cPrefix, kCrc32cPrefixLength, data, &checksum)) {
+    return checksum == Crc32cString(*data);
   }
-  return checksum == MD5String(*data);
+  return false;
 }
 
 }  // namespace addressinput
@@ -13,8 +13,8 @@
 // limitations under the License.
 //
 // An object to wrap data with a checksum and a timestamp. These fields are used
-// to verify that the data is not stale or corrupted. Staleness threshold is 1
-// month.
+// to verify that the data is not stale or corrupted. The default staleness
+// threshold is 1 month.
 
 #ifndef I18N_ADDRESSINPUT_VALIDATING_UTIL_H_
 #define I18N_ADDRESSINPUT_VALIDATING_UTIL_H_
@@ -37,6 +37,10 @@ namespace addressinput {
 //    }
 class ValidatingUtil {
  public:
+  // The default maximum age of data, in seconds: one month contains 30 days *
+  // 24 hours per day * 60 minutes per hour * 60 seconds per minute.
+  static const time_t kDefaultMaxAge = 30 * 24 * 60 * 60;
+
   // Adds checksum and given |timestamp| to |data|.
   static void Wrap(time_t timestamp, std::string* data);
 
@@ -44,6 +48,10 @@ class ValidatingUtil {
   // present, formatted correctly, valid, and recent with respect to |now|.
   static bool UnwrapTimestamp(std::string* data, time_t now);
 
+  // Same as above, but |data| is recent only if it's less than |max_age|
+  // seconds old, instead of kDefaultMaxAge.
+  static bool UnwrapTimestamp(std::string* data, time_t now, time_t max_age);
+
   // Strips out the checksum from |data|. Returns |true| if the checksum is
   // present, formatted correctly, and valid for this data.
   static bool UnwrapChecksum(std::string* data);
@@ -0,0 +1,260 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/validation_cache.h>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/problem_filter.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/validation_result.h>
+
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+namespace {
+
+// 64-bit FNV-1a hashing, see http://www.isthe.com/chongo/tech/comp/fnv/
+class Hasher {
+ public:
+  Hasher() : hash_((static_cast<uint64>(0xcbf29ce4) << 32) | 0x84222325) {}
+
+  void Add(const std::string& value) {
+    for (std::string::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      AddByte(static_cast<unsigned char>(*it));
+    }
+    // Terminate each string, so that moving characters from the end of one
+    // field to the beginning of the next changes the hash.
+    AddByte(0);
+  }
+
+  void Add(uint64 value) {
+    for (int i = 0; i < 8; ++i) {
+      AddByte(static_cast<unsigned char>(value >> (i * 8)));
+    }
+  }
+
+  uint64 hash() const { return hash_; }
+
+ private:
+  void AddByte(unsigned char byte) {
+    static const uint64 kPrime = (static_cast<uint64>(1) << 40) | 0x1b3;
+    hash_ ^= byte;
+    hash_ *= kPrime;
+  }
+
+  uint64 hash_;
+
+  DISALLOW_COPY_AND_ASSIGN(Hasher);
+};
+
+uint64 Hash(const AddressData& address,
+            int options,
+            const ValidationResult& filter) {
+  Hasher hasher;
+  hasher.Add(address.region_code);
+  hasher.Add(static_cast<uint64>(address.address_line.size()));
+  for (std::vector<std::string>::const_iterator
+       it = address.address_line.begin();
+       it != address.address_line.end(); ++it) {
+    hasher.Add(*it);
+  }
+  hasher.Add(address.administrative_area);
+  hasher.Add(address.locality);
+  hasher.Add(address.dependent_locality);
+  hasher.Add(address.postal_code);
+  hasher.Add(address.sorting_code);
+  hasher.Add(address.language_code);
+  hasher.Add(address.recipient);
+  hasher.Add(static_cast<uint64>(options));
+  // A ValidationResult doesn't expose its bits, so hash the pairs instead.
+  for (ValidationResult::const_iterator it = filter.begin();
+       it != filter.end(); ++it) {
+    hasher.Add(static_cast<uint64>(it->first * 8 + it->second));
+  }
+  return hasher.hash();
+}
+
+int GetOptions(bool allow_postal, bool require_name) {
+  return (allow_postal ? 1 : 0) | (require_name ? 2 : 0);
+}
+
+// A NULL filter and an empty filter both let all problems through, and are
+// represented the same way, by an empty ValidationResult.
+ValidationResult GetFilter(const FieldProblemMap* filter) {
+  return filter != NULL ? ValidationResult(*filter) : ValidationResult();
+}
+
+// A ProblemFilter has no pairs if it lets all problems through, the same way.
+ValidationResult GetFilter(const ProblemFilter* filter) {
+  return filter != NULL ? filter->pairs() : ValidationResult();
+}
+
+}  // namespace
+
+ValidationCache::ValidationCache(size_t max_entries)
+    : max_entries_(max_entries),
+      entries_(),
+      index_(),
+      hits_(0),
+      misses_(0) {
+  assert(max_entries_ > 0);
+}
+
+ValidationCache::~ValidationCache() {}
+
+bool ValidationCache::Lookup(const AddressData& address,
+                             bool allow_postal,
+                             bool require_name,
+                             const FieldProblemMap* filter,
+                             int rules_generation,
+                             ValidationResult* result) {
+  return LookupEntry(address, GetOptions(allow_postal, require_name),
+                     GetFilter(filter), rules_generation, result);
+}
+
+bool ValidationCache::Lookup(const AddressData& address,
+                             const ValidationOptions& options,
+                             int rules_generation,
+                             ValidationResult* result) {
+  return LookupEntry(address,
+                     GetOptions(options.allow_postal, options.require_name),
+                     GetFilter(options.filter), rules_generation, result);
+}
+
+void ValidationCache::Insert(const AddressData& address,
+                             bool allow_postal,
+                             bool require_name,
+                             const FieldProblemMap* filter,
+                             int rules_generation,
+                             const ValidationResult& result) {
+  InsertEntry(address, GetOptions(allow_postal, require_name),
+              GetFilter(filter), rules_generation, result);
+}
+
+void ValidationCache::Insert(const AddressData& address,
+                             const ValidationOptions& options,
+                             int rules_generation,
+                             const ValidationResult& result) {
+  InsertEntry(address, GetOptions(options.allow_postal, options.require_name),
+              GetFilter(options.filter), rules_generation, result);
+}
+
+bool ValidationCache::LookupEntry(const AddressData& address,
+                                  int options,
+                                  const ValidationResult& filter,
+                                  int rules_generation,
+                                  ValidationResult* result) {
+  assert(result != NULL);
+  EntryList::iterator entry =
+      Find(Hash(address, options, filter), address, options, filter);
+  if (entry == entries_.end()) {
+    ++misses_;
+    return false;
+  }
+  if (entry->rules_generation != rules_generation) {
+    // Validated with rules that have since been replaced.
+    Erase(entry);
+    ++misses_;
+    return false;
+  }
+  // Move the entry to the end of the list, as the most recently used.
+  entries_.splice(entries_.end(), entries_, entry);
+  *result = entry->result;
+  ++hits_;
+  return true;
+}
+
+void ValidationCache::InsertEntry(const AddressData& address,
+                                  int options,
+                                  const ValidationResult& filter,
+                                  int rules_generation,
+                                  const ValidationResult& result) {
+  uint64 hash = Hash(address, options, filter);
+
+  EntryList::iterator entry = Find(hash, address, options, filter);
+  if (entry != entries_.end()) {
+    entries_.splice(entries_.end(), entries_, entry);
+    entry->rules_generation = rules_generation;
+    entry->result = result;
+    return;
+  }
+
+  if (index_.size() >= max_entries_) {
+    Erase(entries_.begin());
+  }
+
+  Entry new_entry;
+  new_entry.hash = hash;
+  new_entry.address = address;
+  new_entry.options = options;
+  new_entry.filter = filter;
+  new_entry.rules_generation = rules_generation;
+  new_entry.result = result;
+  entry = entries_.insert(entries_.end(), new_entry);
+  index_.insert(std::make_pair(hash, entry));
+}
+
+void ValidationCache::InvalidateRegion(const std::string& region_code) {
+  for (EntryList::iterator it = entries_.begin(); it != entries_.end(); ) {
+    EntryList::iterator entry = it++;
+    if (entry->address.region_code == region_code) {
+      Erase(entry);
+    }
+  }
+}
+
+void ValidationCache::Clear() {
+  index_.clear();
+  entries_.clear();
+}
+
+ValidationCache::EntryList::iterator ValidationCache::Find(
+    uint64 hash,
+    const AddressData& address,
+    int options,
+    const ValidationResult& filter) {
+  std::pair<Index::iterator, Index::iterator> range = index_.equal_range(hash);
+  for (Index::iterator it = range.first; it != range.second; ++it) {
+    const Entry& entry = *it->second;
+    if (entry.options == options &&
+        entry.filter == filter &&
+        entry.address == address) {
+      return it->second;
+    }
+  }
+  return entries_.end();
+}
+
+void ValidationCache::Erase(EntryList::iterator entry) {
+  std::pair<Index::iterator, Index::iterator> range =
+      index_.equal_range(entry->hash);
+  for (Index::iterator it = range.first; it != range.second; ++it) {
+    if (it->second == entry) {
+      index_.erase(it);
+      break;
+    }
+  }
+  entries_.erase(entry);
+}
+
+}  // namespace addressinput
+}  // namespace i18n
@@ -0,0 +1,79 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/validation_result.h>
+
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/util/basictypes.h>
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+namespace i18n {
+namespace addressinput {
+
+ValidationResult::const_iterator::const_iterator(uint64 bits, size_t bit)
+    : bits_(bits),
+      bit_(bit),
+      value_(COUNTRY, UNEXPECTED_FIELD) {
+  SkipUnset();
+}
+
+ValidationResult::const_iterator&
+ValidationResult::const_iterator::operator++() {
+  assert(bit_ < kNumBits);
+  ++bit_;
+  SkipUnset();
+  return *this;
+}
+
+void ValidationResult::const_iterator::SkipUnset() {
+  while (bit_ < kNumBits && (bits_ & (static_cast<uint64>(1) << bit_)) == 0) {
+    ++bit_;
+  }
+  if (bit_ < kNumBits) {
+    value_ = value_type(static_cast<AddressField>(bit_ / kBitsPerField),
+                        static_cast<AddressProblem>(bit_ % kBitsPerField));
+  }
+}
+
+ValidationResult::ValidationResult(const FieldProblemMap& problems)
+    : bits_(0) {
+  for (FieldProblemMap::const_iterator
+       it = problems.begin(); it != problems.end(); ++it) {
+    Add(it->first, it->second);
+  }
+}
+
+size_t ValidationResult::size() const {
+  size_t size = 0;
+  for (uint64 bits = bits_; bits != 0; bits &= bits - 1) {
+    ++size;
+  }
+  return size;
+}
+
+void ValidationResult::ToFieldProblemMap(FieldProblemMap* problems) const {
+  assert(problems != NULL);
+  problems->clear();
+  for (const_iterator it = begin(); it != end(); ++it) {
+    problems->insert(problems->end(), *it);
+  }
+}
+
+}  // namespace addressinput
+}  // namespace i18n
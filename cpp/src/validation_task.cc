@@ -16,42 +16,50 @@
 
 #include <libaddressinput/address_data.h>
 #include <libaddressinput/address_field.h>
-#include <libaddressinput/address_metadata.h>
 #include <libaddressinput/address_problem.h>
 #include <libaddressinput/address_validator.h>
 #include <libaddressinput/callback.h>
+#include <libaddressinput/problem_filter.h>
 #include <libaddressinput/supplier.h>
 #include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/validation_cache.h>
 
-#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <string>
-#include <utility>
-#include <vector>
-
-#include <re2/re2.h>
 
 #include "lookup_key.h"
 #include "post_box_matchers.h"
+#include "postal_code_matcher.h"
+#include "region_data_constants.h"
 #include "rule.h"
-#include "util/re2ptr.h"
 
 namespace i18n {
 namespace addressinput {
 
+namespace {
+
+// The bit mask with the bits of all fields set.
+const int kAllFields = (1 << (RECIPIENT + 1)) - 1;
+
+}  // namespace
+
 ValidationTask::ValidationTask(const AddressData& address,
-                               bool allow_postal,
-                               bool require_name,
-                               const FieldProblemMap* filter,
+                               const ValidationOptions& options,
+                               ValidationCache* cache,
+                               int rules_generation,
                                FieldProblemMap* problems,
                                const AddressValidator::Callback& validated)
-    : address_(address),
-      allow_postal_(allow_postal),
-      require_name_(require_name),
-      filter_(filter),
+    : address_(&address),
+      allow_postal_(options.allow_postal),
+      require_name_(options.require_name),
+      filter_(options.filter != NULL ? *options.filter : ProblemFilter()),
+      cache_(cache),
+      rules_generation_(rules_generation),
       problems_(problems),
-      validated_(validated),
+      result_(),
+      fields_(kAllFields),
+      validated_(&validated),
       supplied_(BuildCallback(this, &ValidationTask::Validate)),
       lookup_key_(new LookupKey) {
   assert(problems_ != NULL);
@@ -59,49 +67,121 @@ ValidationTask::ValidationTask(const AddressData& address,
   assert(lookup_key_ != NULL);
 }
 
+ValidationTask::ValidationTask(bool allow_postal,
+                               bool require_name,
+                               const ProblemFilter& filter)
+    : address_(NULL),
+      allow_postal_(allow_postal),
+      require_name_(require_name),
+      filter_(filter),
+      cache_(NULL),
+      rules_generation_(0),
+      problems_(NULL),
+      result_(),
+      fields_(kAllFields),
+      validated_(NULL),
+      supplied_(),
+      lookup_key_() {}
+
 ValidationTask::~ValidationTask() {
 }
 
 void ValidationTask::Run(Supplier* supplier) const {
   assert(supplier != NULL);
+  assert(supplied_ != NULL);  // Sanity check: This task can be Run().
   problems_->clear();
-  lookup_key_->FromAddress(address_);
+  lookup_key_->FromAddress(*address_);
   supplier->Supply(*lookup_key_, *supplied_);
 }
 
+void ValidationTask::Check(const AddressData& address,
+                           const Supplier::RuleHierarchy& hierarchy,
+                           ValidationResult* result) {
+  assert(result != NULL);
+  assert(supplied_ == NULL);  // Sanity check: This task can't be Run().
+  address_ = &address;
+  result_.clear();
+  fields_ = kAllFields;
+  CheckAll(hierarchy);
+  *result = result_;
+}
+
+void ValidationTask::Check(const AddressData& address,
+                           const Supplier::RuleHierarchy& hierarchy,
+                           FieldProblemMap* problems) {
+  assert(problems != NULL);
+  ValidationResult result;
+  Check(address, hierarchy, &result);
+  result.ToFieldProblemMap(problems);
+}
+
+void ValidationTask::CheckFields(const AddressData& address,
+                                 const Supplier::RuleHierarchy& hierarchy,
+                                 int fields,
+                                 ValidationResult* result) {
+  assert(result != NULL);
+  assert(supplied_ == NULL);  // Sanity check: This task can't be Run().
+  address_ = &address;
+  result_ = *result;
+  for (int field = COUNTRY; field <= RECIPIENT; ++field) {
+    if ((fields & (1 << field)) != 0) {
+      result_.ClearField(static_cast<AddressField>(field));
+    }
+  }
+  fields_ = fields;
+  CheckAll(hierarchy);
+  *result = result_;
+}
+
 void ValidationTask::Validate(bool success,
                               const LookupKey& lookup_key,
                               const Supplier::RuleHierarchy& hierarchy) {
   assert(&lookup_key == lookup_key_.get());  // Sanity check.
 
   if (success) {
-    if (address_.IsFieldEmpty(COUNTRY)) {
-      ReportProblemMaybe(COUNTRY, MISSING_REQUIRED_FIELD);
-    } else if (hierarchy.rule[0] == NULL) {
-      ReportProblemMaybe(COUNTRY, UNKNOWN_VALUE);
-    } else {
-      // Checks which use statically linked metadata.
-      const std::string& region_code = address_.region_code;
-      CheckUnexpectedField(region_code);
-      CheckMissingRequiredField(region_code);
-
-      // Checks which use data from the metadata server. Note that
-      // CheckPostalCodeFormatAndValue assumes CheckUnexpectedField has already
-      // been called.
-      CheckUnknownValue(hierarchy);
-      CheckPostalCodeFormatAndValue(hierarchy);
-      CheckUsesPoBox(hierarchy);
+    CheckAll(hierarchy);
+    result_.ToFieldProblemMap(problems_);
+    if (cache_ != NULL) {
+      ValidationOptions options;
+      options.allow_postal = allow_postal_;
+      options.require_name = require_name_;
+      options.filter = &filter_;
+      cache_->Insert(*address_, options, rules_generation_, result_);
     }
   }
 
-  validated_(success, address_, *problems_);
+  (*validated_)(success, *address_, *problems_);
   delete this;
 }
 
+void ValidationTask::CheckAll(const Supplier::RuleHierarchy& hierarchy) {
+  if (address_->IsFieldEmpty(COUNTRY)) {
+    if (ShouldCheck(COUNTRY)) {
+      ReportProblemMaybe(COUNTRY, MISSING_REQUIRED_FIELD);
+    }
+  } else if (hierarchy.rule[0] == NULL) {
+    if (ShouldCheck(COUNTRY)) {
+      ReportProblemMaybe(COUNTRY, UNKNOWN_VALUE);
+    }
+  } else {
+    // Checks which use statically linked metadata.
+    const std::string& region_code = address_->region_code;
+    CheckUnexpectedField(region_code);
+    CheckMissingRequiredField(region_code);
+
+    // Checks which use data from the metadata server. Note that
+    // CheckPostalCodeFormatAndValue assumes CheckUnexpectedField has already
+    // been called.
+    CheckUnknownValue(hierarchy);
+    CheckPostalCodeFormatAndValue(hierarchy);
+    CheckUsesPoBox(hierarchy);
+  }
+}
+
 // A field will return an UNEXPECTED_FIELD problem type if the current value of
 // that field is not empty and the field should not be used by that region.
 void ValidationTask::CheckUnexpectedField(
-    const std::string& region_code) const {
+    const std::string& region_code) {
   static const AddressField kFields[] = {
     // COUNTRY is never unexpected.
     ADMIN_AREA,
@@ -113,9 +193,15 @@ void ValidationTask::CheckUnexpectedField(
     RECIPIENT
   };
 
+  if (!filter_.ShouldReportAny(UNEXPECTED_FIELD)) {
+    return;
+  }
+
+  int used_fields = RegionDataConstants::GetUsedFields(region_code);
   for (size_t i = 0; i < arraysize(kFields); ++i) {
     AddressField field = kFields[i];
-    if (!address_.IsFieldEmpty(field) && !IsFieldUsed(field, region_code)) {
+    if (ShouldCheck(field) &&
+        !address_->IsFieldEmpty(field) && (used_fields & (1 << field)) == 0) {
       ReportProblemMaybe(field, UNEXPECTED_FIELD);
     }
   }
@@ -124,7 +210,7 @@ void ValidationTask::CheckUnexpectedField(
 // A field will return an MISSING_REQUIRED_FIELD problem type if the current
 // value of that field is empty and the field is required by that region.
 void ValidationTask::CheckMissingRequiredField(
-    const std::string& region_code) const {
+    const std::string& region_code) {
   static const AddressField kFields[] = {
     // COUNTRY is assumed to have already been checked.
     ADMIN_AREA,
@@ -136,14 +222,22 @@ void ValidationTask::CheckMissingRequiredField(
     // RECIPIENT is handled separately.
   };
 
+  if (!filter_.ShouldReportAny(MISSING_REQUIRED_FIELD)) {
+    return;
+  }
+
+  int required_fields = RegionDataConstants::GetRequiredFields(region_code);
   for (size_t i = 0; i < arraysize(kFields); ++i) {
     AddressField field = kFields[i];
-    if (address_.IsFieldEmpty(field) && IsFieldRequired(field, region_code)) {
+    if (ShouldCheck(field) &&
+        address_->IsFieldEmpty(field) &&
+        (required_fields & (1 << field)) != 0) {
       ReportProblemMaybe(field, MISSING_REQUIRED_FIELD);
     }
   }
 
-  if (require_name_ && address_.IsFieldEmpty(RECIPIENT)) {
+  if (require_name_ && ShouldCheck(RECIPIENT) &&
+      address_->IsFieldEmpty(RECIPIENT)) {
     ReportProblemMaybe(RECIPIENT, MISSING_REQUIRED_FIELD);
   }
 }
@@ -152,10 +246,15 @@ void ValidationTask::CheckMissingRequiredField(
 // for the field and the address data server could not match the current value
 // of that field to one of those possible values, therefore returning NULL.
 void ValidationTask::CheckUnknownValue(
-    const Supplier::RuleHierarchy& hierarchy) const {
+    const Supplier::RuleHierarchy& hierarchy) {
+  if (!filter_.ShouldReportAny(UNKNOWN_VALUE)) {
+    return;
+  }
+
   for (size_t depth = 1; depth < arraysize(LookupKey::kHierarchy); ++depth) {
     AddressField field = LookupKey::kHierarchy[depth];
-    if (!(address_.IsFieldEmpty(field) ||
+    if (!(!ShouldCheck(field) ||
+          address_->IsFieldEmpty(field) ||
           hierarchy.rule[depth - 1] == NULL ||
           hierarchy.rule[depth - 1]->GetSubKeys().empty() ||
           hierarchy.rule[depth] != NULL)) {
@@ -166,29 +265,27 @@ void ValidationTask::CheckUnknownValue(
 
 // Note that it is assumed that CheckUnexpectedField has already been called.
 void ValidationTask::CheckPostalCodeFormatAndValue(
-    const Supplier::RuleHierarchy& hierarchy) const {
+    const Supplier::RuleHierarchy& hierarchy) {
   assert(hierarchy.rule[0] != NULL);
   const Rule& country_rule = *hierarchy.rule[0];
 
-  if (!(ShouldReport(POSTAL_CODE, INVALID_FORMAT) ||
+  if (!ShouldCheck(POSTAL_CODE) ||
+      !(ShouldReport(POSTAL_CODE, INVALID_FORMAT) ||
         ShouldReport(POSTAL_CODE, MISMATCHING_VALUE))) {
     return;
   }
 
-  if (address_.IsFieldEmpty(POSTAL_CODE)) {
+  if (address_->IsFieldEmpty(POSTAL_CODE)) {
     return;
-  } else if (std::find(problems_->begin(), problems_->end(),
-                       FieldProblemMap::value_type(POSTAL_CODE,
-                                                   UNEXPECTED_FIELD))
-             != problems_->end()) {
+  } else if (result_.Contains(POSTAL_CODE, UNEXPECTED_FIELD)) {
     return;  // Problem already reported.
   }
 
   // Validate general postal code format. A country-level rule specifies the
   // regular expression for the whole postal code.
-  const RE2ptr* format_ptr = country_rule.GetPostalCodeMatcher();
-  if (format_ptr != NULL &&
-      !RE2::FullMatch(address_.postal_code, *format_ptr->ptr) &&
+  const PostalCodeMatcher* format = country_rule.GetPostalCodeMatcher();
+  if (format != NULL &&
+      !format->FullMatch(address_->postal_code) &&
       ShouldReport(POSTAL_CODE, INVALID_FORMAT)) {
     ReportProblem(POSTAL_CODE, INVALID_FORMAT);
     return;
@@ -203,9 +300,10 @@ void ValidationTask::CheckPostalCodeFormatAndValue(
     if (hierarchy.rule[depth] != NULL) {
       // Validate sub-region specific postal code format. A sub-region specifies
       // the regular expression for a prefix of the postal code.
-      const RE2ptr* prefix_ptr = hierarchy.rule[depth]->GetPostalCodeMatcher();
-      if (prefix_ptr != NULL) {
-        if (!RE2::PartialMatch(address_.postal_code, *prefix_ptr->ptr)) {
+      const PostalCodeMatcher* prefix =
+          hierarchy.rule[depth]->GetPostalCodeMatcher();
+      if (prefix != NULL) {
+        if (!prefix->PrefixMatch(address_->postal_code)) {
           ReportProblem(POSTAL_CODE, MISMATCHING_VALUE);
         }
         return;
@@ -215,39 +313,29 @@ void ValidationTask::CheckPostalCodeFormatAndValue(
 }
 
 void ValidationTask::CheckUsesPoBox(
-    const Supplier::RuleHierarchy& hierarchy) const {
+    const Supplier::RuleHierarchy& hierarchy) {
   assert(hierarchy.rule[0] != NULL);
   const Rule& country_rule = *hierarchy.rule[0];
 
   if (allow_postal_ ||
+      !ShouldCheck(STREET_ADDRESS) ||
       !ShouldReport(STREET_ADDRESS, USES_P_O_BOX) ||
-      address_.IsFieldEmpty(STREET_ADDRESS)) {
+      address_->IsFieldEmpty(STREET_ADDRESS)) {
     return;
   }
 
-  std::vector<const RE2ptr*> matchers =
-      PostBoxMatchers::GetMatchers(country_rule);
-  for (std::vector<std::string>::const_iterator
-       line = address_.address_line.begin();
-       line != address_.address_line.end(); ++line) {
-    for (std::vector<const RE2ptr*>::const_iterator
-         matcher = matchers.begin();
-         matcher != matchers.end(); ++matcher) {
-      if (RE2::PartialMatch(*line, *(*matcher)->ptr)) {
-        ReportProblem(STREET_ADDRESS, USES_P_O_BOX);
-        return;
-      }
-    }
+  if (PostBoxMatchers::HasPostBox(country_rule, address_->address_line)) {
+    ReportProblem(STREET_ADDRESS, USES_P_O_BOX);
   }
 }
 
 void ValidationTask::ReportProblem(AddressField field,
-                                   AddressProblem problem) const {
-  problems_->insert(std::make_pair(field, problem));
+                                   AddressProblem problem) {
+  result_.Add(field, problem);
 }
 
 void ValidationTask::ReportProblemMaybe(AddressField field,
-                                        AddressProblem problem) const {
+                                        AddressProblem problem) {
   if (ShouldReport(field, problem)) {
     ReportProblem(field, problem);
   }
@@ -255,11 +343,7 @@ void ValidationTask::ReportProblemMaybe(AddressField field,
 
 bool ValidationTask::ShouldReport(AddressField field,
                                   AddressProblem problem) const {
-  return filter_ == NULL || filter_->empty() ||
-         std::find(filter_->begin(),
-                   filter_->end(),
-                   FieldProblemMap::value_type(field, problem)) !=
-             filter_->end();
+  return filter_.ShouldReport(field, problem);
 }
 
 }  // namespace addressinput
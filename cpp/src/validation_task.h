@@ -18,8 +18,10 @@
 #include <libaddressinput/address_field.h>
 #include <libaddressinput/address_problem.h>
 #include <libaddressinput/address_validator.h>
+#include <libaddressinput/problem_filter.h>
 #include <libaddressinput/supplier.h>
 #include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/validation_result.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
 #include <string>
@@ -28,6 +30,7 @@ namespace i18n {
 namespace addressinput {
 
 class LookupKey;
+class ValidationCache;
 struct AddressData;
 
 // A ValidationTask object encapsulates the information necessary to perform
@@ -36,18 +39,47 @@ struct AddressData;
 // validation, call the callback and delete the ValidationTask object itself.
 class ValidationTask {
  public:
+  // Stores the problems found into |cache|, if not NULL, as found with rules
+  // of |rules_generation|. Copies the filter of |options|, if any.
   ValidationTask(const AddressData& address,
-                 bool allow_postal,
-                 bool require_name,
-                 const FieldProblemMap* filter,
+                 const ValidationOptions& options,
+                 ValidationCache* cache,
+                 int rules_generation,
                  FieldProblemMap* problems,
                  const AddressValidator::Callback& validated);
 
+  // Constructs a ValidationTask object that can't be Run(), but only be used
+  // for calling Check() on any number of addresses that share the same
+  // metadata.
+  ValidationTask(bool allow_postal,
+                 bool require_name,
+                 const ProblemFilter& filter);
+
   ~ValidationTask();
 
   // Calls supplier->Load(), with Validate() as callback.
   void Run(Supplier* supplier) const;
 
+  // Uses the address metadata of |hierarchy| to validate |address|, writing
+  // problems found into |result|. Doesn't call any callback and doesn't
+  // delete this ValidationTask object. Doesn't allocate any memory.
+  void Check(const AddressData& address,
+             const Supplier::RuleHierarchy& hierarchy,
+             ValidationResult* result);
+
+  // Same as above, but writes the problems found into |problems|.
+  void Check(const AddressData& address,
+             const Supplier::RuleHierarchy& hierarchy,
+             FieldProblemMap* problems);
+
+  // Same as Check(), but only checks the fields in |fields|, a bit mask with
+  // bit (1 << field) set for each field to check. The problems of these fields
+  // in |result| are replaced, while those of all other fields are kept.
+  void CheckFields(const AddressData& address,
+                   const Supplier::RuleHierarchy& hierarchy,
+                   int fields,
+                   ValidationResult* result);
+
  private:
   friend class ValidationTaskTest;
 
@@ -58,37 +90,49 @@ class ValidationTask {
                 const LookupKey& lookup_key,
                 const Supplier::RuleHierarchy& hierarchy);
 
+  // Performs all checks of |address_|, writing problems found into |result_|.
+  void CheckAll(const Supplier::RuleHierarchy& hierarchy);
+
   // Checks all fields for UNEXPECTED_FIELD problems.
-  void CheckUnexpectedField(const std::string& region_code) const;
+  void CheckUnexpectedField(const std::string& region_code);
 
   // Checks all fields for MISSING_REQUIRED_FIELD problems.
-  void CheckMissingRequiredField(const std::string& region_code) const;
+  void CheckMissingRequiredField(const std::string& region_code);
 
   // Checks the hierarchical fields for UNKNOWN_VALUE problems.
-  void CheckUnknownValue(const Supplier::RuleHierarchy& hierarchy) const;
+  void CheckUnknownValue(const Supplier::RuleHierarchy& hierarchy);
 
   // Checks the POSTAL_CODE field for problems.
   void CheckPostalCodeFormatAndValue(
-      const Supplier::RuleHierarchy& hierarchy) const;
+      const Supplier::RuleHierarchy& hierarchy);
 
   // Checks the STREET_ADDRESS field for USES_P_O_BOX problems.
-  void CheckUsesPoBox(const Supplier::RuleHierarchy& hierarchy) const;
+  void CheckUsesPoBox(const Supplier::RuleHierarchy& hierarchy);
 
-  // Writes (|field|,|problem|) to |problems_|.
-  void ReportProblem(AddressField field, AddressProblem problem) const;
+  // Writes (|field|,|problem|) to |result_|.
+  void ReportProblem(AddressField field, AddressProblem problem);
 
-  // Writes (|field|,|problem|) to |problems_|, if this pair should be reported.
-  void ReportProblemMaybe(AddressField field, AddressProblem problem) const;
+  // Writes (|field|,|problem|) to |result_|, if this pair should be reported.
+  void ReportProblemMaybe(AddressField field, AddressProblem problem);
 
   // Returns whether (|field|,|problem|) should be reported.
   bool ShouldReport(AddressField field, AddressProblem problem) const;
 
-  const AddressData& address_;
+  // Returns whether |field| is among the fields to check.
+  bool ShouldCheck(AddressField field) const {
+    return (fields_ & (1 << field)) != 0;
+  }
+
+  const AddressData* address_;
   const bool allow_postal_;
   const bool require_name_;
-  const FieldProblemMap* filter_;
-  FieldProblemMap* const problems_;
-  const AddressValidator::Callback& validated_;
+  const ProblemFilter filter_;
+  ValidationCache* const cache_;
+  const int rules_generation_;
+  FieldProblemMap* problems_;
+  ValidationResult result_;
+  int fields_;  // Bit mask of the fields to check.
+  const AddressValidator::Callback* const validated_;
   const scoped_ptr<const Supplier::Callback> supplied_;
   const scoped_ptr<LookupKey> lookup_key_;
 
@@ -21,11 +21,15 @@
 #include <libaddressinput/null_storage.h>
 #include <libaddressinput/ondemand_supplier.h>
 #include <libaddressinput/preload_supplier.h>
+#include <libaddressinput/problem_filter.h>
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
+#include <libaddressinput/validation_result.h>
 
+#include <cstddef>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -40,8 +44,11 @@ using i18n::addressinput::FieldProblemMap;
 using i18n::addressinput::NullStorage;
 using i18n::addressinput::OndemandSupplier;
 using i18n::addressinput::PreloadSupplier;
+using i18n::addressinput::ProblemFilter;
 using i18n::addressinput::scoped_ptr;
 using i18n::addressinput::TestdataSource;
+using i18n::addressinput::ValidationOptions;
+using i18n::addressinput::ValidationResult;
 
 using i18n::addressinput::COUNTRY;
 using i18n::addressinput::ADMIN_AREA;
@@ -54,6 +61,7 @@ using i18n::addressinput::MISSING_REQUIRED_FIELD;
 using i18n::addressinput::UNKNOWN_VALUE;
 using i18n::addressinput::INVALID_FORMAT;
 using i18n::addressinput::MISMATCHING_VALUE;
+using i18n::addressinput::USES_P_O_BOX;
 
 class ValidatorWrapper {
  public:
@@ -64,6 +72,12 @@ class ValidatorWrapper {
                         const FieldProblemMap* filter,
                         FieldProblemMap* problems,
                         const AddressValidator::Callback& validated) = 0;
+  virtual void ValidateBatch(const std::vector<AddressData>& addresses,
+                             bool allow_postal,
+                             bool require_name,
+                             const FieldProblemMap* filter,
+                             std::vector<FieldProblemMap>* problems,
+                             const AddressValidator::Callback& validated) = 0;
 };
 
 class OndemandValidatorWrapper : public ValidatorWrapper {
@@ -87,6 +101,21 @@ class OndemandValidatorWrapper : public ValidatorWrapper {
         validated);
   }
 
+  virtual void ValidateBatch(const std::vector<AddressData>& addresses,
+                             bool allow_postal,
+                             bool require_name,
+                             const FieldProblemMap* filter,
+                             std::vector<FieldProblemMap>* problems,
+                             const AddressValidator::Callback& validated) {
+    validator_.ValidateBatch(
+        addresses,
+        allow_postal,
+        require_name,
+        filter,
+        problems,
+        validated);
+  }
+
  private:
   OndemandValidatorWrapper()
       : supplier_(new TestdataSource(false), new NullStorage),
@@ -122,6 +151,28 @@ class PreloadValidatorWrapper : public ValidatorWrapper {
         validated);
   }
 
+  virtual void ValidateBatch(const std::vector<AddressData>& addresses,
+                             bool allow_postal,
+                             bool require_name,
+                             const FieldProblemMap* filter,
+                             std::vector<FieldProblemMap>* problems,
+                             const AddressValidator::Callback& validated) {
+    for (std::vector<AddressData>::const_iterator it = addresses.begin();
+         it != addresses.end(); ++it) {
+      const std::string& region_code = it->region_code;
+      if (!region_code.empty() && !supplier_.IsLoaded(region_code)) {
+        supplier_.LoadRules(region_code, *loaded_);
+      }
+    }
+    validator_.ValidateBatch(
+        addresses,
+        allow_postal,
+        require_name,
+        filter,
+        problems,
+        validated);
+  }
+
  private:
   PreloadValidatorWrapper()
       : supplier_(new TestdataSource(true), new NullStorage),
@@ -147,8 +198,13 @@ class AddressValidatorTest
         problems_(),
         expected_(),
         called_(false),
+        addresses_(),
+        batch_problems_(),
+        batch_called_(0),
         validator_wrapper_((*GetParam())()),
-        validated_(BuildCallback(this, &AddressValidatorTest::Validated)) {}
+        validated_(BuildCallback(this, &AddressValidatorTest::Validated)),
+        batch_validated_(
+            BuildCallback(this, &AddressValidatorTest::BatchValidated)) {}
 
   virtual ~AddressValidatorTest() {}
 
@@ -162,6 +218,31 @@ class AddressValidatorTest
         *validated_);
   }
 
+  void ValidateBatch() {
+    validator_wrapper_->ValidateBatch(
+        addresses_,
+        allow_postal_,
+        require_name_,
+        &filter_,
+        &batch_problems_,
+        *batch_validated_);
+  }
+
+  // Validates each address in |addresses_| separately and returns the
+  // problems found, to be compared with the result of ValidateBatch().
+  std::vector<FieldProblemMap> ValidateEach() {
+    std::vector<FieldProblemMap> result;
+    for (std::vector<AddressData>::const_iterator it = addresses_.begin();
+         it != addresses_.end(); ++it) {
+      address_ = *it;
+      called_ = false;
+      Validate();
+      EXPECT_TRUE(called_);
+      result.push_back(problems_);
+    }
+    return result;
+  }
+
   AddressData address_;
   bool allow_postal_;
   bool require_name_;
@@ -169,6 +250,9 @@ class AddressValidatorTest
   FieldProblemMap problems_;
   FieldProblemMap expected_;
   bool called_;
+  std::vector<AddressData> addresses_;
+  std::vector<FieldProblemMap> batch_problems_;
+  size_t batch_called_;
 
  private:
   void Validated(bool success,
@@ -180,8 +264,19 @@ class AddressValidatorTest
     called_ = true;
   }
 
+  void BatchValidated(bool success,
+                      const AddressData& address,
+                      const FieldProblemMap& problems) {
+    ASSERT_TRUE(success);
+    size_t index = &address - &addresses_[0];
+    ASSERT_LT(index, addresses_.size());
+    ASSERT_EQ(&batch_problems_[index], &problems);
+    ++batch_called_;
+  }
+
   const scoped_ptr<ValidatorWrapper> validator_wrapper_;
   const scoped_ptr<const AddressValidator::Callback> validated_;
+  const scoped_ptr<const AddressValidator::Callback> batch_validated_;
 
   DISALLOW_COPY_AND_ASSIGN(AddressValidatorTest);
 };
@@ -410,4 +505,233 @@ TEST_P(AddressValidatorTest, ValidAddressCA_fr) {
   EXPECT_EQ(expected_, problems_);
 }
 
+TEST_P(AddressValidatorTest, ValidateBatchEmpty) {
+  ASSERT_NO_FATAL_FAILURE(ValidateBatch());
+  EXPECT_EQ(0U, batch_called_);
+  EXPECT_TRUE(batch_problems_.empty());
+}
+
+TEST_P(AddressValidatorTest, ValidateBatchSameAsValidate) {
+  AddressData address;
+  address.region_code = "US";
+  address.administrative_area = "CA";  // California
+  address.locality = "Mountain View";
+  address.postal_code = "94043";
+  address.address_line.push_back("1600 Amphitheatre Parkway");
+  address.language_code = "en";
+  addresses_.push_back(address);
+
+  address.postal_code = "123";
+  addresses_.push_back(address);
+
+  address.locality = "Palo Alto";
+  addresses_.push_back(address);
+
+  address.administrative_area = "ZZ";
+  addresses_.push_back(address);
+
+  address = AddressData();
+  address.region_code = "CH";
+  address.postal_code = "123";
+  addresses_.push_back(address);
+
+  address = AddressData();
+  address.region_code = "MX";
+  address.locality = "Villahermosa";
+  address.administrative_area = "TAB";  // Tabasco
+  address.postal_code = "80000";
+  address.language_code = "es";
+  addresses_.push_back(address);
+
+  address = AddressData();
+  addresses_.push_back(address);
+
+  address.region_code = "QZ";
+  addresses_.push_back(address);
+
+  // Use a filter, to verify that it's applied to all addresses of the batch.
+  filter_.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+  filter_.insert(std::make_pair(POSTAL_CODE, MISMATCHING_VALUE));
+  filter_.insert(std::make_pair(ADMIN_AREA, UNKNOWN_VALUE));
+  filter_.insert(std::make_pair(COUNTRY, MISSING_REQUIRED_FIELD));
+  filter_.insert(std::make_pair(COUNTRY, UNKNOWN_VALUE));
+
+  ASSERT_NO_FATAL_FAILURE(ValidateBatch());
+  EXPECT_EQ(addresses_.size(), batch_called_);
+
+  const std::vector<FieldProblemMap>& expected = ValidateEach();
+  ASSERT_EQ(expected.size(), batch_problems_.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i], batch_problems_[i]) << "index " << i;
+  }
+
+  // Sanity check, so that this test doesn't pass by always returning nothing.
+  EXPECT_TRUE(batch_problems_[0].empty());
+  EXPECT_FALSE(batch_problems_[1].empty());
+  EXPECT_FALSE(batch_problems_[4].empty());
+  EXPECT_FALSE(batch_problems_[5].empty());
+}
+
+class AddressValidatorSyncTest : public testing::Test {
+ protected:
+  AddressValidatorSyncTest()
+      : supplier_(new TestdataSource(true), new NullStorage),
+        validator_(&supplier_),
+        options_(),
+        result_(),
+        problems_(),
+        called_(false),
+        loaded_(BuildCallback(this, &AddressValidatorSyncTest::Loaded)),
+        validated_(BuildCallback(this, &AddressValidatorSyncTest::Validated)) {}
+
+  void LoadRules(const std::string& region_code) {
+    supplier_.LoadRules(region_code, *loaded_);
+  }
+
+  // Validates |address| with the asynchronous API, with the same options as
+  // used for ValidateSync().
+  void Validate(const AddressData& address) {
+    FieldProblemMap filter;
+    if (options_.filter == &filter_) {
+      filter = filter_map_;
+    }
+    called_ = false;
+    validator_.Validate(address,
+                        options_.allow_postal,
+                        options_.require_name,
+                        &filter,
+                        &problems_,
+                        *validated_);
+    ASSERT_TRUE(called_);
+  }
+
+  // Same as above, but passes |options_| themselves.
+  void ValidateWithOptions(const AddressData& address) {
+    called_ = false;
+    validator_.Validate(address, options_, &problems_, *validated_);
+    ASSERT_TRUE(called_);
+  }
+
+  void SetFilter(const FieldProblemMap& filter) {
+    filter_map_ = filter;
+    filter_ = ProblemFilter(&filter_map_);
+    options_.filter = &filter_;
+  }
+
+  PreloadSupplier supplier_;
+  const AddressValidator validator_;
+  ValidationOptions options_;
+  ValidationResult result_;
+  FieldProblemMap problems_;
+  bool called_;
+
+ private:
+  void Loaded(bool success, const std::string&, int) { ASSERT_TRUE(success); }
+
+  void Validated(bool success, const AddressData&, const FieldProblemMap&) {
+    ASSERT_TRUE(success);
+    called_ = true;
+  }
+
+  FieldProblemMap filter_map_;
+  ProblemFilter filter_;
+  const scoped_ptr<const PreloadSupplier::Callback> loaded_;
+  const scoped_ptr<const AddressValidator::Callback> validated_;
+
+  DISALLOW_COPY_AND_ASSIGN(AddressValidatorSyncTest);
+};
+
+TEST_F(AddressValidatorSyncTest, RulesNotLoaded) {
+  AddressData address;
+  address.region_code = "US";
+  result_.Add(COUNTRY, UNKNOWN_VALUE);
+  EXPECT_FALSE(AddressValidator::ValidateSync(
+      supplier_, address, options_, &result_));
+  EXPECT_TRUE(result_.empty());
+}
+
+TEST_F(AddressValidatorSyncTest, SameAsValidate) {
+  LoadRules("US");
+  LoadRules("CH");
+
+  AddressData address;
+  address.region_code = "US";
+  address.administrative_area = "CA";  // California
+  address.locality = "Mountain View";
+  address.postal_code = "123";
+  address.address_line.push_back("P.O. Box 1");
+  address.language_code = "en";
+
+  EXPECT_TRUE(AddressValidator::ValidateSync(
+      supplier_, address, options_, &result_));
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_FALSE(problems_.empty());
+  EXPECT_EQ(ValidationResult(problems_), result_);
+
+  options_.allow_postal = true;
+  options_.require_name = true;
+  EXPECT_TRUE(AddressValidator::ValidateSync(
+      supplier_, address, options_, &result_));
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(ValidationResult(problems_), result_);
+
+  address = AddressData();
+  address.region_code = "CH";
+  address.sorting_code = "123";
+  EXPECT_TRUE(AddressValidator::ValidateSync(
+      supplier_, address, options_, &result_));
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_FALSE(problems_.empty());
+  EXPECT_EQ(ValidationResult(problems_), result_);
+}
+
+TEST_F(AddressValidatorSyncTest, Filter) {
+  LoadRules("US");
+
+  AddressData address;
+  address.region_code = "US";
+  address.postal_code = "123";
+
+  FieldProblemMap filter;
+  filter.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+  SetFilter(filter);
+
+  EXPECT_TRUE(AddressValidator::ValidateSync(
+      supplier_, address, options_, &result_));
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(ValidationResult(problems_), result_);
+  EXPECT_EQ(1U, result_.size());
+  EXPECT_TRUE(result_.Contains(POSTAL_CODE, INVALID_FORMAT));
+}
+
+TEST_F(AddressValidatorSyncTest, ValidateWithOptions) {
+  LoadRules("US");
+
+  AddressData address;
+  address.region_code = "US";
+  address.postal_code = "123";
+  address.address_line.push_back("P.O. Box 1");
+
+  FieldProblemMap filter;
+  filter.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+  filter.insert(std::make_pair(STREET_ADDRESS, USES_P_O_BOX));
+  SetFilter(filter);
+
+  // The same ProblemFilter is used for validating both with and without
+  // allowing postal addresses.
+  EXPECT_TRUE(AddressValidator::ValidateSync(
+      supplier_, address, options_, &result_));
+  ASSERT_NO_FATAL_FAILURE(ValidateWithOptions(address));
+  EXPECT_EQ(ValidationResult(problems_), result_);
+  EXPECT_EQ(2U, problems_.size());
+
+  options_.allow_postal = true;
+  EXPECT_TRUE(AddressValidator::ValidateSync(
+      supplier_, address, options_, &result_));
+  ASSERT_NO_FATAL_FAILURE(ValidateWithOptions(address));
+  EXPECT_EQ(ValidationResult(problems_), result_);
+  EXPECT_EQ(1U, problems_.size());
+  EXPECT_TRUE(result_.Contains(POSTAL_CODE, INVALID_FORMAT));
+}
+
 }  // namespace
@@ -0,0 +1,147 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/compressing_storage.h>
+
+#include <libaddressinput/callback.h>
+#include <libaddressinput/storage.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "fake_storage.h"
+
+namespace {
+
+using i18n::addressinput::BuildCallback;
+using i18n::addressinput::CompressingStorage;
+using i18n::addressinput::FakeStorage;
+using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::Storage;
+
+const char kKey[] = "key";
+
+// Tests for CompressingStorage object.
+class CompressingStorageTest : public testing::Test {
+ protected:
+  CompressingStorageTest()
+      : wrapped_storage_(new FakeStorage),
+        storage_(wrapped_storage_),
+        success_(false),
+        key_(),
+        data_(),
+        data_ready_(
+            BuildCallback(this, &CompressingStorageTest::OnDataReady)) {}
+
+  virtual ~CompressingStorageTest() {}
+
+  // Returns the data stored in the wrapped storage.
+  std::string GetWrappedData() {
+    wrapped_storage_->Get(kKey, *data_ready_);
+    return data_;
+  }
+
+  Storage* const wrapped_storage_;  // Owned by |storage_|.
+  CompressingStorage storage_;
+  bool success_;
+  std::string key_;
+  std::string data_;
+  const scoped_ptr<const Storage::Callback> data_ready_;
+
+ private:
+  void OnDataReady(bool success, const std::string& key, std::string* data) {
+    ASSERT_FALSE(success && data == NULL);
+    success_ = success;
+    key_ = key;
+    data_.clear();
+    if (data != NULL) {
+      data_ = *data;
+      delete data;
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(CompressingStorageTest);
+};
+
+TEST_F(CompressingStorageTest, GetWithoutPutReturnsEmptyData) {
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_FALSE(success_);
+  EXPECT_EQ(kKey, key_);
+  EXPECT_TRUE(data_.empty());
+}
+
+TEST_F(CompressingStorageTest, GetReturnsWhatWasPut) {
+  storage_.Put(kKey, new std::string("value"));
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(kKey, key_);
+  EXPECT_EQ("value", data_);
+}
+
+TEST_F(CompressingStorageTest, EmptyData) {
+  storage_.Put(kKey, new std::string);
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_TRUE(data_.empty());
+}
+
+TEST_F(CompressingStorageTest, DataIsCompressed) {
+  std::string data;
+  for (int i = 0; i < 100; ++i) {
+    data += "{\"sub_keys\":\"a~b~c\",\"sub_names\":\"A~B~C\",\"zipex\":\"1\"},";
+  }
+  storage_.Put(kKey, new std::string(data));
+
+  EXPECT_LT(GetWrappedData().size() * 5, data.size());
+
+  storage_.Get(kKey, *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(data, data_);
+}
+
+TEST_F(CompressingStorageTest, UncompressedDataIsReturnedAsItIs) {
+  wrapped_storage_->Put(kKey, new std::string("{\"id\":\"data/XA\"}"));
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("{\"id\":\"data/XA\"}", data_);
+}
+
+TEST_F(CompressingStorageTest, CorruptedData) {
+  storage_.Put(kKey, new std::string("value value value value"));
+  std::string corrupted = GetWrappedData();
+  corrupted.resize(corrupted.size() - 1);
+  wrapped_storage_->Put(kKey, new std::string(corrupted));
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_FALSE(success_);
+  EXPECT_EQ(kKey, key_);
+  EXPECT_TRUE(data_.empty());
+}
+
+TEST_F(CompressingStorageTest, ImplausibleSize) {
+  wrapped_storage_->Put(kKey, new std::string("\x01\xff\xff\xff\xff\x00", 6));
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_FALSE(success_);
+}
+
+}  // namespace
@@ -0,0 +1,210 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/file_storage.h>
+
+#include <libaddressinput/callback.h>
+#include <libaddressinput/storage.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using i18n::addressinput::BuildCallback;
+using i18n::addressinput::FileStorage;
+using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::Storage;
+
+// Returns the names of the files in |directory|.
+std::vector<std::string> ListFiles(const std::string& directory) {
+  std::vector<std::string> names;
+  DIR* dir = opendir(directory.c_str());
+  if (dir != NULL) {
+    while (struct dirent* entry = readdir(dir)) {
+      std::string name(entry->d_name);
+      if (name != "." && name != "..") {
+        names.push_back(name);
+      }
+    }
+    closedir(dir);
+  }
+  return names;
+}
+
+// Tests for FileStorage object.
+class FileStorageTest : public testing::Test {
+ protected:
+  FileStorageTest()
+      : directory_(MakeTempDirectory()),
+        storage_(directory_),
+        success_(false),
+        key_(),
+        data_(),
+        data_ready_(BuildCallback(this, &FileStorageTest::OnDataReady)) {}
+
+  virtual ~FileStorageTest() {
+    std::vector<std::string> names = ListFiles(directory_);
+    for (std::vector<std::string>::const_iterator it = names.begin();
+         it != names.end(); ++it) {
+      unlink((directory_ + '/' + *it).c_str());
+    }
+    rmdir(directory_.c_str());
+  }
+
+  const std::string directory_;
+  FileStorage storage_;
+  bool success_;
+  std::string key_;
+  std::string data_;
+  const scoped_ptr<const Storage::Callback> data_ready_;
+
+ private:
+  static std::string MakeTempDirectory() {
+    char path[] = "/tmp/file_storage_test.XXXXXX";
+    EXPECT_TRUE(mkdtemp(path) != NULL);
+    return path;
+  }
+
+  void OnDataReady(bool success, const std::string& key, std::string* data) {
+    ASSERT_FALSE(success && data == NULL);
+    success_ = success;
+    key_ = key;
+    if (data != NULL) {
+      data_ = *data;
+      delete data;
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(FileStorageTest);
+};
+
+TEST_F(FileStorageTest, GetWithoutPutReturnsEmptyData) {
+  storage_.Get("key", *data_ready_);
+
+  EXPECT_FALSE(success_);
+  EXPECT_EQ("key", key_);
+  EXPECT_TRUE(data_.empty());
+}
+
+TEST_F(FileStorageTest, GetReturnsWhatWasPut) {
+  storage_.Put("key", new std::string("value"));
+  storage_.Get("key", *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("key", key_);
+  EXPECT_EQ("value", data_);
+}
+
+TEST_F(FileStorageTest, SecondPutOverwritesData) {
+  storage_.Put("key", new std::string("bad-value"));
+  storage_.Put("key", new std::string("good-value"));
+  storage_.Get("key", *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("key", key_);
+  EXPECT_EQ("good-value", data_);
+}
+
+TEST_F(FileStorageTest, EmptyData) {
+  storage_.Put("key", new std::string);
+  storage_.Get("key", *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("key", key_);
+  EXPECT_TRUE(data_.empty());
+}
+
+TEST_F(FileStorageTest, BinaryData) {
+  const std::string kData("\0\n\xff", 3);
+  storage_.Put("key", new std::string(kData));
+  storage_.Get("key", *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(kData, data_);
+}
+
+TEST_F(FileStorageTest, KeysAreEscaped) {
+  storage_.Put("data/CA/AB--fr", new std::string("a"));
+  storage_.Put("data/CA/AB", new std::string("b"));
+  storage_.Put("../data", new std::string("c"));
+
+  std::vector<std::string> names = ListFiles(directory_);
+  EXPECT_EQ(3U, names.size());
+
+  storage_.Get("data/CA/AB--fr", *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("a", data_);
+  storage_.Get("../data", *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("c", data_);
+}
+
+TEST_F(FileStorageTest, LongKeys) {
+  const std::string kFirstKey(1000, 'a');
+  const std::string kSecondKey(1000, 'b');
+  storage_.Put(kFirstKey, new std::string("a"));
+  storage_.Put(kSecondKey, new std::string("b"));
+
+  storage_.Get(kFirstKey, *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(kFirstKey, key_);
+  EXPECT_EQ("a", data_);
+  storage_.Get(kSecondKey, *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("b", data_);
+}
+
+TEST_F(FileStorageTest, NoTemporaryFilesAreLeft) {
+  storage_.Put("key", new std::string("value"));
+  storage_.Put("key", new std::string("value"));
+
+  std::vector<std::string> names = ListFiles(directory_);
+  ASSERT_EQ(1U, names.size());
+  EXPECT_EQ("key", names[0]);
+}
+
+TEST_F(FileStorageTest, DirectoryIsShared) {
+  FileStorage other_storage(directory_);
+  other_storage.Put("key", new std::string("value"));
+  storage_.Get("key", *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("value", data_);
+}
+
+TEST_F(FileStorageTest, DirectoryIsCreated) {
+  const std::string& subdirectory = directory_ + "/cache";
+  {
+    FileStorage storage(subdirectory);
+    storage.Put("key", new std::string("value"));
+    storage.Get("key", *data_ready_);
+    unlink((subdirectory + "/key").c_str());
+  }
+  rmdir(subdirectory.c_str());
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("value", data_);
+}
+
+}  // namespace
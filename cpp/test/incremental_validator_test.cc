@@ -0,0 +1,215 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/incremental_validator.h>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/callback.h>
+#include <libaddressinput/null_storage.h>
+#include <libaddressinput/preload_supplier.h>
+#include <libaddressinput/problem_filter.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+#include <libaddressinput/validation_result.h>
+
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "testdata_source.h"
+
+namespace {
+
+using i18n::addressinput::AddressData;
+using i18n::addressinput::AddressField;
+using i18n::addressinput::AddressValidator;
+using i18n::addressinput::BuildCallback;
+using i18n::addressinput::FieldProblemMap;
+using i18n::addressinput::IncrementalValidator;
+using i18n::addressinput::NullStorage;
+using i18n::addressinput::PreloadSupplier;
+using i18n::addressinput::ProblemFilter;
+using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::TestdataSource;
+using i18n::addressinput::ValidationOptions;
+using i18n::addressinput::ValidationResult;
+
+using i18n::addressinput::COUNTRY;
+using i18n::addressinput::ADMIN_AREA;
+using i18n::addressinput::LOCALITY;
+using i18n::addressinput::DEPENDENT_LOCALITY;
+using i18n::addressinput::SORTING_CODE;
+using i18n::addressinput::POSTAL_CODE;
+using i18n::addressinput::STREET_ADDRESS;
+using i18n::addressinput::RECIPIENT;
+
+using i18n::addressinput::MISSING_REQUIRED_FIELD;
+using i18n::addressinput::UNKNOWN_VALUE;
+using i18n::addressinput::INVALID_FORMAT;
+using i18n::addressinput::MISMATCHING_VALUE;
+using i18n::addressinput::USES_P_O_BOX;
+
+class IncrementalValidatorTest : public testing::Test {
+ protected:
+  IncrementalValidatorTest()
+      : supplier_(new TestdataSource(true), new NullStorage),
+        options_(),
+        address_(),
+        validator_(),
+        loaded_(BuildCallback(this, &IncrementalValidatorTest::Loaded)) {
+    options_.require_name = true;
+    LoadRules("US");
+    LoadRules("CN");
+    LoadRules("MX");
+    validator_.reset(new IncrementalValidator(&supplier_, options_));
+  }
+
+  void LoadRules(const std::string& region_code) {
+    supplier_.LoadRules(region_code, *loaded_);
+  }
+
+  // Updates |validator_| after |field| of |address_| has been changed, and
+  // verifies that the result is the same as when validating all of |address_|.
+  void Update(AddressField field) {
+    ValidationResult expected;
+    bool success = AddressValidator::ValidateSync(
+        supplier_, address_, options_, &expected);
+    EXPECT_EQ(success, validator_->Update(address_, field));
+    EXPECT_EQ(expected, validator_->result());
+  }
+
+  PreloadSupplier supplier_;
+  ValidationOptions options_;
+  AddressData address_;
+  scoped_ptr<IncrementalValidator> validator_;
+
+ private:
+  void Loaded(bool success, const std::string&, int) { ASSERT_TRUE(success); }
+
+  const scoped_ptr<const PreloadSupplier::Callback> loaded_;
+
+  DISALLOW_COPY_AND_ASSIGN(IncrementalValidatorTest);
+};
+
+TEST_F(IncrementalValidatorTest, RulesNotLoaded) {
+  address_.region_code = "CH";
+  EXPECT_FALSE(validator_->Validate(address_));
+  EXPECT_TRUE(validator_->result().empty());
+
+  address_.postal_code = "1234";
+  EXPECT_FALSE(validator_->Update(address_, POSTAL_CODE));
+  EXPECT_TRUE(validator_->result().empty());
+}
+
+TEST_F(IncrementalValidatorTest, EmptyCountry) {
+  EXPECT_TRUE(validator_->Validate(address_));
+  EXPECT_TRUE(validator_->result().Contains(COUNTRY, MISSING_REQUIRED_FIELD));
+
+  address_.postal_code = "1";
+  ASSERT_NO_FATAL_FAILURE(Update(POSTAL_CODE));
+  address_.region_code = "US";
+  ASSERT_NO_FATAL_FAILURE(Update(COUNTRY));
+}
+
+TEST_F(IncrementalValidatorTest, TypeAddressUS) {
+  address_.region_code = "US";
+  address_.language_code = "en";
+  EXPECT_TRUE(validator_->Validate(address_));
+
+  address_.recipient = "Jane Doe";
+  ASSERT_NO_FATAL_FAILURE(Update(RECIPIENT));
+  address_.address_line.push_back("P.O. Box 1");
+  ASSERT_NO_FATAL_FAILURE(Update(STREET_ADDRESS));
+  EXPECT_TRUE(validator_->result().Contains(STREET_ADDRESS, USES_P_O_BOX));
+  address_.address_line[0] = "1600 Amphitheatre Parkway";
+  ASSERT_NO_FATAL_FAILURE(Update(STREET_ADDRESS));
+
+  static const char* const kPostalCode[] = {
+    "9", "94", "940", "9404", "94043"
+  };
+  for (size_t i = 0; i < arraysize(kPostalCode); ++i) {
+    address_.postal_code = kPostalCode[i];
+    ASSERT_NO_FATAL_FAILURE(Update(POSTAL_CODE));
+  }
+
+  address_.administrative_area = "C";
+  ASSERT_NO_FATAL_FAILURE(Update(ADMIN_AREA));
+  EXPECT_TRUE(validator_->result().Contains(ADMIN_AREA, UNKNOWN_VALUE));
+  address_.administrative_area = "CA";
+  ASSERT_NO_FATAL_FAILURE(Update(ADMIN_AREA));
+  address_.administrative_area = "TX";
+  ASSERT_NO_FATAL_FAILURE(Update(ADMIN_AREA));
+  EXPECT_TRUE(validator_->result().Contains(POSTAL_CODE, MISMATCHING_VALUE));
+  address_.administrative_area = "CA";
+  ASSERT_NO_FATAL_FAILURE(Update(ADMIN_AREA));
+
+  address_.locality = "Mountain View";
+  ASSERT_NO_FATAL_FAILURE(Update(LOCALITY));
+  address_.dependent_locality = "X";
+  ASSERT_NO_FATAL_FAILURE(Update(DEPENDENT_LOCALITY));
+  address_.sorting_code = "X";
+  ASSERT_NO_FATAL_FAILURE(Update(SORTING_CODE));
+
+  address_.region_code = "MX";
+  ASSERT_NO_FATAL_FAILURE(Update(COUNTRY));
+  address_.region_code = "ZZ";
+  ASSERT_NO_FATAL_FAILURE(Update(COUNTRY));
+  EXPECT_TRUE(validator_->result().Contains(COUNTRY, UNKNOWN_VALUE));
+  address_.postal_code.clear();
+  ASSERT_NO_FATAL_FAILURE(Update(POSTAL_CODE));
+}
+
+TEST_F(IncrementalValidatorTest, TypeAddressCN) {
+  address_.region_code = "CN";
+  EXPECT_TRUE(validator_->Validate(address_));
+
+  // 广东省
+  address_.administrative_area = "\xE5\xB9\xBF\xE4\xB8\x9C\xE7\x9C\x81";
+  ASSERT_NO_FATAL_FAILURE(Update(ADMIN_AREA));
+  // 深圳市
+  address_.locality = "\xE6\xB7\xB1\xE5\x9C\xB3\xE5\xB8\x82";
+  ASSERT_NO_FATAL_FAILURE(Update(LOCALITY));
+  // 福田区
+  address_.dependent_locality = "\xE7\xA6\x8F\xE7\x94\xB0\xE5\x8C\xBA";
+  ASSERT_NO_FATAL_FAILURE(Update(DEPENDENT_LOCALITY));
+  address_.dependent_locality = "X";
+  ASSERT_NO_FATAL_FAILURE(Update(DEPENDENT_LOCALITY));
+  EXPECT_TRUE(
+      validator_->result().Contains(DEPENDENT_LOCALITY, UNKNOWN_VALUE));
+  address_.postal_code = "123";
+  ASSERT_NO_FATAL_FAILURE(Update(POSTAL_CODE));
+  EXPECT_TRUE(validator_->result().Contains(POSTAL_CODE, INVALID_FORMAT));
+}
+
+TEST_F(IncrementalValidatorTest, Filter) {
+  FieldProblemMap filter;
+  filter.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+  ProblemFilter problem_filter(&filter);
+  options_.filter = &problem_filter;
+  validator_.reset(new IncrementalValidator(&supplier_, options_));
+
+  address_.region_code = "US";
+  EXPECT_TRUE(validator_->Validate(address_));
+  EXPECT_TRUE(validator_->result().empty());
+
+  address_.postal_code = "123";
+  ASSERT_NO_FATAL_FAILURE(Update(POSTAL_CODE));
+  EXPECT_EQ(1U, validator_->result().size());
+}
+
+}  // namespace
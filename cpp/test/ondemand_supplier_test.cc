@@ -0,0 +1,522 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/ondemand_supplier.h>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/callback.h>
+#include <libaddressinput/null_storage.h>
+#include <libaddressinput/source.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lookup_key.h"
+#include "rule.h"
+#include "testdata_source.h"
+
+namespace {
+
+using i18n::addressinput::AddressData;
+using i18n::addressinput::BuildCallback;
+using i18n::addressinput::LookupKey;
+using i18n::addressinput::NullStorage;
+using i18n::addressinput::OndemandSupplier;
+using i18n::addressinput::Rule;
+using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::Source;
+using i18n::addressinput::Supplier;
+using i18n::addressinput::TestdataSource;
+
+// Holds on to all requests, until told to answer them.
+class DelayedSource : public Source {
+ public:
+  DelayedSource() : source_(false), requests_() {}
+  virtual ~DelayedSource() {}
+
+  // Source implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    requests_.insert(std::make_pair(key, &data_ready));
+  }
+
+  // Answers the request for |key|. Returns false if there was none.
+  bool Answer(const std::string& key) {
+    std::map<std::string, const Callback*>::iterator it = requests_.find(key);
+    if (it == requests_.end()) {
+      return false;
+    }
+    const Callback* data_ready = it->second;
+    requests_.erase(it);
+    source_.Get(key, *data_ready);
+    return true;
+  }
+
+ private:
+  TestdataSource source_;
+  mutable std::map<std::string, const Callback*> requests_;
+
+  DISALLOW_COPY_AND_ASSIGN(DelayedSource);
+};
+
+// Counts the requests made.
+class CountingSource : public Source {
+ public:
+  CountingSource() : source_(false), count_(0) {}
+  virtual ~CountingSource() {}
+
+  // Source implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    ++count_;
+    source_.Get(key, data_ready);
+  }
+
+  int count() const { return count_; }
+
+ private:
+  TestdataSource source_;
+  mutable int count_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingSource);
+};
+
+// Counts the calls to GetMulti().
+class BatchSource : public Source {
+ public:
+  BatchSource() : source_(false), calls_(0) {}
+  virtual ~BatchSource() {}
+
+  // Source implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    ADD_FAILURE() << "Get() called for " << key;
+    source_.Get(key, data_ready);
+  }
+
+  // Source implementation.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const {
+    ++calls_;
+    for (std::vector<std::string>::const_iterator it = keys.begin();
+         it != keys.end(); ++it) {
+      source_.Get(*it, data_ready);
+    }
+  }
+
+  int calls() const { return calls_; }
+
+ private:
+  TestdataSource source_;
+  mutable int calls_;
+
+  DISALLOW_COPY_AND_ASSIGN(BatchSource);
+};
+
+// Answers the request for data/US/AL with the rule of data/US/AK, as the
+// data server may do for an alias.
+class AliasSource : public Source {
+ public:
+  AliasSource() : source_(false) {}
+  virtual ~AliasSource() {}
+
+  // Source implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    if (key == "data/US/AL") {
+      data_ready(true, key, new std::string(
+          "{\"id\":\"data/US/AK\",\"key\":\"AK\",\"name\":\"Alaska\"}"));
+    } else {
+      source_.Get(key, data_ready);
+    }
+  }
+
+ private:
+  TestdataSource source_;
+
+  DISALLOW_COPY_AND_ASSIGN(AliasSource);
+};
+
+// Records the IDs of the rules supplied, while these are still valid.
+class SupplyRecorder {
+ public:
+  SupplyRecorder()
+      : lookup_key_(),
+        called_(false),
+        ids_(),
+        supplied_(BuildCallback(this, &SupplyRecorder::Supplied)) {}
+
+  ~SupplyRecorder() {}
+
+  void Supply(Supplier* supplier,
+              const std::string& region_code,
+              const std::string& administrative_area) {
+    Supply(supplier, region_code, administrative_area, std::string());
+  }
+
+  void Supply(Supplier* supplier,
+              const std::string& region_code,
+              const std::string& administrative_area,
+              const std::string& language_code) {
+    AddressData address;
+    address.region_code = region_code;
+    address.administrative_area = administrative_area;
+    address.language_code = language_code;
+    lookup_key_.FromAddress(address);
+    supplier->Supply(lookup_key_, *supplied_);
+  }
+
+  bool called() const { return called_; }
+  const std::string& id(size_t depth) const { return ids_[depth]; }
+
+ private:
+  void Supplied(bool success,
+                const LookupKey& lookup_key,
+                const Supplier::RuleHierarchy& hierarchy) {
+    ASSERT_TRUE(success);
+    ASSERT_EQ(&lookup_key_, &lookup_key);
+    for (size_t depth = 0; depth < arraysize(ids_); ++depth) {
+      if (hierarchy.rule[depth] != NULL) {
+        ids_[depth] = hierarchy.rule[depth]->GetId();
+      }
+    }
+    called_ = true;
+  }
+
+  LookupKey lookup_key_;
+  bool called_;
+  std::string ids_[arraysize(LookupKey::kHierarchy)];
+  const scoped_ptr<const Supplier::Callback> supplied_;
+
+  DISALLOW_COPY_AND_ASSIGN(SupplyRecorder);
+};
+
+TEST(OndemandSupplierTest, UnlimitedCacheIsNeverPruned) {
+  OndemandSupplier supplier(new TestdataSource(false), new NullStorage);
+  SupplyRecorder recorder;
+
+  recorder.Supply(&supplier, "US", "CA");
+
+  ASSERT_TRUE(recorder.called());
+  EXPECT_EQ("data/US", recorder.id(0));
+  EXPECT_EQ("data/US/CA", recorder.id(1));
+  EXPECT_EQ(2U, supplier.cache_size());
+  EXPECT_LT(0U, supplier.cache_bytes());
+  EXPECT_EQ(0U, supplier.evictions());
+}
+
+TEST(OndemandSupplierTest, EvictsWhenOverBudget) {
+  OndemandSupplier supplier(new TestdataSource(false), new NullStorage, 1);
+  SupplyRecorder recorder;
+
+  recorder.Supply(&supplier, "US", "CA");
+
+  ASSERT_TRUE(recorder.called());
+  EXPECT_EQ("data/US", recorder.id(0));
+  EXPECT_EQ("data/US/CA", recorder.id(1));
+  EXPECT_EQ(0U, supplier.cache_size());
+  EXPECT_EQ(0U, supplier.cache_bytes());
+  EXPECT_EQ(2U, supplier.evictions());
+}
+
+TEST(OndemandSupplierTest, EvictsLeastRecentlyUsedFirst) {
+  OndemandSupplier supplier(new TestdataSource(false), new NullStorage);
+  SupplyRecorder ch;
+  ch.Supply(&supplier, "CH", std::string());
+  size_t ch_bytes = supplier.cache_bytes();
+
+  // Find the size of both rules, then make a supplier that fits only one.
+  SupplyRecorder se;
+  se.Supply(&supplier, "SE", std::string());
+  size_t se_bytes = supplier.cache_bytes() - ch_bytes;
+
+  OndemandSupplier bounded(
+      new TestdataSource(false), new NullStorage, ch_bytes + se_bytes - 1);
+  SupplyRecorder first;
+  first.Supply(&bounded, "CH", std::string());
+  SupplyRecorder second;
+  second.Supply(&bounded, "SE", std::string());
+
+  ASSERT_TRUE(second.called());
+  EXPECT_EQ(1U, bounded.cache_size());
+  EXPECT_EQ(se_bytes, bounded.cache_bytes());
+  EXPECT_EQ(1U, bounded.evictions());
+}
+
+TEST(OndemandSupplierTest, RulesInUseAreNotEvicted) {
+  DelayedSource* source = new DelayedSource;
+  OndemandSupplier supplier(source, new NullStorage, 1);
+
+  SupplyRecorder first;
+  first.Supply(&supplier, "US", "CA");
+  ASSERT_TRUE(source->Answer("data/US"));
+  ASSERT_FALSE(first.called());
+
+  // Uses only the already cached rule data/US, which remains in use by the
+  // first request.
+  SupplyRecorder second;
+  second.Supply(&supplier, "US", std::string());
+  ASSERT_TRUE(second.called());
+  EXPECT_EQ("data/US", second.id(0));
+  EXPECT_EQ(1U, supplier.cache_size());
+  EXPECT_EQ(0U, supplier.evictions());
+
+  ASSERT_TRUE(source->Answer("data/US/CA"));
+  ASSERT_TRUE(first.called());
+  EXPECT_EQ("data/US", first.id(0));
+  EXPECT_EQ("data/US/CA", first.id(1));
+  EXPECT_EQ(0U, supplier.cache_size());
+  EXPECT_EQ(2U, supplier.evictions());
+}
+
+TEST(OndemandSupplierTest, HierarchyIsRetrievedInOneRequest) {
+  BatchSource* source = new BatchSource;
+  OndemandSupplier supplier(source, new NullStorage);
+  SupplyRecorder recorder;
+
+  recorder.Supply(&supplier, "US", "CA");
+
+  ASSERT_TRUE(recorder.called());
+  EXPECT_EQ("data/US", recorder.id(0));
+  EXPECT_EQ("data/US/CA", recorder.id(1));
+  EXPECT_EQ(1, source->calls());
+}
+
+TEST(OndemandSupplierTest, MissingKeyIsNotRetrievedAgain) {
+  CountingSource* source = new CountingSource;
+  OndemandSupplier supplier(source, new NullStorage);
+
+  SupplyRecorder first;
+  first.Supply(&supplier, "US", "Nowhere");
+  ASSERT_TRUE(first.called());
+  EXPECT_EQ("data/US", first.id(0));
+  EXPECT_TRUE(first.id(1).empty());
+  EXPECT_EQ(2, source->count());
+  EXPECT_EQ(1U, supplier.negative_cache_size());
+
+  SupplyRecorder second;
+  second.Supply(&supplier, "US", "Nowhere");
+  ASSERT_TRUE(second.called());
+  EXPECT_EQ("data/US", second.id(0));
+  EXPECT_TRUE(second.id(1).empty());
+  EXPECT_EQ(2, source->count());
+  EXPECT_EQ(1U, supplier.negative_cache_hits());
+}
+
+TEST(OndemandSupplierTest, MissingKeyIsRetrievedAgainWithoutTtl) {
+  CountingSource* source = new CountingSource;
+  OndemandSupplier supplier(source, new NullStorage);
+  supplier.set_negative_cache_ttl(0);
+
+  SupplyRecorder first;
+  first.Supply(&supplier, "US", "Nowhere");
+  ASSERT_TRUE(first.called());
+  EXPECT_EQ(2, source->count());
+  EXPECT_EQ(0U, supplier.negative_cache_size());
+
+  SupplyRecorder second;
+  second.Supply(&supplier, "US", "Nowhere");
+  ASSERT_TRUE(second.called());
+  EXPECT_EQ(3, source->count());
+  EXPECT_EQ(0U, supplier.negative_cache_hits());
+}
+
+TEST(OndemandSupplierTest, NothingIsPrefetchedByDefault) {
+  CountingSource* source = new CountingSource;
+  OndemandSupplier supplier(source, new NullStorage);
+  SupplyRecorder recorder;
+
+  recorder.Supply(&supplier, "US", std::string());
+
+  ASSERT_TRUE(recorder.called());
+  EXPECT_EQ(1, source->count());
+  EXPECT_EQ(1U, supplier.cache_size());
+  EXPECT_EQ(0U, supplier.prefetched());
+}
+
+TEST(OndemandSupplierTest, SubregionsArePrefetched) {
+  CountingSource* source = new CountingSource;
+  OndemandSupplier supplier(source, new NullStorage);
+  OndemandSupplier::PrefetchOptions options;
+  options.max_depth = 1;
+  options.max_fan_out = 3;
+  options.max_rules = 10;
+  supplier.set_prefetch_options(options);
+
+  SupplyRecorder first;
+  first.Supply(&supplier, "US", std::string());
+  ASSERT_TRUE(first.called());
+  EXPECT_EQ("data/US", first.id(0));
+  // The first three of the sub_keys of data/US are AL, AK and AS.
+  EXPECT_EQ(3U, supplier.prefetched());
+  EXPECT_EQ(4U, supplier.cache_size());
+  int count = source->count();
+
+  SupplyRecorder second;
+  second.Supply(&supplier, "US", "AK");
+  ASSERT_TRUE(second.called());
+  EXPECT_EQ("data/US/AK", second.id(1));
+  EXPECT_EQ(count, source->count());
+
+  // There are no rules below data/US/AK to prefetch.
+  EXPECT_EQ(3U, supplier.prefetched());
+}
+
+TEST(OndemandSupplierTest, SubregionsArePrefetchedInLanguage) {
+  CountingSource* source = new CountingSource;
+  OndemandSupplier supplier(source, new NullStorage);
+  OndemandSupplier::PrefetchOptions options;
+  options.max_depth = 1;
+  options.max_fan_out = 20;
+  options.max_rules = 20;
+  supplier.set_prefetch_options(options);
+
+  SupplyRecorder first;
+  first.Supply(&supplier, "CA", std::string(), "fr");
+  ASSERT_TRUE(first.called());
+  EXPECT_EQ("data/CA--fr", first.id(0));
+  // All 13 provinces and territories exist in French, as "data/CA/QC--fr".
+  EXPECT_EQ(13U, supplier.prefetched());
+  EXPECT_EQ(14U, supplier.cache_size());
+  EXPECT_EQ(0U, supplier.negative_cache_size());
+  int count = source->count();
+
+  SupplyRecorder second;
+  second.Supply(&supplier, "CA", "QC", "fr");
+  ASSERT_TRUE(second.called());
+  EXPECT_EQ("data/CA/QC--fr", second.id(1));
+  EXPECT_EQ(count, source->count());
+}
+
+TEST(OndemandSupplierTest, PrefetchIsLimitedByDepthAndBudget) {
+  OndemandSupplier supplier(new TestdataSource(false), new NullStorage);
+  OndemandSupplier::PrefetchOptions options;
+  options.max_depth = 2;
+  options.max_fan_out = 2;
+  options.max_rules = 5;
+  supplier.set_prefetch_options(options);
+
+  SupplyRecorder recorder;
+  recorder.Supply(&supplier, "CN", std::string());
+  ASSERT_TRUE(recorder.called());
+
+  // Two provinces, then three of their four cities.
+  EXPECT_EQ(5U, supplier.prefetched());
+  EXPECT_EQ(6U, supplier.cache_size());
+}
+
+TEST(OndemandSupplierTest, PrefetchedRulesAreEvictedFirst) {
+  OndemandSupplier supplier(new TestdataSource(false), new NullStorage);
+  SupplyRecorder us;
+  us.Supply(&supplier, "US", std::string());
+  size_t us_bytes = supplier.cache_bytes();
+
+  // A budget that fits data/US and little else.
+  OndemandSupplier bounded(
+      new TestdataSource(false), new NullStorage, us_bytes + 1);
+  OndemandSupplier::PrefetchOptions options;
+  options.max_depth = 1;
+  options.max_fan_out = 3;
+  options.max_rules = 3;
+  bounded.set_prefetch_options(options);
+
+  SupplyRecorder recorder;
+  recorder.Supply(&bounded, "US", std::string());
+  ASSERT_TRUE(recorder.called());
+  EXPECT_EQ(3U, bounded.prefetched());
+  EXPECT_EQ(1U, bounded.cache_size());
+  EXPECT_EQ(us_bytes, bounded.cache_bytes());
+  EXPECT_EQ(3U, bounded.evictions());
+}
+
+TEST(OndemandSupplierTest, PrefetchesInFlightAreCounted) {
+  DelayedSource* source = new DelayedSource;
+  OndemandSupplier supplier(source, new NullStorage);
+  OndemandSupplier::PrefetchOptions options;
+  options.max_depth = 1;
+  options.max_fan_out = 2;
+  options.max_rules = 2;
+  supplier.set_prefetch_options(options);
+
+  SupplyRecorder recorder;
+  recorder.Supply(&supplier, "US", std::string());
+  ASSERT_TRUE(source->Answer("data/US"));
+  ASSERT_TRUE(recorder.called());
+  EXPECT_EQ(1U, supplier.prefetches_in_flight());
+
+  ASSERT_TRUE(source->Answer("data/US/AL"));
+  EXPECT_EQ(1U, supplier.prefetches_in_flight());
+  ASSERT_TRUE(source->Answer("data/US/AK"));
+  EXPECT_EQ(0U, supplier.prefetches_in_flight());
+  EXPECT_EQ(3U, supplier.cache_size());
+}
+
+TEST(OndemandSupplierTest, RulesInUseByPrefetchAreNotEvicted) {
+  DelayedSource* source = new DelayedSource;
+  OndemandSupplier supplier(source, new NullStorage, 1);
+  OndemandSupplier::PrefetchOptions options;
+  options.max_depth = 1;
+  options.max_fan_out = 2;
+  options.max_rules = 2;
+  supplier.set_prefetch_options(options);
+
+  SupplyRecorder us;
+  us.Supply(&supplier, "US", std::string());
+  ASSERT_TRUE(source->Answer("data/US"));
+  ASSERT_TRUE(us.called());
+  EXPECT_EQ(1U, supplier.prefetches_in_flight());
+
+  // Waits on the same retrieval of data/US/AL as the prefetch, which then
+  // still waits for data/US/AK.
+  SupplyRecorder al;
+  al.Supply(&supplier, "US", "AL");
+  ASSERT_TRUE(source->Answer("data/US/AL"));
+  ASSERT_TRUE(source->Answer("data/US"));
+  ASSERT_TRUE(al.called());
+  EXPECT_EQ("data/US/AL", al.id(1));
+  EXPECT_EQ(1U, supplier.prefetches_in_flight());
+  EXPECT_EQ(1U, supplier.cache_size());
+
+  ASSERT_TRUE(source->Answer("data/US/AK"));
+  EXPECT_EQ(0U, supplier.prefetches_in_flight());
+  EXPECT_EQ(0U, supplier.cache_size());
+}
+
+TEST(OndemandSupplierTest, PrefetchedAliasIsCounted) {
+  OndemandSupplier supplier(new TestdataSource(false), new NullStorage);
+  SupplyRecorder us;
+  us.Supply(&supplier, "US", std::string());
+  size_t us_bytes = supplier.cache_bytes();
+
+  OndemandSupplier aliased(new AliasSource, new NullStorage);
+  OndemandSupplier::PrefetchOptions options;
+  options.max_depth = 1;
+  options.max_fan_out = 1;
+  options.max_rules = 1;
+  aliased.set_prefetch_options(options);
+
+  SupplyRecorder recorder;
+  recorder.Supply(&aliased, "US", std::string());
+  ASSERT_TRUE(recorder.called());
+  EXPECT_EQ(1U, aliased.prefetched());
+  // The rule for data/US/AL has the ID data/US/AK, and still counts towards
+  // the cache budget.
+  EXPECT_EQ(2U, aliased.cache_size());
+  EXPECT_LT(us_bytes, aliased.cache_bytes());
+}
+
+}  // namespace
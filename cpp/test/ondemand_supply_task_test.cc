@@ -22,6 +22,7 @@
 
 #include <cstddef>
 #include <cstring>
+#include <ctime>
 #include <map>
 #include <string>
 #include <utility>
@@ -54,9 +55,11 @@ class OndemandSupplyTaskTest : public testing::Test {
         called_(false),
         source_(new MockSource),
         rule_cache_(),
+        missing_(),
         retriever_(new Retriever(source_, new NullStorage)),
         supplied_(BuildCallback(this, &OndemandSupplyTaskTest::Supplied)),
-        task_(new OndemandSupplyTask(lookup_key_, &rule_cache_, *supplied_)) {}
+        task_(new OndemandSupplyTask(
+            lookup_key_, &rule_cache_, &missing_, *supplied_)) {}
 
   virtual ~OndemandSupplyTaskTest() {
     for (std::map<std::string, const Rule*>::const_iterator
@@ -74,6 +77,8 @@ class OndemandSupplyTaskTest : public testing::Test {
   const Rule* rule_[arraysize(LookupKey::kHierarchy)];
   bool called_;
   MockSource* const source_;
+  std::map<std::string, const Rule*> rule_cache_;
+  std::map<std::string, time_t> missing_;
 
  private:
   void Supplied(bool success,
@@ -86,7 +91,6 @@ class OndemandSupplyTaskTest : public testing::Test {
     called_ = true;
   }
 
-  std::map<std::string, const Rule*> rule_cache_;
   const scoped_ptr<Retriever> retriever_;
   const scoped_ptr<const Supplier::Callback> supplied_;
   OndemandSupplyTask* const task_;
@@ -132,6 +136,21 @@ TEST_F(OndemandSupplyTaskTest, Valid) {
   EXPECT_TRUE(rule_[0]->GetPostalCodeMatcher() == NULL);
 }
 
+TEST_F(OndemandSupplyTaskTest, CachedRuleIsNotParsedAgain) {
+  // This data would fail to parse.
+  source_->data_.insert(std::make_pair("data/XA", "{"));
+  Rule* rule = new Rule;
+  ASSERT_TRUE(rule->ParseSerializedRule("{\"id\":\"data/XA\"}"));
+  rule_cache_.insert(std::make_pair("data/XA", rule));
+
+  Queue("data/XA");
+
+  ASSERT_NO_FATAL_FAILURE(Retrieve());
+  ASSERT_TRUE(called_);
+  EXPECT_EQ(rule, rule_[0]);
+  EXPECT_EQ(1U, rule_cache_.size());
+}
+
 TEST_F(OndemandSupplyTaskTest, ValidHierarchy) {
   source_->data_.insert(
       std::make_pair("data/XA", "{\"id\":\"data/XA\"}"));
@@ -213,6 +232,22 @@ TEST_F(OndemandSupplyTaskTest, EmptyJsonJustMeansServerKnowsNothingAboutKey) {
   EXPECT_EQ("data/XA", rule_[0]->GetId());
 }
 
+TEST_F(OndemandSupplyTaskTest, EmptyJsonIsRecordedAsMissing) {
+  source_->data_.insert(std::make_pair("data/XA", "{\"id\":\"data/XA\"}"));
+  source_->data_.insert(std::make_pair("data/XA/aa", "{}"));
+
+  Queue("data/XA");
+  Queue("data/XA/aa");
+
+  time_t before = time(NULL);
+  ASSERT_NO_FATAL_FAILURE(Retrieve());
+  ASSERT_TRUE(called_);
+
+  ASSERT_EQ(1U, missing_.size());
+  EXPECT_EQ("data/XA/aa", missing_.begin()->first);
+  EXPECT_LE(before, missing_.begin()->second);
+}
+
 TEST_F(OndemandSupplyTaskTest, IfCountryFailsAllFails) {
   source_->data_.insert(
       std::make_pair("data/XA/aa", "{\"id\":\"data/XA/aa\"}"));
@@ -0,0 +1,214 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/parallel_validator.h>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/callback.h>
+#include <libaddressinput/null_storage.h>
+#include <libaddressinput/preload_supplier.h>
+#include <libaddressinput/problem_filter.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+#include <libaddressinput/validation_result.h>
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "testdata_source.h"
+
+namespace {
+
+using i18n::addressinput::AddressData;
+using i18n::addressinput::AddressValidator;
+using i18n::addressinput::BuildCallback;
+using i18n::addressinput::FieldProblemMap;
+using i18n::addressinput::NullStorage;
+using i18n::addressinput::ParallelValidator;
+using i18n::addressinput::PreloadSupplier;
+using i18n::addressinput::ProblemFilter;
+using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::TestdataSource;
+using i18n::addressinput::ValidationResult;
+
+using i18n::addressinput::COUNTRY;
+using i18n::addressinput::POSTAL_CODE;
+
+using i18n::addressinput::MISSING_REQUIRED_FIELD;
+using i18n::addressinput::INVALID_FORMAT;
+
+class ParallelValidatorTest : public testing::TestWithParam<size_t> {
+ protected:
+  ParallelValidatorTest()
+      : supplier_(new TestdataSource(true), new NullStorage),
+        validator_(&supplier_, GetParam()),
+        addresses_(),
+        problems_(),
+        loaded_(BuildCallback(this, &ParallelValidatorTest::Loaded)),
+        validated_(BuildCallback(this, &ParallelValidatorTest::Validated)) {}
+
+  virtual ~ParallelValidatorTest() {}
+
+  void LoadRules(const std::string& region_code) {
+    supplier_.LoadRules(region_code, *loaded_);
+  }
+
+  // Validates each address in |addresses_| with an AddressValidator, to get the
+  // results to compare with ParallelValidator.
+  std::vector<FieldProblemMap> ValidateEach() {
+    AddressValidator validator(&supplier_);
+    std::vector<FieldProblemMap> result(addresses_.size());
+    for (size_t i = 0; i < addresses_.size(); ++i) {
+      validator.Validate(
+          addresses_[i], false, false, NULL, &result[i], *validated_);
+    }
+    return result;
+  }
+
+  PreloadSupplier supplier_;
+  const ParallelValidator validator_;
+  std::vector<AddressData> addresses_;
+  std::vector<FieldProblemMap> problems_;
+
+ private:
+  void Loaded(bool success, const std::string&, int) { ASSERT_TRUE(success); }
+
+  void Validated(bool success, const AddressData&, const FieldProblemMap&) {
+    ASSERT_TRUE(success);
+  }
+
+  const scoped_ptr<const PreloadSupplier::Callback> loaded_;
+  const scoped_ptr<const AddressValidator::Callback> validated_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelValidatorTest);
+};
+
+INSTANTIATE_TEST_CASE_P(NumThreads,
+                        ParallelValidatorTest,
+                        testing::Values(0, 1, 4));
+
+TEST_P(ParallelValidatorTest, EmptyBatch) {
+  EXPECT_TRUE(validator_.ValidateBatch(
+      addresses_, false, false, NULL, &problems_));
+  EXPECT_TRUE(problems_.empty());
+}
+
+TEST_P(ParallelValidatorTest, SameAsAddressValidatorInInputOrder) {
+  LoadRules("CH");
+  LoadRules("JP");
+  LoadRules("MX");
+  LoadRules("US");
+
+  static const char* const kPostalCodes[] = {
+    "", "123", "94043", "8002", "86070", "80000", "770-0847"
+  };
+
+  AddressData address;
+  for (int i = 0; i < 100; ++i) {
+    address = AddressData();
+    address.postal_code = kPostalCodes[i % arraysize(kPostalCodes)];
+    switch (i % 5) {
+      case 0:
+        address.region_code = "US";
+        address.administrative_area = "CA";
+        address.locality = "Mountain View";
+        address.address_line.push_back("1600 Amphitheatre Parkway");
+        break;
+      case 1:
+        address.region_code = "CH";
+        address.locality = "ZH";
+        break;
+      case 2:
+        address.region_code = "MX";
+        address.administrative_area = "TAB";
+        address.locality = "Villahermosa";
+        address.address_line.push_back("Apartado 1");
+        address.language_code = "es";
+        break;
+      case 3:
+        address.region_code = "JP";
+        address.administrative_area =
+            "\xE5\xBE\xB3\xE5\xB3\xB6\xE7\x9C\x8C"; /* 徳島県 */
+        address.language_code = "ja";
+        break;
+      case 4:
+        // No region code.
+        break;
+    }
+    addresses_.push_back(address);
+  }
+
+  ASSERT_TRUE(validator_.ValidateBatch(
+      addresses_, false, false, NULL, &problems_));
+
+  const std::vector<FieldProblemMap>& expected = ValidateEach();
+  ASSERT_EQ(expected.size(), problems_.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i], problems_[i]) << "index " << i;
+  }
+
+  FieldProblemMap missing_country;
+  missing_country.insert(std::make_pair(COUNTRY, MISSING_REQUIRED_FIELD));
+  EXPECT_EQ(missing_country, problems_[4]);
+
+  std::vector<ValidationResult> results;
+  ASSERT_TRUE(validator_.ValidateBatch(
+      addresses_, false, false, ProblemFilter(), &results));
+  ASSERT_EQ(expected.size(), results.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_TRUE(ValidationResult(expected[i]) == results[i]) << "index " << i;
+  }
+}
+
+TEST_P(ParallelValidatorTest, Filter) {
+  LoadRules("CH");
+
+  AddressData address;
+  address.region_code = "CH";
+  address.postal_code = "123";
+  addresses_.push_back(address);
+
+  FieldProblemMap filter;
+  filter.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+
+  ASSERT_TRUE(validator_.ValidateBatch(
+      addresses_, false, false, &filter, &problems_));
+  ASSERT_EQ(1U, problems_.size());
+  EXPECT_EQ(filter, problems_[0]);
+}
+
+TEST_P(ParallelValidatorTest, RulesNotLoaded) {
+  LoadRules("US");
+
+  AddressData address;
+  address.region_code = "US";
+  addresses_.push_back(address);
+  address.region_code = "CH";
+  addresses_.push_back(address);
+
+  EXPECT_FALSE(validator_.ValidateBatch(
+      addresses_, false, false, NULL, &problems_));
+  ASSERT_EQ(2U, problems_.size());
+  EXPECT_FALSE(problems_[0].empty());
+  EXPECT_TRUE(problems_[1].empty());
+}
+
+}  // namespace
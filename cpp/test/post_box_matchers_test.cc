@@ -15,22 +15,21 @@
 #include "post_box_matchers.h"
 
 #include <cstddef>
+#include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
+#include <re2/re2.h>
 
+#include "region_data_constants.h"
 #include "rule.h"
-
-namespace i18n {
-namespace addressinput {
-struct RE2ptr;
-}  // namespace addressinput
-}  // namespace i18n
+#include "util/re2ptr.h"
 
 namespace {
 
 using i18n::addressinput::PostBoxMatchers;
 using i18n::addressinput::RE2ptr;
+using i18n::addressinput::RegionDataConstants;
 using i18n::addressinput::Rule;
 
 TEST(PostBoxMatchersTest, AlwaysGetMatcherForLanguageUnd) {
@@ -84,4 +83,75 @@ TEST(PostBoxMatchersTest, LenientLanguageTagParsing) {
   EXPECT_TRUE(matchers[1] != NULL);
 }
 
+TEST(PostBoxMatchersTest, HasPostBoxLanguageUnd) {
+  Rule rule;
+  std::vector<std::string> lines;
+  EXPECT_FALSE(PostBoxMatchers::HasPostBox(rule, lines));
+  lines.push_back("1600 Amphitheatre Parkway");
+  EXPECT_FALSE(PostBoxMatchers::HasPostBox(rule, lines));
+  lines.push_back("P.O. Box 1");
+  EXPECT_TRUE(PostBoxMatchers::HasPostBox(rule, lines));
+}
+
+TEST(PostBoxMatchersTest, HasPostBoxUnknownLanguages) {
+  Rule rule;
+  ASSERT_TRUE(rule.ParseSerializedRule("{\"languages\":\"xx~sv\"}"));
+  std::vector<std::string> lines(1, "Box 12");
+  EXPECT_TRUE(PostBoxMatchers::HasPostBox(rule, lines));
+  lines[0] = "Boxholm";
+  EXPECT_FALSE(PostBoxMatchers::HasPostBox(rule, lines));
+}
+
+// Verifies that HasPostBox() gives the same result as searching each line with
+// each of the regular expressions from GetMatchers(), for all regions.
+class PostBoxMatchersRegionTest : public testing::TestWithParam<std::string> {};
+
+TEST_P(PostBoxMatchersRegionTest, HasPostBoxSameAsGetMatchers) {
+  static const char* const kLines[] = {
+    "",
+    "12 Main Street",
+    "Main Street",
+    "P.O. Box 12",
+    "PO Box",
+    "Private Bag 3",
+    "Postal Box",
+    "Postfach 123",
+    "POSTBOKS 9",
+    "Postbo\xE2\x84\xAA""s",  /* "Postboks" with a Kelvin sign for 'k' */
+    "Postbus 1",
+    "Postilokero 7",
+    "PL 7",
+    "Pf. 10",
+    "p.p. 5",
+    "Apartado de correos 3",
+    "Skrytka pocztowa 4",
+    "Bo\xC3\xAEte Postale 8",  /* "Boîte Postale 8" */
+    "BP 12",
+    "CEDEX 1",
+    "Box 5",
+    "\xE7\xA7\x81\xE6\x9B\xB8\xE7\xAE\xB1""12\xE5\x8F\xB7",  /* "私書箱12号" */
+    "T.\xCE\x98. 12",  /* "T.Θ. 12" */
+  };
+
+  Rule rule;
+  ASSERT_TRUE(rule.ParseSerializedRule(
+      RegionDataConstants::GetRegionData(GetParam())));
+  const std::vector<const RE2ptr*>& matchers =
+      PostBoxMatchers::GetMatchers(rule);
+
+  for (size_t i = 0; i < sizeof kLines / sizeof *kLines; ++i) {
+    bool expected = false;
+    for (std::vector<const RE2ptr*>::const_iterator
+         it = matchers.begin(); it != matchers.end(); ++it) {
+      expected = expected || RE2::PartialMatch(kLines[i], *(*it)->ptr);
+    }
+    std::vector<std::string> lines(1, kLines[i]);
+    EXPECT_EQ(expected, PostBoxMatchers::HasPostBox(rule, lines)) << kLines[i];
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    AllRegions, PostBoxMatchersRegionTest,
+    testing::ValuesIn(RegionDataConstants::GetRegionCodes()));
+
 }  // namespace
@@ -0,0 +1,158 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "postal_code_matcher.h"
+
+#include <cstddef>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <re2/re2.h>
+
+#include "rule.h"
+#include "util/string_split.h"
+
+namespace {
+
+using i18n::addressinput::PostalCodeMatcher;
+using i18n::addressinput::Rule;
+using i18n::addressinput::SplitString;
+
+TEST(PostalCodeMatcherTest, FixedShape) {
+  PostalCodeMatcher matcher("\\d{5}(?:[ \\-]\\d{4})?");
+  ASSERT_TRUE(matcher.ok());
+  EXPECT_TRUE(matcher.is_specialized());
+  EXPECT_TRUE(matcher.FullMatch("94043"));
+  EXPECT_TRUE(matcher.FullMatch("94043-1351"));
+  EXPECT_TRUE(matcher.FullMatch("94043 1351"));
+  EXPECT_FALSE(matcher.FullMatch(""));
+  EXPECT_FALSE(matcher.FullMatch("9404"));
+  EXPECT_FALSE(matcher.FullMatch("94043-"));
+  EXPECT_FALSE(matcher.FullMatch("94043-135"));
+  EXPECT_FALSE(matcher.FullMatch("94043x1351"));
+  EXPECT_TRUE(matcher.PrefixMatch("94043-"));
+  EXPECT_FALSE(matcher.PrefixMatch("9404"));
+}
+
+TEST(PostalCodeMatcherTest, Alternation) {
+  PostalCodeMatcher matcher("9[01]|1[456]");
+  ASSERT_TRUE(matcher.ok());
+  EXPECT_TRUE(matcher.is_specialized());
+  EXPECT_TRUE(matcher.FullMatch("90"));
+  EXPECT_TRUE(matcher.FullMatch("15"));
+  EXPECT_FALSE(matcher.FullMatch("19"));
+  EXPECT_TRUE(matcher.PrefixMatch("91234"));
+  EXPECT_TRUE(matcher.PrefixMatch("16234"));
+  EXPECT_FALSE(matcher.PrefixMatch("17234"));
+}
+
+TEST(PostalCodeMatcherTest, EmptyPattern) {
+  PostalCodeMatcher matcher("");
+  ASSERT_TRUE(matcher.ok());
+  EXPECT_TRUE(matcher.FullMatch(""));
+  EXPECT_FALSE(matcher.FullMatch("1"));
+  EXPECT_TRUE(matcher.PrefixMatch("1"));
+}
+
+TEST(PostalCodeMatcherTest, FallBackToRE2) {
+  PostalCodeMatcher matcher("\\w+");
+  ASSERT_TRUE(matcher.ok());
+  EXPECT_FALSE(matcher.is_specialized());
+  EXPECT_TRUE(matcher.FullMatch("abc"));
+  EXPECT_FALSE(matcher.FullMatch("a c"));
+  EXPECT_TRUE(matcher.PrefixMatch("a c"));
+}
+
+TEST(PostalCodeMatcherTest, InvalidPattern) {
+  EXPECT_FALSE(PostalCodeMatcher("(").ok());
+  EXPECT_FALSE(PostalCodeMatcher("[9-0]").ok());
+  EXPECT_FALSE(PostalCodeMatcher("\\d{3,2}").ok());
+}
+
+// Returns the result of RE2 matching, the way that the matching was done before
+// there was a PostalCodeMatcher.
+bool RE2Match(const std::string& pattern, const std::string& postal_code,
+              bool prefix) {
+  RE2::Options options;
+  options.set_never_capture(true);
+  RE2 matcher("^(" + pattern + ")", options);
+  return prefix ? RE2::PartialMatch(postal_code, matcher)
+                : RE2::FullMatch(postal_code, matcher);
+}
+
+// Verifies that the patterns in the test data give the same results as RE2.
+TEST(PostalCodeMatcherTest, SameAsRE2ForTestData) {
+  std::ifstream file(TEST_DATA_DIR "/countryinfo.txt");
+  ASSERT_TRUE(file.is_open());
+
+  std::set<std::string> patterns;
+  std::set<std::string> examples;
+  std::string line;
+  while (std::getline(file, line)) {
+    Rule rule;
+    std::string::size_type separator = line.find('=');
+    if (separator == std::string::npos ||
+        !rule.ParseSerializedRule(line.substr(separator + 1))) {
+      continue;
+    }
+    if (rule.GetPostalCodeMatcher() != NULL) {
+      patterns.insert(rule.GetPostalCodeMatcher()->pattern());
+    }
+    std::vector<std::string> postal_codes;
+    SplitString(rule.GetPostalCodeExample(), ',', &postal_codes);
+    examples.insert(postal_codes.begin(), postal_codes.end());
+  }
+
+  // Use every 64th example, and strings derived from it that are slightly
+  // off, to keep the number of matches reasonable.
+  std::vector<std::string> postal_codes;
+  size_t count = 0;
+  for (std::set<std::string>::const_iterator
+       it = examples.begin(); it != examples.end(); ++it) {
+    if (count++ % 64 != 0 || it->empty()) {
+      continue;
+    }
+    postal_codes.push_back(*it);
+    postal_codes.push_back(it->substr(0, it->size() - 1));
+    postal_codes.push_back(*it + "0");
+    postal_codes.push_back(*it + "-1234");
+    postal_codes.push_back(" " + *it);
+  }
+  postal_codes.push_back("");
+
+  size_t specialized = 0;
+  for (std::set<std::string>::const_iterator
+       it = patterns.begin(); it != patterns.end(); ++it) {
+    PostalCodeMatcher matcher(*it);
+    ASSERT_TRUE(matcher.ok()) << *it;
+    if (matcher.is_specialized()) {
+      ++specialized;
+    }
+    for (std::vector<std::string>::const_iterator
+         jt = postal_codes.begin(); jt != postal_codes.end(); ++jt) {
+      EXPECT_EQ(RE2Match(*it, *jt, false), matcher.FullMatch(*jt))
+          << *it << " " << *jt;
+      EXPECT_EQ(RE2Match(*it, *jt, true), matcher.PrefixMatch(*jt))
+          << *it << " " << *jt;
+    }
+  }
+
+  // Nearly all patterns in the test data have a fixed shape.
+  EXPECT_LT(patterns.size() - specialized, patterns.size() / 100);
+}
+
+}  // namespace
@@ -17,28 +17,43 @@
 #include <libaddressinput/address_data.h>
 #include <libaddressinput/callback.h>
 #include <libaddressinput/null_storage.h>
+#include <libaddressinput/source.h>
+#include <libaddressinput/supplier.h>
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
 #include <cstddef>
+#include <map>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "fake_storage.h"
+#include "format_element.h"
 #include "lookup_key.h"
+#include "postal_code_matcher.h"
+#include "region_data_constants.h"
 #include "rule.h"
 #include "testdata_source.h"
+#include "util/thread_pool.h"
 
 namespace {
 
 using i18n::addressinput::AddressData;
 using i18n::addressinput::BuildCallback;
+using i18n::addressinput::FakeStorage;
 using i18n::addressinput::LookupKey;
 using i18n::addressinput::NullStorage;
+using i18n::addressinput::PostalCodeMatcher;
 using i18n::addressinput::PreloadSupplier;
+using i18n::addressinput::RegionDataConstants;
 using i18n::addressinput::Rule;
 using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::Source;
+using i18n::addressinput::Supplier;
 using i18n::addressinput::TestdataSource;
+using i18n::addressinput::ThreadPool;
 
 class PreloadSupplierTest : public testing::Test {
  protected:
@@ -127,4 +142,444 @@ TEST_F(PreloadSupplierTest, GetRulesForRegion) {
   EXPECT_LT(1U, rules.size());
 }
 
+TEST_F(PreloadSupplierTest, SaveAndLoadSnapshot) {
+  supplier_.LoadRules("US", *loaded_callback_);
+  supplier_.LoadRules("JP", *loaded_callback_);
+  std::string snapshot;
+  supplier_.SaveSnapshot(&snapshot);
+
+  PreloadSupplier supplier(new TestdataSource(true), new NullStorage);
+  ASSERT_TRUE(supplier.LoadSnapshot(snapshot.data(), snapshot.size()));
+  EXPECT_TRUE(supplier.IsLoaded("US"));
+  EXPECT_TRUE(supplier.IsLoaded("JP"));
+  EXPECT_FALSE(supplier.IsLoaded("CH"));
+  EXPECT_EQ(1, supplier.GetRulesGeneration("JP"));
+
+  const std::map<std::string, const Rule*>& expected =
+      supplier_.GetRulesForRegion("JP");
+  const std::map<std::string, const Rule*>& actual =
+      supplier.GetRulesForRegion("JP");
+  ASSERT_EQ(expected.size(), actual.size());
+  for (std::map<std::string, const Rule*>::const_iterator
+       it = expected.begin(), jt = actual.begin();
+       it != expected.end(); ++it, ++jt) {
+    EXPECT_EQ(it->first, jt->first);
+    EXPECT_EQ(it->second->GetName(), jt->second->GetName());
+    EXPECT_EQ(it->second->GetLatinName(), jt->second->GetLatinName());
+    EXPECT_EQ(it->second->GetSubKeys(), jt->second->GetSubKeys());
+    EXPECT_EQ(it->second->GetFormat(), jt->second->GetFormat());
+  }
+
+  // The index of Latin script names is restored too.
+  AddressData address;
+  address.region_code = "JP";
+  address.administrative_area = "Kyoto";
+  LookupKey lookup_key;
+  lookup_key.FromAddress(address);
+  const Rule* rule = supplier.GetRule(lookup_key);
+  ASSERT_TRUE(rule != NULL);
+  EXPECT_EQ("data/JP/\xE4\xBA\xAC\xE9\x83\xBD\xE5\xBA\x9C", rule->GetId());
+
+  address.region_code = "US";
+  address.administrative_area.clear();
+  lookup_key.FromAddress(address);
+  rule = supplier.GetRule(lookup_key);
+  ASSERT_TRUE(rule != NULL);
+  ASSERT_TRUE(rule->GetPostalCodeMatcher() != NULL);
+  EXPECT_TRUE(rule->GetPostalCodeMatcher()->FullMatch("94043"));
+  EXPECT_FALSE(rule->GetPostalCodeMatcher()->FullMatch("9404"));
+
+  std::string saved_again;
+  supplier.SaveSnapshot(&saved_again);
+  EXPECT_EQ(snapshot, saved_again);
+
+  // Loading a snapshot again replaces the rules.
+  ASSERT_TRUE(supplier.LoadSnapshot(snapshot.data(), snapshot.size()));
+  EXPECT_EQ(2, supplier.GetRulesGeneration("JP"));
+}
+
+TEST_F(PreloadSupplierTest, LoadInvalidSnapshot) {
+  supplier_.LoadRules("CH", *loaded_callback_);
+  std::string snapshot;
+  supplier_.SaveSnapshot(&snapshot);
+
+  PreloadSupplier supplier(new TestdataSource(true), new NullStorage);
+  EXPECT_FALSE(supplier.LoadSnapshot(NULL, 0));
+  for (size_t size = 0; size < snapshot.size(); size += 7) {
+    EXPECT_FALSE(supplier.LoadSnapshot(snapshot.data(), size));
+  }
+  std::string trailing(snapshot + '\0');
+  EXPECT_FALSE(supplier.LoadSnapshot(trailing.data(), trailing.size()));
+  std::string other_version(snapshot);
+  other_version[4] = '\x7f';
+  EXPECT_FALSE(
+      supplier.LoadSnapshot(other_version.data(), other_version.size()));
+  EXPECT_FALSE(supplier.IsLoaded("CH"));
+
+  EXPECT_TRUE(supplier.LoadSnapshot(snapshot.data(), snapshot.size()));
+  EXPECT_TRUE(supplier.IsLoaded("CH"));
+}
+
+class LoadAllRulesTest : public testing::Test {
+ protected:
+  LoadAllRulesTest()
+      : supplier_(new TestdataSource(true), new NullStorage),
+        loaded_(BuildCallback(this, &LoadAllRulesTest::OnLoaded)),
+        all_loaded_(BuildCallback(this, &LoadAllRulesTest::OnAllLoaded)),
+        success_(false),
+        stats_(),
+        total_seconds_(-1.0) {}
+
+  virtual ~LoadAllRulesTest() {}
+
+  PreloadSupplier supplier_;
+  const scoped_ptr<const PreloadSupplier::Callback> loaded_;
+  const scoped_ptr<const PreloadSupplier::LoadAllCallback> all_loaded_;
+  bool success_;
+  std::vector<PreloadSupplier::RegionLoadStats> stats_;
+  double total_seconds_;
+
+ private:
+  void OnLoaded(bool success, const std::string& region_code, int num_rules) {
+    ASSERT_TRUE(success);
+  }
+
+  void OnAllLoaded(bool success,
+                   const std::vector<PreloadSupplier::RegionLoadStats>& stats,
+                   double total_seconds) {
+    success_ = success;
+    stats_ = stats;
+    total_seconds_ = total_seconds;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(LoadAllRulesTest);
+};
+
+TEST_F(LoadAllRulesTest, LoadsAllRegions) {
+  supplier_.LoadRules("CH", *loaded_);
+  supplier_.LoadAllRules(4, *all_loaded_);
+  EXPECT_TRUE(success_);
+  EXPECT_LE(0.0, total_seconds_);
+
+  const std::vector<std::string>& region_codes =
+      RegionDataConstants::GetRegionCodes();
+  ASSERT_EQ(region_codes.size() - 1, stats_.size());
+  for (size_t i = 0, j = 0; i < region_codes.size(); ++i) {
+    if (region_codes[i] == "CH") {
+      continue;
+    }
+    const PreloadSupplier::RegionLoadStats& stats = stats_[j++];
+    EXPECT_EQ(region_codes[i], stats.region_code);
+    EXPECT_TRUE(stats.success);
+    EXPECT_LE(0.0, stats.build_seconds);
+    if (stats.region_code == "US") {
+      EXPECT_EQ(static_cast<int>(supplier_.GetRulesForRegion("US").size()),
+                stats.num_rules);
+    }
+  }
+
+  EXPECT_TRUE(supplier_.IsLoaded("US"));
+  EXPECT_TRUE(supplier_.IsLoaded("JP"));
+  EXPECT_EQ(1, supplier_.GetRulesGeneration("US"));
+  EXPECT_EQ(1, supplier_.GetRulesGeneration("CH"));
+
+  // Nothing is left to load.
+  supplier_.LoadAllRules(4, *all_loaded_);
+  EXPECT_TRUE(success_);
+  EXPECT_TRUE(stats_.empty());
+}
+
+TEST_F(LoadAllRulesTest, WithoutWorkerThreads) {
+  supplier_.LoadAllRules(0, *all_loaded_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(RegionDataConstants::GetRegionCodes().size(), stats_.size());
+  EXPECT_TRUE(supplier_.IsLoaded("CN"));
+
+  AddressData address;
+  address.region_code = "CN";
+  LookupKey lookup_key;
+  lookup_key.FromAddress(address);
+  const Rule* rule = supplier_.GetRule(lookup_key);
+  ASSERT_TRUE(rule != NULL);
+  EXPECT_EQ("data/CN", rule->GetId());
+}
+
+const char* const kConcurrentRegions[] = {
+  "US", "CN", "JP", "CH", "BR", "KR"
+};
+
+// Loads the rules for kConcurrentRegions when Run() for index 0, while Run()
+// for all other indices checks that each region is seen either as not yet loaded
+// or as completely loaded.
+class LoadWhileReadingTask : public ThreadPool::Task {
+ public:
+  LoadWhileReadingTask(PreloadSupplier* supplier,
+                       const PreloadSupplier::Callback& loaded)
+      : supplier_(supplier), loaded_(loaded) {}
+
+  virtual ~LoadWhileReadingTask() {}
+
+  virtual void Run(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i == 0) {
+        for (size_t j = 0; j < arraysize(kConcurrentRegions); ++j) {
+          supplier_->LoadRules(kConcurrentRegions[j], loaded_);
+        }
+      } else {
+        for (int n = 0; n < 100; ++n) {
+          for (size_t j = 0; j < arraysize(kConcurrentRegions); ++j) {
+            Read(kConcurrentRegions[j]);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  void Read(const std::string& region_code) {
+    AddressData address;
+    address.region_code = region_code;
+    LookupKey lookup_key;
+    lookup_key.FromAddress(address);
+    Supplier::RuleHierarchy hierarchy;
+    bool loaded = supplier_->IsLoaded(region_code);
+    bool found = supplier_->GetRuleHierarchy(lookup_key, &hierarchy);
+    if (loaded) {
+      ASSERT_TRUE(found);
+      ASSERT_TRUE(hierarchy.rule[0] != NULL);
+      EXPECT_EQ("data/" + region_code, hierarchy.rule[0]->GetId());
+    }
+  }
+
+  PreloadSupplier* const supplier_;
+  const PreloadSupplier::Callback& loaded_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadWhileReadingTask);
+};
+
+TEST_F(PreloadSupplierTest, ReadWhileLoading) {
+  LoadWhileReadingTask task(&supplier_, *loaded_callback_);
+  ThreadPool pool(4);
+  pool.ParallelFor(16, 1, &task);
+  for (size_t i = 0; i < arraysize(kConcurrentRegions); ++i) {
+    EXPECT_TRUE(supplier_.IsLoaded(kConcurrentRegions[i]));
+  }
+}
+
+TEST_F(PreloadSupplierTest, ReloadRules) {
+  EXPECT_EQ(0, supplier_.GetRulesGeneration("US"));
+  supplier_.ReloadRules("US", *loaded_callback_);
+  EXPECT_EQ(1, supplier_.GetRulesGeneration("US"));
+
+  LookupKey ca_key;
+  AddressData ca_address;
+  ca_address.region_code = "US";
+  ca_address.administrative_area = "CA";
+  ca_key.FromAddress(ca_address);
+  const Rule* old_rule = supplier_.GetRule(ca_key);
+  ASSERT_TRUE(old_rule != NULL);
+
+  supplier_.ReloadRules("US", *loaded_callback_);
+  EXPECT_EQ(2, supplier_.GetRulesGeneration("US"));
+  EXPECT_EQ(0, supplier_.GetRulesGeneration("CH"));
+
+  const Rule* rule = supplier_.GetRule(ca_key);
+  ASSERT_TRUE(rule != NULL);
+  EXPECT_NE(old_rule, rule);
+  EXPECT_EQ("data/US/CA", rule->GetId());
+}
+
+TEST_F(PreloadSupplierTest, ReloadRulesInsideReadSection) {
+  supplier_.LoadRules("US", *loaded_callback_);
+  AddressData address;
+  address.region_code = "US";
+  address.administrative_area = "CA";
+  LookupKey lookup_key;
+  lookup_key.FromAddress(address);
+
+  PreloadSupplier::ReadSection section(supplier_);
+  const Rule* old_rule = supplier_.GetRule(lookup_key);
+  ASSERT_TRUE(old_rule != NULL);
+
+  // Returns without waiting for |section|, and the old rules are still there
+  // to use until it's left.
+  supplier_.ReloadRules("US", *loaded_callback_);
+  EXPECT_EQ(2, supplier_.GetRulesGeneration("US"));
+  EXPECT_NE(old_rule, supplier_.GetRule(lookup_key));
+  EXPECT_EQ("data/US/CA", old_rule->GetId());
+}
+
+// Counts the requests made, and renames the country in the data returned after
+// Rename() has been called.
+class RenamingSource : public Source {
+ public:
+  RenamingSource()
+      : source_(true),
+        calls_(0),
+        name_(),
+        data_(NULL),
+        data_ready_(BuildCallback(this, &RenamingSource::OnDataReady)) {}
+  virtual ~RenamingSource() {}
+
+  // Source implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    ++calls_;
+    source_.Get(key, *data_ready_);  // Sets |data_|.
+    std::string* data = data_;
+    data_ = NULL;
+    const std::string kName = "\"name\":\"UNITED STATES\"";
+    std::string::size_type pos;
+    if (!name_.empty() && data != NULL &&
+        (pos = data->find(kName)) != std::string::npos) {
+      data->replace(pos, kName.size(), "\"name\":\"" + name_ + '"');
+    }
+    data_ready(data != NULL, key, data);
+  }
+
+  void Rename(const std::string& name) { name_ = name; }
+  int calls() const { return calls_; }
+
+ private:
+  void OnDataReady(bool success, const std::string& key, std::string* data) {
+    data_ = success ? data : NULL;
+    if (!success) {
+      delete data;
+    }
+  }
+
+  TestdataSource source_;
+  mutable int calls_;
+  std::string name_;
+  mutable std::string* data_;
+  const scoped_ptr<const Source::Callback> data_ready_;
+
+  DISALLOW_COPY_AND_ASSIGN(RenamingSource);
+};
+
+class PreloadSupplierSourceTest : public testing::Test {
+ protected:
+  PreloadSupplierSourceTest()
+      : source_(new RenamingSource),
+        supplier_(source_, new FakeStorage),
+        loaded_(BuildCallback(this, &PreloadSupplierSourceTest::OnLoaded)),
+        calls_(0),
+        success_(false) {}
+
+  virtual ~PreloadSupplierSourceTest() {}
+
+  RenamingSource* const source_;  // Owned by |supplier_|.
+  PreloadSupplier supplier_;
+  const scoped_ptr<const PreloadSupplier::Callback> loaded_;
+  int calls_;
+  bool success_;
+
+ private:
+  void OnLoaded(bool success, const std::string& region_code, int num_rules) {
+    ++calls_;
+    success_ = success;
+    ASSERT_EQ(success, supplier_.IsLoaded(region_code));
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(PreloadSupplierSourceTest);
+};
+
+TEST_F(PreloadSupplierSourceTest, FreshDataInStorageIsNotUsed) {
+  AddressData address;
+  address.region_code = "US";
+  LookupKey lookup_key;
+  lookup_key.FromAddress(address);
+
+  supplier_.LoadRules("US", *loaded_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(1, source_->calls());
+  const Rule* rule = supplier_.GetRule(lookup_key);
+  ASSERT_TRUE(rule != NULL);
+  EXPECT_EQ("UNITED STATES", rule->GetName());
+
+  // The data in storage is still fresh, but the source is asked again.
+  source_->Rename("UNITED STATES OF AMERICA");
+  supplier_.ReloadRules("US", *loaded_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(2, source_->calls());
+  EXPECT_EQ(2, supplier_.GetRulesGeneration("US"));
+  rule = supplier_.GetRule(lookup_key);
+  ASSERT_TRUE(rule != NULL);
+  EXPECT_EQ("UNITED STATES OF AMERICA", rule->GetName());
+}
+
+TEST_F(PreloadSupplierSourceTest, UnsupportedRegionIsNotRetrieved) {
+  EXPECT_TRUE(supplier_.IsLoaded("ZZ"));
+  EXPECT_TRUE(supplier_.GetRulesForRegion("ZZ").empty());
+
+  supplier_.LoadRules("ZZ", *loaded_);
+  EXPECT_EQ(1, calls_);
+  EXPECT_TRUE(success_);
+  EXPECT_FALSE(supplier_.IsPending("ZZ"));
+
+  supplier_.LoadRules("ZZ", *loaded_);
+  supplier_.ReloadRules("ZZ", *loaded_);
+  EXPECT_EQ(3, calls_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(0, source_->calls());
+}
+
+// Reloads the rules for kConcurrentRegions when Run() for index 0, while Run()
+// for all other indices uses the rules inside a ReadSection.
+class ReloadWhileReadingTask : public ThreadPool::Task {
+ public:
+  ReloadWhileReadingTask(PreloadSupplier* supplier,
+                         const PreloadSupplier::Callback& loaded)
+      : supplier_(supplier), loaded_(loaded) {}
+
+  virtual ~ReloadWhileReadingTask() {}
+
+  virtual void Run(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i == 0) {
+        for (int n = 0; n < 5; ++n) {
+          for (size_t j = 0; j < arraysize(kConcurrentRegions); ++j) {
+            supplier_->ReloadRules(kConcurrentRegions[j], loaded_);
+          }
+        }
+      } else {
+        for (int n = 0; n < 100; ++n) {
+          for (size_t j = 0; j < arraysize(kConcurrentRegions); ++j) {
+            Read(kConcurrentRegions[j]);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  void Read(const std::string& region_code) {
+    AddressData address;
+    address.region_code = region_code;
+    LookupKey lookup_key;
+    lookup_key.FromAddress(address);
+    Supplier::RuleHierarchy hierarchy;
+    PreloadSupplier::ReadSection section(*supplier_);
+    ASSERT_TRUE(supplier_->GetRuleHierarchy(lookup_key, &hierarchy));
+    ASSERT_TRUE(hierarchy.rule[0] != NULL);
+    EXPECT_EQ("data/" + region_code, hierarchy.rule[0]->GetId());
+  }
+
+  PreloadSupplier* const supplier_;
+  const PreloadSupplier::Callback& loaded_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReloadWhileReadingTask);
+};
+
+TEST_F(PreloadSupplierTest, ReadWhileReloading) {
+  for (size_t i = 0; i < arraysize(kConcurrentRegions); ++i) {
+    supplier_.LoadRules(kConcurrentRegions[i], *loaded_callback_);
+  }
+  ReloadWhileReadingTask task(&supplier_, *loaded_callback_);
+  ThreadPool pool(4);
+  pool.ParallelFor(16, 1, &task);
+  for (size_t i = 0; i < arraysize(kConcurrentRegions); ++i) {
+    EXPECT_EQ(6, supplier_.GetRulesGeneration(kConcurrentRegions[i]));
+  }
+}
+
 }  // namespace
@@ -0,0 +1,77 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/problem_filter.h>
+
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+#include <libaddressinput/address_validator.h>
+
+#include <cstddef>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using i18n::addressinput::FieldProblemMap;
+using i18n::addressinput::ProblemFilter;
+
+using i18n::addressinput::ADMIN_AREA;
+using i18n::addressinput::POSTAL_CODE;
+using i18n::addressinput::STREET_ADDRESS;
+
+using i18n::addressinput::UNEXPECTED_FIELD;
+using i18n::addressinput::UNKNOWN_VALUE;
+using i18n::addressinput::INVALID_FORMAT;
+using i18n::addressinput::USES_P_O_BOX;
+
+TEST(ProblemFilterTest, DefaultReportsAll) {
+  ProblemFilter filter;
+  EXPECT_TRUE(filter.ShouldReport(STREET_ADDRESS, USES_P_O_BOX));
+  EXPECT_TRUE(filter.ShouldReportAny(USES_P_O_BOX));
+}
+
+TEST(ProblemFilterTest, NullReportsAll) {
+  ProblemFilter filter(NULL);
+  EXPECT_TRUE(filter.ShouldReport(STREET_ADDRESS, USES_P_O_BOX));
+  EXPECT_TRUE(filter.ShouldReportAny(USES_P_O_BOX));
+}
+
+TEST(ProblemFilterTest, EmptyReportsAll) {
+  FieldProblemMap problems;
+  ProblemFilter filter(&problems);
+  EXPECT_TRUE(filter.ShouldReport(STREET_ADDRESS, USES_P_O_BOX));
+  EXPECT_TRUE(filter.ShouldReportAny(USES_P_O_BOX));
+}
+
+TEST(ProblemFilterTest, ReportsOnlyPairsInFilter) {
+  FieldProblemMap problems;
+  problems.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+  problems.insert(std::make_pair(ADMIN_AREA, UNKNOWN_VALUE));
+  ProblemFilter filter(&problems);
+
+  EXPECT_TRUE(filter.ShouldReport(POSTAL_CODE, INVALID_FORMAT));
+  EXPECT_TRUE(filter.ShouldReport(ADMIN_AREA, UNKNOWN_VALUE));
+  EXPECT_FALSE(filter.ShouldReport(POSTAL_CODE, UNKNOWN_VALUE));
+  EXPECT_FALSE(filter.ShouldReport(ADMIN_AREA, INVALID_FORMAT));
+  EXPECT_FALSE(filter.ShouldReport(STREET_ADDRESS, USES_P_O_BOX));
+
+  EXPECT_TRUE(filter.ShouldReportAny(INVALID_FORMAT));
+  EXPECT_TRUE(filter.ShouldReportAny(UNKNOWN_VALUE));
+  EXPECT_FALSE(filter.ShouldReportAny(UNEXPECTED_FIELD));
+  EXPECT_FALSE(filter.ShouldReportAny(USES_P_O_BOX));
+}
+
+}  // namespace
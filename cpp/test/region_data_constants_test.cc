@@ -14,13 +14,28 @@
 
 #include "region_data_constants.h"
 
+#include <libaddressinput/address_field.h>
+
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "format_element.h"
+#include "rule.h"
+
 namespace {
 
+using i18n::addressinput::AddressField;
+using i18n::addressinput::FormatElement;
 using i18n::addressinput::RegionDataConstants;
+using i18n::addressinput::Rule;
+
+using i18n::addressinput::COUNTRY;
+using i18n::addressinput::ADMIN_AREA;
+using i18n::addressinput::DEPENDENT_LOCALITY;
+using i18n::addressinput::RECIPIENT;
 
 // Tests for region codes, for example "ZA".
 class RegionCodeTest : public testing::TestWithParam<std::string> {};
@@ -68,6 +83,30 @@ TEST_P(RegionDataTest, RegionDataHasCurlyBraces) {
   EXPECT_TRUE(HasCurlyBraces(GetData()));
 }
 
+// Verifies that the precomputed field masks match the rule for the region.
+TEST_P(RegionDataTest, FieldMasksMatchRule) {
+  Rule rule;
+  rule.CopyFrom(Rule::GetDefault());
+  ASSERT_TRUE(rule.ParseSerializedRule(GetData()));
+
+  int used_fields = RegionDataConstants::GetUsedFields(GetParam());
+  int required_fields = RegionDataConstants::GetRequiredFields(GetParam());
+
+  for (int i = COUNTRY; i <= RECIPIENT; ++i) {
+    AddressField field = static_cast<AddressField>(i);
+    bool used = field == COUNTRY ||
+                std::find(rule.GetFormat().begin(),
+                          rule.GetFormat().end(),
+                          FormatElement(field)) != rule.GetFormat().end();
+    bool required = field == COUNTRY ||
+                    std::find(rule.GetRequired().begin(),
+                              rule.GetRequired().end(),
+                              field) != rule.GetRequired().end();
+    EXPECT_EQ(used, (used_fields & (1 << field)) != 0) << field;
+    EXPECT_EQ(required, (required_fields & (1 << field)) != 0) << field;
+  }
+}
+
 // Test all region data.
 INSTANTIATE_TEST_CASE_P(
     AllRegionData, RegionDataTest,
@@ -80,4 +119,34 @@ TEST(RegionDataConstantsTest, GetMaxLookupKeyDepth) {
   EXPECT_EQ(3, RegionDataConstants::GetMaxLookupKeyDepth("CN"));
 }
 
+TEST(RegionDataConstantsTest, GetUsedFields) {
+  EXPECT_EQ(0, RegionDataConstants::GetUsedFields("rrr"));
+  EXPECT_EQ(0, RegionDataConstants::GetUsedFields("US") &
+               (1 << DEPENDENT_LOCALITY));
+  EXPECT_NE(0, RegionDataConstants::GetUsedFields("CN") &
+               (1 << DEPENDENT_LOCALITY));
+}
+
+TEST(RegionDataConstantsTest, GetRequiredFields) {
+  EXPECT_EQ(0, RegionDataConstants::GetRequiredFields("rrr"));
+  EXPECT_NE(0, RegionDataConstants::GetRequiredFields("US") &
+               (1 << ADMIN_AREA));
+  EXPECT_EQ(0, RegionDataConstants::GetRequiredFields("AT") &
+               (1 << ADMIN_AREA));
+}
+
+TEST(RegionDataConstantsTest, GetLanguages) {
+  EXPECT_TRUE(RegionDataConstants::GetLanguages("rrr").empty());
+
+  const std::vector<std::string>& languages =
+      RegionDataConstants::GetLanguages("CH");
+  ASSERT_EQ(3U, languages.size());
+  EXPECT_EQ("de", languages[0]);
+  EXPECT_EQ("fr", languages[1]);
+  EXPECT_EQ("it", languages[2]);
+
+  ASSERT_EQ(1U, RegionDataConstants::GetLanguages("US").size());
+  EXPECT_EQ("en", RegionDataConstants::GetLanguages("US")[0]);
+}
+
 }  // namespace
@@ -16,17 +16,25 @@
 
 #include <libaddressinput/callback.h>
 #include <libaddressinput/null_storage.h>
+#include <libaddressinput/source.h>
 #include <libaddressinput/storage.h>
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
 
 #include <cstddef>
+#include <ctime>
+#include <map>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "fake_storage.h"
 #include "mock_source.h"
 #include "testdata_source.h"
+#include "util/shared_string.h"
 
 #define CHECKSUM "dd63dafcbd4d5b28badfcaf86fb6fcdb"
 #define DATA "{'foo': 'bar'}"
@@ -35,11 +43,15 @@
 namespace {
 
 using i18n::addressinput::BuildCallback;
+using i18n::addressinput::FakeStorage;
 using i18n::addressinput::MockSource;
 using i18n::addressinput::NullStorage;
 using i18n::addressinput::Retriever;
 using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::SharedString;
+using i18n::addressinput::Source;
 using i18n::addressinput::Storage;
+using i18n::addressinput::StorageOptions;
 using i18n::addressinput::TestdataSource;
 
 const char kKey[] = "data/CA/AB--fr";
@@ -177,4 +189,384 @@ TEST_F(RetrieverTest, DoNotUseStaleDataWhenSourceSucceeds) {
   EXPECT_TRUE(stale_storage->data_updated_);
 }
 
+// A source that doesn't answer any request until Flush() is called.
+class DelayedSource : public Source {
+ public:
+  DelayedSource() : source_(false), requests_() {}
+  virtual ~DelayedSource() {}
+
+  // Source implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    requests_.push_back(std::make_pair(key, &data_ready));
+  }
+
+  // Answers all requests made so far.
+  void Flush() {
+    std::vector<std::pair<std::string, const Callback*> > requests;
+    requests.swap(requests_);
+    for (std::vector<std::pair<std::string, const Callback*> >::const_iterator
+         it = requests.begin(); it != requests.end(); ++it) {
+      source_.Get(it->first, *it->second);
+    }
+  }
+
+  size_t request_count() const { return requests_.size(); }
+
+ private:
+  TestdataSource source_;
+  mutable std::vector<std::pair<std::string, const Callback*> > requests_;
+
+  DISALLOW_COPY_AND_ASSIGN(DelayedSource);
+};
+
+class CountingCallback {
+ public:
+  CountingCallback()
+      : count_(0),
+        keys_(),
+        data_(),
+        data_ready_(BuildCallback(this, &CountingCallback::OnDataReady)) {}
+
+  int count_;
+  std::multiset<std::string> keys_;
+  std::string data_;
+  const scoped_ptr<const Retriever::Callback> data_ready_;
+
+ private:
+  void OnDataReady(bool success,
+                   const std::string& key,
+                   const std::string& data) {
+    EXPECT_TRUE(success);
+    ++count_;
+    keys_.insert(key);
+    data_ = data;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(CountingCallback);
+};
+
+TEST(RetrieverCoalescingTest, SameKeyIsRetrievedOnce) {
+  // Owned by |retriever|.
+  DelayedSource* source = new DelayedSource;
+  Retriever retriever(source, new NullStorage);
+  CountingCallback first;
+  CountingCallback second;
+
+  retriever.Retrieve(kKey, *first.data_ready_);
+  retriever.Retrieve(kKey, *second.data_ready_);
+  EXPECT_EQ(1U, source->request_count());
+  EXPECT_EQ(0, first.count_);
+
+  source->Flush();
+  EXPECT_EQ(1, first.count_);
+  EXPECT_EQ(1, second.count_);
+  EXPECT_EQ(1U, first.keys_.count(kKey));
+  EXPECT_EQ(1U, second.keys_.count(kKey));
+  EXPECT_FALSE(first.data_.empty());
+  EXPECT_EQ(first.data_, second.data_);
+
+  // Once the data has arrived, it's retrieved again on request.
+  retriever.Retrieve(kKey, *first.data_ready_);
+  EXPECT_EQ(1U, source->request_count());
+  source->Flush();
+  EXPECT_EQ(2, first.count_);
+  EXPECT_EQ(1, second.count_);
+}
+
+// A source that counts the calls to GetMulti().
+class BatchSource : public Source {
+ public:
+  BatchSource() : source_(false), calls_(0), keys_(0) {}
+  virtual ~BatchSource() {}
+
+  // Source implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    ADD_FAILURE() << "Get() called for " << key;
+    source_.Get(key, data_ready);
+  }
+
+  // Source implementation.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const {
+    ++calls_;
+    keys_ += keys.size();
+    for (std::vector<std::string>::const_iterator it = keys.begin();
+         it != keys.end(); ++it) {
+      source_.Get(*it, data_ready);
+    }
+  }
+
+  int calls() const { return calls_; }
+  size_t keys() const { return keys_; }
+
+ private:
+  TestdataSource source_;
+  mutable int calls_;
+  mutable size_t keys_;
+
+  DISALLOW_COPY_AND_ASSIGN(BatchSource);
+};
+
+// A storage that counts the calls to GetMulti().
+class BatchStorage : public Storage {
+ public:
+  BatchStorage() : storage_(), calls_(0) {}
+  virtual ~BatchStorage() {}
+
+  // Storage implementation.
+  virtual void Put(const std::string& key, std::string* data) {
+    storage_.Put(key, data);
+  }
+
+  // Storage implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    ADD_FAILURE() << "Get() called for " << key;
+    storage_.Get(key, data_ready);
+  }
+
+  // Storage implementation.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const {
+    ++calls_;
+    storage_.GetMulti(keys, data_ready);
+  }
+
+  int calls() const { return calls_; }
+
+ private:
+  FakeStorage storage_;
+  mutable int calls_;
+
+  DISALLOW_COPY_AND_ASSIGN(BatchStorage);
+};
+
+TEST(RetrieverMultiTest, KeysAreRetrievedTogether) {
+  // Owned by |retriever|.
+  BatchSource* source = new BatchSource;
+  BatchStorage* storage = new BatchStorage;
+  Retriever retriever(source, storage);
+  CountingCallback callback;
+  std::vector<std::string> keys;
+  keys.push_back(kKey);
+  keys.push_back("data/CA");
+  keys.push_back("data/CA/AB");
+
+  retriever.RetrieveMulti(keys, *callback.data_ready_);
+  EXPECT_EQ(3, callback.count_);
+  EXPECT_EQ(1U, callback.keys_.count("data/CA"));
+  EXPECT_EQ(1U, callback.keys_.count("data/CA/AB"));
+  EXPECT_EQ(1, storage->calls());
+  EXPECT_EQ(1, source->calls());
+  EXPECT_EQ(3U, source->keys());
+
+  // Now all of the data is in storage.
+  retriever.RetrieveMulti(keys, *callback.data_ready_);
+  EXPECT_EQ(6, callback.count_);
+  EXPECT_EQ(2, storage->calls());
+  EXPECT_EQ(1, source->calls());
+}
+
+TEST(RetrieverMultiTest, KeysInFlightAreNotRetrievedAgain) {
+  // Owned by |retriever|.
+  DelayedSource* source = new DelayedSource;
+  Retriever retriever(source, new NullStorage);
+  CountingCallback first;
+  CountingCallback second;
+  std::vector<std::string> keys;
+  keys.push_back(kKey);
+  keys.push_back(kKey + std::string("x"));
+
+  retriever.Retrieve(kKey, *first.data_ready_);
+  retriever.RetrieveMulti(keys, *second.data_ready_);
+  EXPECT_EQ(2U, source->request_count());
+
+  source->Flush();
+  EXPECT_EQ(1, first.count_);
+  EXPECT_EQ(2, second.count_);
+  EXPECT_EQ(1U, second.keys_.count(kKey));
+}
+
+TEST(RetrieverOptionsTest, StaleWhileRevalidate) {
+  // Owned by |retriever|.
+  DelayedSource* source = new DelayedSource;
+  StaleStorage* stale_storage = new StaleStorage;
+  Retriever retriever(source, stale_storage);
+  StorageOptions options;
+  options.stale_while_revalidate = true;
+  retriever.set_options(options);
+  CountingCallback first;
+  CountingCallback second;
+
+  retriever.Retrieve(kKey, *first.data_ready_);
+  EXPECT_EQ(1, first.count_);
+  EXPECT_EQ(kStaleData, first.data_);
+  EXPECT_EQ(1U, source->request_count());
+
+  // The stale data is being refreshed already, so it's not requested again.
+  retriever.Retrieve(kKey, *second.data_ready_);
+  EXPECT_EQ(1, second.count_);
+  EXPECT_EQ(kStaleData, second.data_);
+  EXPECT_EQ(1U, source->request_count());
+
+  EXPECT_FALSE(stale_storage->data_updated_);
+  source->Flush();
+  EXPECT_TRUE(stale_storage->data_updated_);
+  EXPECT_EQ(1, first.count_);
+  EXPECT_EQ(1, second.count_);
+}
+
+TEST(RetrieverOptionsTest, MaxAge) {
+  // Owned by |retriever|.
+  DelayedSource* source = new DelayedSource;
+  StaleStorage* stale_storage = new StaleStorage;
+  Retriever retriever(source, stale_storage);
+  StorageOptions options;
+  // Long enough for data from OLD_TIMESTAMP to not be stale.
+  options.max_age = time(NULL) + 24 * 60 * 60;
+  retriever.set_options(options);
+  CountingCallback callback;
+
+  retriever.Retrieve(kKey, *callback.data_ready_);
+  EXPECT_EQ(1, callback.count_);
+  EXPECT_EQ(kStaleData, callback.data_);
+  EXPECT_EQ(0U, source->request_count());
+}
+
+TEST(RetrieverRefreshTest, FreshDataIsRequestedAgain) {
+  // Owned by |retriever|.
+  DelayedSource* source = new DelayedSource;
+  Retriever retriever(source, new FakeStorage);
+  CountingCallback callback;
+
+  retriever.Retrieve(kKey, *callback.data_ready_);
+  source->Flush();
+  EXPECT_EQ(1, callback.count_);
+
+  // The data is fresh in storage, so Retrieve() doesn't use the source.
+  retriever.Retrieve(kKey, *callback.data_ready_);
+  EXPECT_EQ(2, callback.count_);
+  EXPECT_EQ(0U, source->request_count());
+
+  retriever.Refresh(kKey, *callback.data_ready_);
+  EXPECT_EQ(2, callback.count_);
+  EXPECT_EQ(1U, source->request_count());
+  source->Flush();
+  EXPECT_EQ(3, callback.count_);
+  EXPECT_FALSE(callback.data_.empty());
+}
+
+TEST(RetrieverRefreshTest, DataInStorageIsUsedWhenSourceFails) {
+  // Owned by |retriever|.
+  StaleStorage* stale_storage = new StaleStorage;
+  // An empty MockSource will fail for any request.
+  Retriever retriever(new MockSource, stale_storage);
+  StorageOptions options;
+  // Long enough for data from OLD_TIMESTAMP to not be stale.
+  options.max_age = time(NULL) + 24 * 60 * 60;
+  retriever.set_options(options);
+  CountingCallback callback;
+
+  retriever.Refresh(kKey, *callback.data_ready_);
+  EXPECT_EQ(1, callback.count_);
+  EXPECT_EQ(kStaleData, callback.data_);
+  EXPECT_FALSE(stale_storage->data_updated_);
+}
+
+// A storage that remembers the last data that it has returned.
+class RecordingStorage : public Storage {
+ public:
+  RecordingStorage() : data_(), put_count_(0), last_data_(NULL) {}
+  virtual ~RecordingStorage() {}
+
+  // Storage implementation.
+  virtual void Put(const std::string& key, std::string* data) {
+    scoped_ptr<std::string> owned(data);
+    ++put_count_;
+    data_[key] = *data;
+  }
+
+  // Storage implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    std::map<std::string, std::string>::const_iterator it = data_.find(key);
+    bool success = it != data_.end();
+    last_data_ = success ? new std::string(it->second) : NULL;
+    data_ready(success, key, last_data_);
+  }
+
+  int put_count() const { return put_count_; }
+  const std::string* last_data() const { return last_data_; }
+
+ private:
+  std::map<std::string, std::string> data_;
+  int put_count_;
+  mutable std::string* last_data_;  // Owned by the caller of Get().
+
+  DISALLOW_COPY_AND_ASSIGN(RecordingStorage);
+};
+
+// Keeps a reference to the data retrieved.
+class SharedCallback {
+ public:
+  SharedCallback()
+      : count_(0),
+        data_(),
+        data_ready_(BuildCallback(this, &SharedCallback::OnDataReady)) {}
+
+  ~SharedCallback() {}
+
+  int count_;
+  SharedString data_;
+  const scoped_ptr<const Retriever::SharedCallback> data_ready_;
+
+ private:
+  void OnDataReady(bool success,
+                   const std::string& key,
+                   const SharedString& data) {
+    EXPECT_TRUE(success);
+    ++count_;
+    data_ = data;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(SharedCallback);
+};
+
+TEST(RetrieverSharedTest, DataFromStorageIsNotCopied) {
+  // Owned by |retriever|.
+  RecordingStorage* storage = new RecordingStorage;
+  Retriever retriever(new TestdataSource(false), storage);
+  SharedCallback first;
+  SharedCallback second;
+
+  // The data from the source is put in storage even though |first| keeps a
+  // reference to it.
+  retriever.Retrieve(kKey, *first.data_ready_);
+  EXPECT_EQ(1, first.count_);
+  EXPECT_FALSE(first.data_.get().empty());
+  EXPECT_EQ(1, storage->put_count());
+  EXPECT_TRUE(storage->last_data() == NULL);
+
+  retriever.Retrieve(kKey, *second.data_ready_);
+  EXPECT_EQ(1, second.count_);
+  EXPECT_EQ(first.data_.get(), second.data_.get());
+  EXPECT_EQ(storage->last_data(), &second.data_.get());
+  EXPECT_TRUE(second.data_.unique());
+}
+
+TEST(RetrieverSharedTest, CallbacksShareTheData) {
+  // Owned by |retriever|.
+  DelayedSource* source = new DelayedSource;
+  Retriever retriever(source, new NullStorage);
+  SharedCallback shared;
+  CountingCallback plain;
+
+  retriever.Retrieve(kKey, *shared.data_ready_);
+  retriever.Retrieve(kKey, *plain.data_ready_);
+  EXPECT_EQ(1U, source->request_count());
+
+  source->Flush();
+  EXPECT_EQ(1, shared.count_);
+  EXPECT_EQ(1, plain.count_);
+  EXPECT_EQ(plain.data_, shared.data_.get());
+}
+
 }  // namespace
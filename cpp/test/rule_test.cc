@@ -27,8 +27,10 @@
 #include "format_element.h"
 #include "grit.h"
 #include "messages.h"
+#include "postal_code_matcher.h"
 #include "region_data_constants.h"
 #include "util/json.h"
+#include "util/snapshot_io.h"
 
 namespace {
 
@@ -41,6 +43,8 @@ using i18n::addressinput::LOCALITY;
 using i18n::addressinput::Localization;
 using i18n::addressinput::RegionDataConstants;
 using i18n::addressinput::Rule;
+using i18n::addressinput::SnapshotReader;
+using i18n::addressinput::SnapshotWriter;
 using i18n::addressinput::STREET_ADDRESS;
 
 TEST(RuleTest, CopyOverwritesRule) {
@@ -99,6 +103,50 @@ TEST(RuleTest, CopyOverwritesRule) {
   EXPECT_TRUE(copy.GetPostalCodeMatcher() != NULL);
 }
 
+TEST(RuleTest, SnapshotRestoresRule) {
+  Rule rule;
+  ASSERT_TRUE(rule.ParseSerializedRule("{"
+                                       "\"fmt\":\"%S%n%Z\","
+                                       "\"lfmt\":\"%Z %S\","
+                                       "\"id\":\"data/XA\","
+                                       "\"name\":\"Le Test\","
+                                       "\"lname\":\"Testistan\","
+                                       "\"require\":\"AC\","
+                                       "\"sub_keys\":\"aa~bb~cc\","
+                                       "\"languages\":\"en~fr\","
+                                       "\"zip\":\"\\\\d{3}\","
+                                       "\"zip_name_type\":\"postal\","
+                                       "\"zipex\":\"1234\""
+                                       "}"));
+  std::string snapshot;
+  SnapshotWriter writer(&snapshot);
+  rule.WriteSnapshot(&writer);
+
+  Rule copy;
+  SnapshotReader reader(snapshot.data(), snapshot.size());
+  ASSERT_TRUE(copy.ParseSnapshot(&reader));
+  EXPECT_TRUE(reader.AtEnd());
+  EXPECT_EQ(rule.GetFormat(), copy.GetFormat());
+  EXPECT_EQ(rule.GetLatinFormat(), copy.GetLatinFormat());
+  EXPECT_EQ(rule.GetId(), copy.GetId());
+  EXPECT_EQ(rule.GetRequired(), copy.GetRequired());
+  EXPECT_EQ(rule.GetSubKeys(), copy.GetSubKeys());
+  EXPECT_EQ(rule.GetLanguages(), copy.GetLanguages());
+  EXPECT_EQ(INVALID_MESSAGE_ID, copy.GetAdminAreaNameMessageId());
+  EXPECT_EQ(rule.GetPostalCodeNameMessageId(),
+            copy.GetPostalCodeNameMessageId());
+  EXPECT_EQ(rule.GetName(), copy.GetName());
+  EXPECT_EQ(rule.GetLatinName(), copy.GetLatinName());
+  EXPECT_EQ(rule.GetPostalCodeExample(), copy.GetPostalCodeExample());
+  EXPECT_EQ(rule.GetPostServiceUrl(), copy.GetPostServiceUrl());
+  ASSERT_TRUE(copy.GetPostalCodeMatcher() != NULL);
+  EXPECT_EQ(rule.GetPostalCodeMatcher()->pattern(),
+            copy.GetPostalCodeMatcher()->pattern());
+
+  SnapshotReader truncated(snapshot.data(), snapshot.size() - 1);
+  EXPECT_FALSE(copy.ParseSnapshot(&truncated));
+}
+
 TEST(RuleTest, ParseOverwritesRule) {
   Rule rule;
   ASSERT_TRUE(rule.ParseSerializedRule("{"
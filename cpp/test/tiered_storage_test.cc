@@ -0,0 +1,222 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/tiered_storage.h>
+
+#include <libaddressinput/callback.h>
+#include <libaddressinput/storage.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake_storage.h"
+
+namespace {
+
+using i18n::addressinput::BuildCallback;
+using i18n::addressinput::FakeStorage;
+using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::Storage;
+using i18n::addressinput::TieredStorage;
+
+const char kKey[] = "key";
+
+// The memory budget, which is enough for a few small values.
+const size_t kMaxMemoryBytes = 64;
+
+// A storage that counts the keys that are got from it.
+class CountingStorage : public Storage {
+ public:
+  CountingStorage() : storage_(), gets_(0), get_multi_calls_(0) {}
+  virtual ~CountingStorage() {}
+
+  // Storage implementation.
+  virtual void Put(const std::string& key, std::string* data) {
+    storage_.Put(key, data);
+  }
+
+  // Storage implementation.
+  virtual void Get(const std::string& key, const Callback& data_ready) const {
+    ++gets_;
+    storage_.Get(key, data_ready);
+  }
+
+  // Storage implementation.
+  virtual void GetMulti(const std::vector<std::string>& keys,
+                        const Callback& data_ready) const {
+    ++get_multi_calls_;
+    Storage::GetMulti(keys, data_ready);
+  }
+
+  int gets() const { return gets_; }
+  int get_multi_calls() const { return get_multi_calls_; }
+
+ private:
+  FakeStorage storage_;
+  mutable int gets_;
+  mutable int get_multi_calls_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingStorage);
+};
+
+// Tests for TieredStorage object.
+class TieredStorageTest : public testing::Test {
+ protected:
+  TieredStorageTest()
+      : wrapped_storage_(new CountingStorage),
+        storage_(wrapped_storage_, kMaxMemoryBytes),
+        success_(false),
+        key_(),
+        data_(),
+        data_ready_(BuildCallback(this, &TieredStorageTest::OnDataReady)) {}
+
+  virtual ~TieredStorageTest() {}
+
+  CountingStorage* const wrapped_storage_;  // Owned by |storage_|.
+  TieredStorage storage_;
+  bool success_;
+  std::string key_;
+  std::string data_;
+  const scoped_ptr<const Storage::Callback> data_ready_;
+
+ private:
+  void OnDataReady(bool success, const std::string& key, std::string* data) {
+    ASSERT_FALSE(success && data == NULL);
+    success_ = success;
+    key_ = key;
+    data_.clear();
+    if (data != NULL) {
+      data_ = *data;
+      delete data;
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(TieredStorageTest);
+};
+
+TEST_F(TieredStorageTest, GetWithoutPutReturnsEmptyData) {
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_FALSE(success_);
+  EXPECT_EQ(kKey, key_);
+  EXPECT_TRUE(data_.empty());
+  EXPECT_EQ(1U, storage_.misses());
+  EXPECT_EQ(0U, storage_.memory_size());
+}
+
+TEST_F(TieredStorageTest, PutIsWrittenThrough) {
+  storage_.Put(kKey, new std::string("value"));
+  wrapped_storage_->Get(kKey, *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("value", data_);
+}
+
+TEST_F(TieredStorageTest, GetAfterPutIsServedFromMemory) {
+  storage_.Put(kKey, new std::string("value"));
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(kKey, key_);
+  EXPECT_EQ("value", data_);
+  EXPECT_EQ(0, wrapped_storage_->gets());
+  EXPECT_EQ(1U, storage_.memory_hits());
+  EXPECT_EQ(0U, storage_.storage_hits());
+}
+
+TEST_F(TieredStorageTest, PutReplacesDataInMemory) {
+  storage_.Put(kKey, new std::string("old"));
+  storage_.Put(kKey, new std::string("new"));
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_EQ("new", data_);
+  EXPECT_EQ(1U, storage_.memory_size());
+  EXPECT_EQ(9U, storage_.memory_bytes());  // "new", and "key" twice.
+}
+
+TEST_F(TieredStorageTest, DataGotIsPromotedToMemory) {
+  wrapped_storage_->Put(kKey, new std::string("value"));
+
+  storage_.Get(kKey, *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("value", data_);
+  EXPECT_EQ(1, wrapped_storage_->gets());
+  EXPECT_EQ(1U, storage_.storage_hits());
+
+  storage_.Get(kKey, *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ("value", data_);
+  EXPECT_EQ(1, wrapped_storage_->gets());
+  EXPECT_EQ(1U, storage_.memory_hits());
+}
+
+TEST_F(TieredStorageTest, LeastRecentlyUsedDataIsDropped) {
+  // Each value takes 20 bytes, so three fit in memory.
+  storage_.Put("key0", new std::string(12, 'a'));
+  storage_.Put("key1", new std::string(12, 'b'));
+  storage_.Put("key2", new std::string(12, 'c'));
+  EXPECT_EQ(3U, storage_.memory_size());
+  EXPECT_EQ(60U, storage_.memory_bytes());
+
+  storage_.Get("key0", *data_ready_);  // Now key1 is the least recently used.
+  storage_.Put("key3", new std::string(12, 'd'));
+  EXPECT_EQ(3U, storage_.memory_size());
+
+  storage_.Get("key1", *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(std::string(12, 'b'), data_);
+  EXPECT_EQ(1, wrapped_storage_->gets());
+
+  storage_.Get("key0", *data_ready_);
+  EXPECT_EQ(1, wrapped_storage_->gets());
+}
+
+TEST_F(TieredStorageTest, DataOverBudgetIsNotKeptInMemory) {
+  storage_.Put("key0", new std::string("value"));
+  storage_.Put(kKey, new std::string(kMaxMemoryBytes, 'a'));
+  EXPECT_EQ(1U, storage_.memory_size());
+
+  storage_.Get(kKey, *data_ready_);
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(std::string(kMaxMemoryBytes, 'a'), data_);
+  EXPECT_EQ(1, wrapped_storage_->gets());
+}
+
+TEST_F(TieredStorageTest, GetMultiGetsMissingKeysTogether) {
+  storage_.Put("key0", new std::string("value"));
+  wrapped_storage_->Put("key1", new std::string("value"));
+  std::vector<std::string> keys;
+  keys.push_back("key0");
+  keys.push_back("key1");
+  keys.push_back("key2");
+
+  storage_.GetMulti(keys, *data_ready_);
+  EXPECT_EQ(1, wrapped_storage_->get_multi_calls());
+  EXPECT_EQ(2, wrapped_storage_->gets());
+  EXPECT_EQ(1U, storage_.memory_hits());
+  EXPECT_EQ(1U, storage_.storage_hits());
+  EXPECT_EQ(1U, storage_.misses());
+
+  storage_.GetMulti(keys, *data_ready_);
+  EXPECT_EQ(2, wrapped_storage_->get_multi_calls());
+  EXPECT_EQ(3, wrapped_storage_->gets());
+  EXPECT_EQ(3U, storage_.memory_hits());
+}
+
+}  // namespace
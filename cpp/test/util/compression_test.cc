@@ -0,0 +1,111 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/compression.h"
+
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using i18n::addressinput::CompressBlock;
+using i18n::addressinput::DecompressBlock;
+
+// Returns true if |data| is decompressed to itself after being compressed.
+bool RoundTrip(const std::string& data, std::string* compressed) {
+  CompressBlock(data.data(), data.size(), compressed);
+  std::string decompressed(data.size(), '\0');
+  return DecompressBlock(compressed->data(), compressed->size(),
+                         data.empty() ? NULL : &decompressed[0],
+                         decompressed.size()) &&
+         decompressed == data;
+}
+
+TEST(CompressionTest, Empty) {
+  std::string compressed;
+  EXPECT_TRUE(RoundTrip(std::string(), &compressed));
+}
+
+TEST(CompressionTest, Short) {
+  std::string compressed;
+  EXPECT_TRUE(RoundTrip("abc", &compressed));
+}
+
+TEST(CompressionTest, Json) {
+  std::string data;
+  for (int i = 0; i < 100; ++i) {
+    data += "{\"id\":\"data/CH/";
+    data += static_cast<char>('A' + i % 26);
+    data += "\",\"sub_keys\":\"a~b~c\",\"zipex\":\"1234\"},";
+  }
+  std::string compressed;
+  EXPECT_TRUE(RoundTrip(data, &compressed));
+  EXPECT_LT(compressed.size() * 5, data.size());
+}
+
+TEST(CompressionTest, LongRun) {
+  std::string compressed;
+  EXPECT_TRUE(RoundTrip(std::string(100000, 'x'), &compressed));
+  EXPECT_LT(compressed.size(), 1000U);
+}
+
+TEST(CompressionTest, NoRepetition) {
+  std::string data;
+  for (int i = 0; i < 10000; ++i) {
+    data.push_back(static_cast<char>((i * 7919) ^ (i >> 3)));
+  }
+  std::string compressed;
+  EXPECT_TRUE(RoundTrip(data, &compressed));
+}
+
+TEST(CompressionTest, WrongSize) {
+  std::string data(1000, 'x');
+  std::string compressed;
+  CompressBlock(data.data(), data.size(), &compressed);
+
+  std::string shorter(data.size() - 1, '\0');
+  EXPECT_FALSE(DecompressBlock(compressed.data(), compressed.size(),
+                               &shorter[0], shorter.size()));
+  std::string longer(data.size() + 1, '\0');
+  EXPECT_FALSE(DecompressBlock(compressed.data(), compressed.size(),
+                               &longer[0], longer.size()));
+}
+
+TEST(CompressionTest, CorruptedData) {
+  std::string data;
+  for (int i = 0; i < 50; ++i) {
+    data += "abcdefgh";
+    data.push_back(static_cast<char>(i));
+  }
+  std::string compressed;
+  CompressBlock(data.data(), data.size(), &compressed);
+
+  // Any truncated or changed compressed data must be handled safely, whether
+  // it happens to decompress to something or not.
+  std::string output(data.size(), '\0');
+  for (size_t size = 0; size < compressed.size(); ++size) {
+    EXPECT_FALSE(
+        DecompressBlock(compressed.data(), size, &output[0], output.size()));
+  }
+  for (size_t i = 0; i < compressed.size(); ++i) {
+    std::string corrupted(compressed);
+    corrupted[i] ^= 0x5a;
+    DecompressBlock(corrupted.data(), corrupted.size(),
+                    &output[0], output.size());
+  }
+}
+
+}  // namespace
@@ -0,0 +1,63 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/crc32c.h"
+
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using i18n::addressinput::Crc32c;
+
+// The test vectors are from RFC 3720, section B.4.
+
+TEST(Crc32cTest, Empty) {
+  EXPECT_EQ(0U, Crc32c(NULL, 0));
+}
+
+TEST(Crc32cTest, CheckValue) {
+  static const char kData[] = "123456789";
+  EXPECT_EQ(0xe3069283U, Crc32c(kData, sizeof kData - 1));
+}
+
+TEST(Crc32cTest, Zeros) {
+  std::string data(32, '\x00');
+  EXPECT_EQ(0x8a9136aaU, Crc32c(data.data(), data.size()));
+}
+
+TEST(Crc32cTest, Ones) {
+  std::string data(32, '\xff');
+  EXPECT_EQ(0x62a8ab43U, Crc32c(data.data(), data.size()));
+}
+
+TEST(Crc32cTest, IncreasingValues) {
+  std::string data;
+  for (int i = 0; i < 32; ++i) {
+    data.push_back(static_cast<char>(i));
+  }
+  EXPECT_EQ(0x46dd794eU, Crc32c(data.data(), data.size()));
+}
+
+TEST(Crc32cTest, DecreasingValues) {
+  std::string data;
+  for (int i = 31; i >= 0; --i) {
+    data.push_back(static_cast<char>(i));
+  }
+  EXPECT_EQ(0x113fdb5cU, Crc32c(data.data(), data.size()));
+}
+
+}  // namespace
@@ -0,0 +1,138 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/read_copy_update.h"
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+#include "util/atomic.h"
+#include "util/thread_pool.h"
+
+namespace {
+
+using i18n::addressinput::AtomicAdd;
+using i18n::addressinput::AtomicLoad;
+using i18n::addressinput::ReadCopyUpdate;
+using i18n::addressinput::ThreadPool;
+
+// Counts its own deletion.
+class Counted {
+ public:
+  explicit Counted(int* deleted) : deleted_(deleted) {}
+  ~Counted() { AtomicAdd(deleted_, 1); }
+
+ private:
+  int* const deleted_;
+
+  DISALLOW_COPY_AND_ASSIGN(Counted);
+};
+
+TEST(ReadCopyUpdateTest, RetireWithoutReaders) {
+  int deleted = 0;
+  ReadCopyUpdate rcu;
+  rcu.Retire(new Counted(&deleted));
+  EXPECT_EQ(1, deleted);
+  rcu.Retire(new Counted(&deleted));
+  EXPECT_EQ(2, deleted);
+}
+
+TEST(ReadCopyUpdateTest, RetireWaitsForNestedReaders) {
+  int deleted = 0;
+  ReadCopyUpdate rcu;
+  int outer = rcu.ReadLock();
+  int inner = rcu.ReadLock();
+  rcu.Retire(new Counted(&deleted));
+  rcu.ReadUnlock(inner);
+  EXPECT_EQ(0, deleted);
+  rcu.ReadUnlock(outer);
+  EXPECT_EQ(1, deleted);
+}
+
+TEST(ReadCopyUpdateTest, LaterReadersAreNotWaitedFor) {
+  int deleted = 0;
+  ReadCopyUpdate rcu;
+  int token = rcu.ReadLock();
+  rcu.Retire(new Counted(&deleted));
+
+  int later = rcu.ReadLock();
+  EXPECT_EQ(0, deleted);
+  rcu.ReadUnlock(token);
+  EXPECT_EQ(1, deleted);
+  rcu.ReadUnlock(later);
+}
+
+TEST(ReadCopyUpdateTest, ObjectRetiredLaterWaitsForLaterReaders) {
+  int first = 0;
+  int second = 0;
+  ReadCopyUpdate rcu;
+  int token = rcu.ReadLock();
+  rcu.Retire(new Counted(&first));
+  int later = rcu.ReadLock();
+  rcu.Retire(new Counted(&second));
+
+  rcu.ReadUnlock(token);
+  EXPECT_EQ(1, first);
+  EXPECT_EQ(0, second);
+  rcu.ReadUnlock(later);
+  EXPECT_EQ(1, second);
+}
+
+// Retires objects when Run() for index 0, while Run() for all other indices
+// enters and leaves read-side critical sections.
+class RetireWhileReadingTask : public ThreadPool::Task {
+ public:
+  RetireWhileReadingTask(ReadCopyUpdate* rcu, int retired, int* deleted)
+      : rcu_(rcu), retired_(retired), deleted_(deleted) {}
+
+  virtual ~RetireWhileReadingTask() {}
+
+  virtual void Run(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i == 0) {
+        for (int n = 0; n < retired_; ++n) {
+          rcu_->Retire(new Counted(deleted_));
+        }
+      } else {
+        for (int n = 0; n < 10000; ++n) {
+          int outer = rcu_->ReadLock();
+          rcu_->ReadUnlock(rcu_->ReadLock());
+          rcu_->ReadUnlock(outer);
+        }
+      }
+    }
+  }
+
+ private:
+  ReadCopyUpdate* const rcu_;
+  const int retired_;
+  int* const deleted_;
+
+  DISALLOW_COPY_AND_ASSIGN(RetireWhileReadingTask);
+};
+
+TEST(ReadCopyUpdateTest, RetireWhileReading) {
+  static const int kRetired = 1000;
+  int deleted = 0;
+  ReadCopyUpdate rcu;
+  RetireWhileReadingTask task(&rcu, kRetired, &deleted);
+  ThreadPool pool(4);
+  pool.ParallelFor(8, 1, &task);
+  EXPECT_EQ(kRetired, AtomicLoad(&deleted));
+}
+
+}  // namespace
@@ -0,0 +1,98 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/shared_string.h"
+
+#include <libaddressinput/util/scoped_ptr.h>
+
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::SharedString;
+
+TEST(SharedStringTest, EmptyByDefault) {
+  SharedString shared;
+  EXPECT_TRUE(shared.get().empty());
+  EXPECT_FALSE(shared.unique());
+}
+
+TEST(SharedStringTest, NullIsEmpty) {
+  SharedString shared(NULL);
+  EXPECT_TRUE(shared.get().empty());
+}
+
+TEST(SharedStringTest, TakesOwnership) {
+  std::string* data = new std::string("data");
+  SharedString shared(data);
+  EXPECT_EQ(data, &shared.get());
+  EXPECT_TRUE(shared.unique());
+}
+
+TEST(SharedStringTest, CopiesShareTheString) {
+  SharedString shared(new std::string("data"));
+  {
+    SharedString copy(shared);
+    EXPECT_EQ(&shared.get(), &copy.get());
+    EXPECT_FALSE(shared.unique());
+    EXPECT_FALSE(copy.unique());
+
+    SharedString assigned;
+    assigned = copy;
+    EXPECT_EQ(&shared.get(), &assigned.get());
+  }
+  EXPECT_TRUE(shared.unique());
+  EXPECT_EQ("data", shared.get());
+}
+
+TEST(SharedStringTest, SelfAssignment) {
+  SharedString shared(new std::string("data"));
+  const SharedString& same = shared;
+  shared = same;
+  EXPECT_TRUE(shared.unique());
+  EXPECT_EQ("data", shared.get());
+}
+
+TEST(SharedStringTest, ReleaseUniqueStringReturnsIt) {
+  std::string* data = new std::string("data");
+  SharedString shared(data);
+  scoped_ptr<std::string> released(shared.Release());
+  EXPECT_EQ(data, released.get());
+  EXPECT_TRUE(shared.get().empty());
+}
+
+TEST(SharedStringTest, ReleaseSharedStringReturnsCopy) {
+  std::string* data = new std::string("data");
+  SharedString shared(data);
+  SharedString copy(shared);
+  scoped_ptr<std::string> released(shared.Release());
+  EXPECT_NE(data, released.get());
+  EXPECT_EQ("data", *released);
+  EXPECT_TRUE(shared.get().empty());
+  EXPECT_EQ(data, &copy.get());
+  EXPECT_TRUE(copy.unique());
+}
+
+TEST(SharedStringTest, ReleaseEmptyString) {
+  SharedString shared;
+  scoped_ptr<std::string> released(shared.Release());
+  ASSERT_TRUE(released != NULL);
+  EXPECT_TRUE(released->empty());
+}
+
+}  // namespace
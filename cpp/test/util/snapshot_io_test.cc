@@ -0,0 +1,86 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/snapshot_io.h"
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using i18n::addressinput::SnapshotReader;
+using i18n::addressinput::SnapshotWriter;
+
+TEST(SnapshotIoTest, WriteAndRead) {
+  std::string snapshot;
+  SnapshotWriter writer(&snapshot);
+  writer.WriteUint32(0x01020304);
+  writer.WriteString("");
+  writer.WriteString(std::string("a\0b", 3));
+  writer.WriteUint32(0xffffffff);
+  EXPECT_EQ(std::string("\x04\x03\x02\x01", 4), snapshot.substr(0, 4));
+
+  SnapshotReader reader(snapshot.data(), snapshot.size());
+  uint32 number;
+  std::string value("x");
+  ASSERT_TRUE(reader.ReadUint32(&number));
+  EXPECT_EQ(0x01020304U, number);
+  ASSERT_TRUE(reader.ReadString(&value));
+  EXPECT_EQ("", value);
+  ASSERT_TRUE(reader.ReadString(&value));
+  EXPECT_EQ(std::string("a\0b", 3), value);
+  EXPECT_FALSE(reader.AtEnd());
+  ASSERT_TRUE(reader.ReadUint32(&number));
+  EXPECT_EQ(0xffffffffU, number);
+  EXPECT_TRUE(reader.AtEnd());
+  EXPECT_FALSE(reader.ReadUint32(&number));
+}
+
+TEST(SnapshotIoTest, TruncatedString) {
+  std::string snapshot;
+  SnapshotWriter writer(&snapshot);
+  writer.WriteString("abc");
+  snapshot.resize(snapshot.size() - 1);
+
+  SnapshotReader reader(snapshot.data(), snapshot.size());
+  std::string value;
+  EXPECT_FALSE(reader.ReadString(&value));
+  EXPECT_FALSE(reader.AtEnd());
+}
+
+TEST(SnapshotIoTest, CountTooLargeForData) {
+  std::string snapshot;
+  SnapshotWriter writer(&snapshot);
+  writer.WriteUint32(3);
+  writer.WriteUint32(7);
+  writer.WriteUint32(8);
+
+  SnapshotReader reader(snapshot.data(), snapshot.size());
+  size_t count;
+  // Three items of at least 4 bytes each can't fit into the 8 bytes left.
+  EXPECT_FALSE(reader.ReadCount(4, &count));
+  // Once reading has failed, nothing more can be read.
+  uint32 number;
+  EXPECT_FALSE(reader.ReadUint32(&number));
+
+  SnapshotReader other(snapshot.data(), snapshot.size());
+  ASSERT_TRUE(other.ReadCount(2, &count));
+  EXPECT_EQ(3U, count);
+}
+
+}  // namespace
@@ -61,6 +61,16 @@ TEST_P(StringCompareTest, CorrectLess) {
   }
 }
 
+TEST_P(StringCompareTest, CorrectSortKey) {
+  // The keys are computed the first time, and then found in the cache.
+  for (int i = 0; i < 2; ++i) {
+    const std::string& left = StringCompare::NaturalSortKey(GetParam().left);
+    const std::string& right = StringCompare::NaturalSortKey(GetParam().right);
+    EXPECT_EQ(GetParam().should_be_equal, left == right);
+    EXPECT_EQ(GetParam().should_be_less, left < right);
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(
     Comparisons, StringCompareTest,
     testing::Values(
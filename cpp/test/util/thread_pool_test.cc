@@ -0,0 +1,89 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/thread_pool.h"
+
+#include <libaddressinput/util/basictypes.h>
+
+#include <cstddef>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using i18n::addressinput::ThreadPool;
+
+// Counts how many times each index has been processed.
+class CountingTask : public ThreadPool::Task {
+ public:
+  explicit CountingTask(size_t count) : counts_(count, 0) {}
+  virtual ~CountingTask() {}
+
+  virtual void Run(size_t begin, size_t end) {
+    EXPECT_LT(begin, end);
+    EXPECT_LE(end, counts_.size());
+    for (size_t i = begin; i < end; ++i) {
+      ++counts_[i];
+    }
+  }
+
+  const std::vector<int>& counts() const { return counts_; }
+
+ private:
+  std::vector<int> counts_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingTask);
+};
+
+class ThreadPoolTest : public testing::TestWithParam<size_t> {
+ protected:
+  ThreadPoolTest() : pool_(GetParam()) {}
+
+  ThreadPool pool_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ThreadPoolTest);
+};
+
+TEST_P(ThreadPoolTest, Size) {
+  EXPECT_EQ(GetParam(), pool_.size());
+}
+
+TEST_P(ThreadPoolTest, EmptyRange) {
+  CountingTask task(0);
+  pool_.ParallelFor(0, 1, &task);
+  EXPECT_TRUE(task.counts().empty());
+}
+
+TEST_P(ThreadPoolTest, EachIndexProcessedOnce) {
+  static const size_t kCounts[] = { 1, 2, 3, 17, 1000, 12345 };
+  static const size_t kGrains[] = { 1, 7, 64 };
+  for (size_t i = 0; i < arraysize(kCounts); ++i) {
+    for (size_t j = 0; j < arraysize(kGrains); ++j) {
+      CountingTask task(kCounts[i]);
+      pool_.ParallelFor(kCounts[i], kGrains[j], &task);
+      for (size_t k = 0; k < kCounts[i]; ++k) {
+        ASSERT_EQ(1, task.counts()[k])
+            << "count " << kCounts[i] << ", grain " << kGrains[j]
+            << ", index " << k;
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    NumThreads, ThreadPoolTest, testing::Values(0, 1, 2, 8));
+
+}  // namespace
@@ -21,6 +21,7 @@
 
 #include <cstddef>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -125,4 +126,27 @@ TEST_F(ValidatingStorageTest, StaleData) {
   EXPECT_EQ(kValidatedData, data_);
 }
 
+TEST_F(ValidatingStorageTest, GoodDataIsStaleWithoutMaxAge) {
+  storage_.set_max_age(0);
+  storage_.Put(kKey, new std::string(kValidatedData));
+  storage_.Get(kKey, *data_ready_);
+
+  EXPECT_FALSE(success_);
+  EXPECT_EQ(kKey, key_);
+  EXPECT_EQ(kValidatedData, data_);
+}
+
+TEST_F(ValidatingStorageTest, GetMulti) {
+  storage_.Put(kKey, new std::string(kValidatedData));
+  std::vector<std::string> keys;
+  keys.push_back("missing");
+  keys.push_back(kKey);
+  storage_.GetMulti(keys, *data_ready_);
+
+  // The callback is called for each key, so the last call is for |kKey|.
+  EXPECT_TRUE(success_);
+  EXPECT_EQ(kKey, key_);
+  EXPECT_EQ(kValidatedData, data_);
+}
+
 }  // namespace
@@ -26,6 +26,7 @@
 #define TIMESTAMP_HALF_MONTH_AGO 1386705600
 #define TIMESTAMP_TWO_MONTHS_AGO 1382817600
 #define CHECKSUM "dd63dafcbd4d5b28badfcaf86fb6fcdb"
+#define CRC32C "0a8cf231"
 
 namespace {
 
@@ -50,7 +51,7 @@ const char kChecksumInMiddle[] = DATA "\n"
                                  "checksum=" CHECKSUM "\n"
                                  DATA;
 
-// The file as it is stored on disk.
+// The file as it was stored on disk in format 1.
 const char kWrappedData[] = "timestamp=" ITOA(TIMESTAMP) "\n"
                             "checksum=" CHECKSUM "\n"
                             DATA;
@@ -60,6 +61,19 @@ const char kCorruptedWrappedData[] = "timestamP=" ITOA(TIMESTAMP) "\n"
                                      "checksum=" CHECKSUM "\n"
                                      DATA;
 
+// The CRC-32C checksum and data together.
+const char kCrc32cChecksummedData[] = DATA "\n"
+                                      "crc32c=" CRC32C;
+
+// Data corrupted after it was checksummed.
+const char kCorruptedCrc32cChecksummedData[] = "{'foo': 'baz'}\n"
+                                               "crc32c=" CRC32C;
+
+// The file as it is stored on disk in format 2.
+const char kCrc32cWrappedData[] = DATA "\n"
+                                  "crc32c=" CRC32C "\n"
+                                  "timestamp=" ITOA(TIMESTAMP);
+
 // The timestamp in the middle of data.
 const char kTimestampInMiddle[] = DATA "\n"
                                   "timestamp=" ITOA(TIMESTAMP) "\n"
@@ -101,6 +115,17 @@ TEST(ValidatingUtilTest, UnwrapChecksum) {
   EXPECT_EQ(kUnwrappedData, data);
 }
 
+TEST(ValidatingUtilTest, UnwrapChecksum_Crc32c) {
+  std::string data(kCrc32cChecksummedData);
+  EXPECT_TRUE(ValidatingUtil::UnwrapChecksum(&data));
+  EXPECT_EQ(kUnwrappedData, data);
+}
+
+TEST(ValidatingUtilTest, UnwrapChecksum_Crc32cCorruptedData) {
+  std::string data(kCorruptedCrc32cChecksummedData);
+  EXPECT_FALSE(ValidatingUtil::UnwrapChecksum(&data));
+}
+
 TEST(ValidatingUtilTest, UnwrapTimestamp_CorruptedData) {
   std::string data(kCorruptedWrappedData);
   EXPECT_FALSE(ValidatingUtil::UnwrapTimestamp(&data, kTimestamp));
@@ -132,23 +157,42 @@ TEST(ValidatingUtilTest, UnwrapTimestamp_Stale) {
   EXPECT_FALSE(ValidatingUtil::UnwrapTimestamp(&data, kTimestamp));
 }
 
+TEST(ValidatingUtilTest, UnwrapTimestamp_RecentWithShorterMaxAge) {
+  static const time_t kOneWeek = 7 * 24 * 60 * 60;
+  std::string data(kTimestampHalfMonthAgo);
+  EXPECT_FALSE(ValidatingUtil::UnwrapTimestamp(&data, kTimestamp, kOneWeek));
+}
+
+TEST(ValidatingUtilTest, UnwrapTimestamp_StaleWithLongerMaxAge) {
+  static const time_t kOneYear = 365 * 24 * 60 * 60;
+  std::string data(kTimestampTwoMonthsAgo);
+  EXPECT_TRUE(ValidatingUtil::UnwrapTimestamp(&data, kTimestamp, kOneYear));
+  EXPECT_EQ(kUnwrappedData, data);
+}
+
 TEST(ValidatingUtilTest, UnwrapTimestamp) {
   std::string data(kWrappedData);
   EXPECT_TRUE(ValidatingUtil::UnwrapTimestamp(&data, kTimestamp));
   EXPECT_EQ(kChecksummedData, data);
 }
 
+TEST(ValidatingUtilTest, UnwrapTimestamp_Crc32c) {
+  std::string data(kCrc32cWrappedData);
+  EXPECT_TRUE(ValidatingUtil::UnwrapTimestamp(&data, kTimestamp));
+  EXPECT_EQ(kCrc32cChecksummedData, data);
+}
+
 TEST(ValidatingUtilTest, Wrap) {
   std::string data = kUnwrappedData;
   ValidatingUtil::Wrap(kTimestamp, &data);
-  EXPECT_EQ(kWrappedData, data);
+  EXPECT_EQ(kCrc32cWrappedData, data);
 }
 
 TEST(ValidatingUtilTest, WrapUnwrapIt) {
   std::string data = kUnwrappedData;
   ValidatingUtil::Wrap(kTimestamp, &data);
   EXPECT_TRUE(ValidatingUtil::UnwrapTimestamp(&data, kTimestamp));
-  EXPECT_EQ(kChecksummedData, data);
+  EXPECT_EQ(kCrc32cChecksummedData, data);
   EXPECT_TRUE(ValidatingUtil::UnwrapChecksum(&data));
   EXPECT_EQ(kUnwrappedData, data);
 }
@@ -0,0 +1,346 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/validation_cache.h>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/callback.h>
+#include <libaddressinput/null_storage.h>
+#include <libaddressinput/preload_supplier.h>
+#include <libaddressinput/problem_filter.h>
+#include <libaddressinput/supplier.h>
+#include <libaddressinput/util/basictypes.h>
+#include <libaddressinput/util/scoped_ptr.h>
+#include <libaddressinput/validation_result.h>
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "testdata_source.h"
+
+namespace {
+
+using i18n::addressinput::AddressData;
+using i18n::addressinput::AddressValidator;
+using i18n::addressinput::BuildCallback;
+using i18n::addressinput::FieldProblemMap;
+using i18n::addressinput::LookupKey;
+using i18n::addressinput::NullStorage;
+using i18n::addressinput::PreloadSupplier;
+using i18n::addressinput::ProblemFilter;
+using i18n::addressinput::scoped_ptr;
+using i18n::addressinput::Supplier;
+using i18n::addressinput::TestdataSource;
+using i18n::addressinput::ValidationCache;
+using i18n::addressinput::ValidationOptions;
+using i18n::addressinput::ValidationResult;
+
+using i18n::addressinput::COUNTRY;
+using i18n::addressinput::POSTAL_CODE;
+
+using i18n::addressinput::MISSING_REQUIRED_FIELD;
+using i18n::addressinput::INVALID_FORMAT;
+
+TEST(ValidationCacheTest, EmptyCache) {
+  ValidationCache cache(10);
+  AddressData address;
+  ValidationResult result;
+  EXPECT_FALSE(cache.Lookup(address, false, false, NULL, 0, &result));
+  EXPECT_EQ(0U, cache.size());
+  EXPECT_EQ(0U, cache.hits());
+  EXPECT_EQ(1U, cache.misses());
+}
+
+TEST(ValidationCacheTest, InsertAndLookup) {
+  ValidationCache cache(10);
+  AddressData address;
+  address.region_code = "US";
+  address.postal_code = "123";
+  ValidationResult stored;
+  stored.Add(POSTAL_CODE, INVALID_FORMAT);
+  cache.Insert(address, false, false, NULL, 0, stored);
+  EXPECT_EQ(1U, cache.size());
+
+  ValidationResult result;
+  EXPECT_TRUE(cache.Lookup(address, false, false, NULL, 0, &result));
+  EXPECT_EQ(stored, result);
+  EXPECT_EQ(1U, cache.hits());
+  EXPECT_EQ(0U, cache.misses());
+
+  // A NULL filter and an empty filter are the same.
+  FieldProblemMap filter;
+  EXPECT_TRUE(cache.Lookup(address, false, false, &filter, 0, &result));
+
+  // Any other options or address are different.
+  EXPECT_FALSE(cache.Lookup(address, true, false, NULL, 0, &result));
+  EXPECT_FALSE(cache.Lookup(address, false, true, NULL, 0, &result));
+  filter.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+  EXPECT_FALSE(cache.Lookup(address, false, false, &filter, 0, &result));
+  address.postal_code = "12";
+  EXPECT_FALSE(cache.Lookup(address, false, false, NULL, 0, &result));
+  address.postal_code.clear();
+  address.address_line.push_back("123");
+  EXPECT_FALSE(cache.Lookup(address, false, false, NULL, 0, &result));
+
+  EXPECT_EQ(2U, cache.hits());
+  EXPECT_EQ(5U, cache.misses());
+}
+
+TEST(ValidationCacheTest, InsertReplaces) {
+  ValidationCache cache(10);
+  AddressData address;
+  ValidationResult stored;
+  cache.Insert(address, false, false, NULL, 0, stored);
+  stored.Add(COUNTRY, MISSING_REQUIRED_FIELD);
+  cache.Insert(address, false, false, NULL, 0, stored);
+  EXPECT_EQ(1U, cache.size());
+
+  ValidationResult result;
+  EXPECT_TRUE(cache.Lookup(address, false, false, NULL, 0, &result));
+  EXPECT_EQ(stored, result);
+}
+
+TEST(ValidationCacheTest, EvictsLeastRecentlyUsed) {
+  ValidationCache cache(2);
+  AddressData a;
+  a.postal_code = "a";
+  AddressData b;
+  b.postal_code = "b";
+  AddressData c;
+  c.postal_code = "c";
+  ValidationResult result;
+
+  cache.Insert(a, false, false, NULL, 0, result);
+  cache.Insert(b, false, false, NULL, 0, result);
+  EXPECT_TRUE(cache.Lookup(a, false, false, NULL, 0, &result));
+  cache.Insert(c, false, false, NULL, 0, result);
+  EXPECT_EQ(2U, cache.size());
+
+  EXPECT_TRUE(cache.Lookup(a, false, false, NULL, 0, &result));
+  EXPECT_FALSE(cache.Lookup(b, false, false, NULL, 0, &result));
+  EXPECT_TRUE(cache.Lookup(c, false, false, NULL, 0, &result));
+}
+
+TEST(ValidationCacheTest, InvalidateRegion) {
+  ValidationCache cache(10);
+  AddressData us;
+  us.region_code = "US";
+  AddressData ch;
+  ch.region_code = "CH";
+  ValidationResult result;
+
+  cache.Insert(us, false, false, NULL, 0, result);
+  cache.Insert(us, true, false, NULL, 0, result);
+  cache.Insert(ch, false, false, NULL, 0, result);
+  cache.InvalidateRegion("US");
+  EXPECT_EQ(1U, cache.size());
+  EXPECT_FALSE(cache.Lookup(us, false, false, NULL, 0, &result));
+  EXPECT_FALSE(cache.Lookup(us, true, false, NULL, 0, &result));
+  EXPECT_TRUE(cache.Lookup(ch, false, false, NULL, 0, &result));
+
+  cache.Clear();
+  EXPECT_EQ(0U, cache.size());
+  EXPECT_FALSE(cache.Lookup(ch, false, false, NULL, 0, &result));
+}
+
+TEST(ValidationCacheTest, OtherRulesGenerationIsMiss) {
+  ValidationCache cache(10);
+  AddressData address;
+  address.region_code = "US";
+  ValidationResult stored;
+  stored.Add(POSTAL_CODE, INVALID_FORMAT);
+  ValidationResult result;
+
+  cache.Insert(address, false, false, NULL, 1, stored);
+  EXPECT_TRUE(cache.Lookup(address, false, false, NULL, 1, &result));
+  EXPECT_EQ(stored, result);
+
+  // The entry validated with the old rules is removed.
+  EXPECT_FALSE(cache.Lookup(address, false, false, NULL, 2, &result));
+  EXPECT_EQ(0U, cache.size());
+  EXPECT_EQ(1U, cache.misses());
+
+  cache.Insert(address, false, false, NULL, 2, stored);
+  EXPECT_TRUE(cache.Lookup(address, false, false, NULL, 2, &result));
+}
+
+// Counts the calls to Supply() that it passes on to another Supplier.
+class CountingSupplier : public Supplier {
+ public:
+  explicit CountingSupplier(Supplier* supplier)
+      : supplier_(supplier), count_(0) {}
+  virtual ~CountingSupplier() {}
+
+  virtual void Supply(const LookupKey& lookup_key,
+                      const Supplier::Callback& supplied) {
+    ++count_;
+    supplier_->Supply(lookup_key, supplied);
+  }
+
+  virtual int GetRulesGeneration(const std::string& region_code) const {
+    return supplier_->GetRulesGeneration(region_code);
+  }
+
+  int count() const { return count_; }
+
+ private:
+  Supplier* const supplier_;
+  int count_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingSupplier);
+};
+
+class ValidationCacheValidatorTest : public testing::Test {
+ protected:
+  ValidationCacheValidatorTest()
+      : preload_supplier_(new TestdataSource(true), new NullStorage),
+        supplier_(&preload_supplier_),
+        cache_(10),
+        validator_(&supplier_, &cache_),
+        problems_(),
+        called_(false),
+        loaded_(BuildCallback(this, &ValidationCacheValidatorTest::Loaded)),
+        validated_(BuildCallback(
+            this, &ValidationCacheValidatorTest::Validated)) {
+    preload_supplier_.LoadRules("US", *loaded_);
+  }
+
+  void Validate(const AddressData& address) {
+    called_ = false;
+    validator_.Validate(address, false, false, NULL, &problems_, *validated_);
+    ASSERT_TRUE(called_);
+  }
+
+  void Validate(const AddressData& address, const FieldProblemMap& filter) {
+    called_ = false;
+    validator_.Validate(address, false, false, &filter, &problems_,
+                        *validated_);
+    ASSERT_TRUE(called_);
+  }
+
+  void Validate(const AddressData& address, const ValidationOptions& options) {
+    called_ = false;
+    validator_.Validate(address, options, &problems_, *validated_);
+    ASSERT_TRUE(called_);
+  }
+
+  PreloadSupplier preload_supplier_;
+  CountingSupplier supplier_;
+  ValidationCache cache_;
+  const AddressValidator validator_;
+  FieldProblemMap problems_;
+  bool called_;
+  const scoped_ptr<const PreloadSupplier::Callback> loaded_;
+
+ private:
+  void Loaded(bool success, const std::string&, int) { ASSERT_TRUE(success); }
+
+  void Validated(bool success, const AddressData&, const FieldProblemMap&) {
+    ASSERT_TRUE(success);
+    called_ = true;
+  }
+
+  const scoped_ptr<const AddressValidator::Callback> validated_;
+
+  DISALLOW_COPY_AND_ASSIGN(ValidationCacheValidatorTest);
+};
+
+TEST_F(ValidationCacheValidatorTest, HitDoesNotUseSupplier) {
+  AddressData address;
+  address.region_code = "US";
+  address.postal_code = "123";
+
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(1, supplier_.count());
+  EXPECT_EQ(1U, cache_.misses());
+  const FieldProblemMap expected = problems_;
+  EXPECT_FALSE(expected.empty());
+
+  problems_.clear();
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(1, supplier_.count());
+  EXPECT_EQ(1U, cache_.hits());
+  EXPECT_EQ(expected, problems_);
+
+  cache_.InvalidateRegion("US");
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(2, supplier_.count());
+  EXPECT_EQ(expected, problems_);
+}
+
+TEST_F(ValidationCacheValidatorTest, ReloadedRulesAreValidatedAgain) {
+  AddressData address;
+  address.region_code = "US";
+  address.postal_code = "123";
+
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(1, supplier_.count());
+  EXPECT_EQ(1U, cache_.hits());
+  const FieldProblemMap expected = problems_;
+
+  // The entry validated with the old rules isn't used after reloading.
+  preload_supplier_.ReloadRules("US", *loaded_);
+  problems_.clear();
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(2, supplier_.count());
+  EXPECT_EQ(1U, cache_.hits());
+  EXPECT_EQ(2U, cache_.misses());
+  EXPECT_EQ(expected, problems_);
+
+  // The entry validated with the new rules is.
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(2, supplier_.count());
+  EXPECT_EQ(2U, cache_.hits());
+}
+
+TEST_F(ValidationCacheValidatorTest, ProblemFilterHitsSameEntryAsMap) {
+  AddressData address;
+  address.region_code = "US";
+  address.postal_code = "123";
+
+  FieldProblemMap filter;
+  filter.insert(std::make_pair(POSTAL_CODE, INVALID_FORMAT));
+  ASSERT_NO_FATAL_FAILURE(Validate(address, filter));
+  EXPECT_EQ(1, supplier_.count());
+  const FieldProblemMap expected = problems_;
+  EXPECT_EQ(1U, expected.size());
+
+  const ProblemFilter problem_filter(&filter);
+  ValidationOptions options;
+  options.filter = &problem_filter;
+  problems_.clear();
+  ASSERT_NO_FATAL_FAILURE(Validate(address, options));
+  EXPECT_EQ(1, supplier_.count());
+  EXPECT_EQ(1U, cache_.hits());
+  EXPECT_EQ(expected, problems_);
+
+  // No filter is another entry, which is also the same with and without a
+  // ProblemFilter.
+  options.filter = NULL;
+  ASSERT_NO_FATAL_FAILURE(Validate(address, options));
+  EXPECT_EQ(2, supplier_.count());
+  EXPECT_NE(expected, problems_);
+  ASSERT_NO_FATAL_FAILURE(Validate(address));
+  EXPECT_EQ(2, supplier_.count());
+  EXPECT_EQ(2U, cache_.hits());
+}
+
+}  // namespace
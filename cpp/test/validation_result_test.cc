@@ -0,0 +1,126 @@
+// Copyright (C) 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libaddressinput/validation_result.h>
+
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+#include <libaddressinput/address_validator.h>
+
+#include <utility>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using i18n::addressinput::AddressField;
+using i18n::addressinput::AddressProblem;
+using i18n::addressinput::FieldProblemMap;
+using i18n::addressinput::ValidationResult;
+
+using i18n::addressinput::COUNTRY;
+using i18n::addressinput::ADMIN_AREA;
+using i18n::addressinput::POSTAL_CODE;
+using i18n::addressinput::STREET_ADDRESS;
+using i18n::addressinput::RECIPIENT;
+
+using i18n::addressinput::UNEXPECTED_FIELD;
+using i18n::addressinput::MISSING_REQUIRED_FIELD;
+using i18n::addressinput::UNKNOWN_VALUE;
+using i18n::addressinput::INVALID_FORMAT;
+using i18n::addressinput::USES_P_O_BOX;
+
+TEST(ValidationResultTest, Empty) {
+  ValidationResult result;
+  EXPECT_TRUE(result.empty());
+  EXPECT_EQ(0U, result.size());
+  EXPECT_TRUE(result.begin() == result.end());
+  EXPECT_FALSE(result.Contains(COUNTRY, UNEXPECTED_FIELD));
+
+  FieldProblemMap problems;
+  problems.insert(std::make_pair(COUNTRY, UNKNOWN_VALUE));
+  result.ToFieldProblemMap(&problems);
+  EXPECT_TRUE(problems.empty());
+}
+
+TEST(ValidationResultTest, AddAndContains) {
+  ValidationResult result;
+  result.Add(POSTAL_CODE, INVALID_FORMAT);
+  result.Add(POSTAL_CODE, INVALID_FORMAT);
+  result.Add(RECIPIENT, USES_P_O_BOX);
+
+  EXPECT_FALSE(result.empty());
+  EXPECT_EQ(2U, result.size());
+  EXPECT_TRUE(result.Contains(POSTAL_CODE, INVALID_FORMAT));
+  EXPECT_TRUE(result.Contains(RECIPIENT, USES_P_O_BOX));
+  EXPECT_FALSE(result.Contains(POSTAL_CODE, USES_P_O_BOX));
+  EXPECT_FALSE(result.Contains(RECIPIENT, INVALID_FORMAT));
+
+  result.clear();
+  EXPECT_TRUE(result.empty());
+}
+
+TEST(ValidationResultTest, ClearField) {
+  ValidationResult result;
+  result.Add(COUNTRY, UNKNOWN_VALUE);
+  result.Add(POSTAL_CODE, INVALID_FORMAT);
+  result.Add(POSTAL_CODE, UNEXPECTED_FIELD);
+  result.Add(RECIPIENT, MISSING_REQUIRED_FIELD);
+
+  result.ClearField(POSTAL_CODE);
+  EXPECT_EQ(2U, result.size());
+  EXPECT_TRUE(result.Contains(COUNTRY, UNKNOWN_VALUE));
+  EXPECT_TRUE(result.Contains(RECIPIENT, MISSING_REQUIRED_FIELD));
+
+  result.ClearField(RECIPIENT);
+  result.ClearField(COUNTRY);
+  EXPECT_TRUE(result.empty());
+}
+
+TEST(ValidationResultTest, AllPairs) {
+  ValidationResult result;
+  for (int field = COUNTRY; field <= RECIPIENT; ++field) {
+    for (int problem = UNEXPECTED_FIELD; problem <= USES_P_O_BOX; ++problem) {
+      result.Add(static_cast<AddressField>(field),
+                 static_cast<AddressProblem>(problem));
+    }
+  }
+  EXPECT_EQ(48U, result.size());
+
+  int count = 0;
+  for (ValidationResult::const_iterator
+       it = result.begin(); it != result.end(); ++it, ++count) {
+    EXPECT_EQ(count / 6, it->first);
+    EXPECT_EQ(count % 6, it->second);
+  }
+  EXPECT_EQ(48, count);
+}
+
+TEST(ValidationResultTest, FieldProblemMapRoundTrip) {
+  FieldProblemMap problems;
+  problems.insert(std::make_pair(ADMIN_AREA, UNEXPECTED_FIELD));
+  problems.insert(std::make_pair(ADMIN_AREA, UNKNOWN_VALUE));
+  problems.insert(std::make_pair(COUNTRY, MISSING_REQUIRED_FIELD));
+  problems.insert(std::make_pair(STREET_ADDRESS, USES_P_O_BOX));
+
+  ValidationResult result(problems);
+  EXPECT_EQ(4U, result.size());
+
+  FieldProblemMap converted;
+  result.ToFieldProblemMap(&converted);
+  EXPECT_EQ(problems, converted);
+  EXPECT_TRUE(result == ValidationResult(converted));
+}
+
+}  // namespace
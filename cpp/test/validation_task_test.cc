@@ -19,6 +19,7 @@
 #include <libaddressinput/address_problem.h>
 #include <libaddressinput/address_validator.h>
 #include <libaddressinput/callback.h>
+#include <libaddressinput/problem_filter.h>
 #include <libaddressinput/supplier.h>
 #include <libaddressinput/util/basictypes.h>
 #include <libaddressinput/util/scoped_ptr.h>
@@ -61,8 +62,8 @@ class ValidationTaskTest : public testing::Test {
     };
 
     static const AddressProblem kProblems[] = {
-      // UNEXPECTED_FIELD is validated using IsFieldUsed().
-      // MISSING_REQUIRED_FIELD is validated using IsFieldRequired().
+      // UNEXPECTED_FIELD is validated using GetUsedFields().
+      // MISSING_REQUIRED_FIELD is validated using GetRequiredFields().
       UNKNOWN_VALUE,
       INVALID_FORMAT,
       MISMATCHING_VALUE,
@@ -88,11 +89,16 @@ class ValidationTaskTest : public testing::Test {
   void Validate() {
     Rule rule[arraysize(json_)];
 
+    const ProblemFilter filter(&filter_);
+    ValidationOptions options;
+    options.allow_postal = allow_postal_;
+    options.require_name = require_name_;
+    options.filter = &filter;
     ValidationTask* task = new ValidationTask(
         address_,
-        allow_postal_,
-        require_name_,
-        &filter_,
+        options,
+        NULL,
+        0,
         &problems_,
         *validated_);
 